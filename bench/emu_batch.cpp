@@ -0,0 +1,429 @@
+// Runs many independent emulator instances on a pool of threads. Every job has its own rom, input script
+// and frame count and writes its own screenshot and audio, which makes it usable for regression runs and searches
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fs.h"
+#include "json.h"
+#include "logSink.h"
+#include "md5.h"
+#include "tas.h"
+
+#include "systems.h"
+
+struct Job {
+	std::string system;
+	std::string rom;
+	std::string state;
+	std::string input;
+	// output paths, nothing is written if they are empty
+	std::string framebuffer;
+	std::string audio;
+	int frames = 600;
+};
+
+struct Options {
+	std::string jobs;
+	int threads = 0;
+	int instances = 1;
+	bool csv = false;
+	SystemOptions system;
+};
+
+struct Result {
+	size_t job = 0;
+	int instance = 0;
+	double seconds = 0;
+	uint64_t cycles = 0;
+	size_t samples = 0;
+	// md5 of the final screen, equal for equal runs
+	std::string screenHash;
+	std::string error;
+};
+
+// One line per frame with one hex value per port. .fm2 and .bk2 movies drive the two nes controllers
+// and everything else is read as text, lines starting with # are skipped. Inputs are released after the last frame
+static std::vector<std::vector<uint32_t>> LoadInputScript(const std::string& path) {
+	auto ext = fs::path(path).extension().string();
+	std::vector<std::vector<uint32_t>> frames;
+
+	if(ext == ".fm2" || ext == ".bk2") {
+		const auto inputs = ext == ".fm2" ? TasInputs::LoadFM2(path) : TasInputs::LoadBK2(path);
+		for(size_t i = 0; i < inputs.Controller1.size(); i++) {
+			frames.push_back({ inputs.Controller1[i], i < inputs.Controller2.size() ? inputs.Controller2[i] : 0u });
+		}
+		return frames;
+	}
+
+	std::ifstream file(path);
+	if(!file) {
+		throw std::runtime_error("Can't open " + path);
+	}
+
+	std::string line;
+	while(std::getline(file, line)) {
+		if(!line.empty() && line[0] == '#') continue;
+
+		std::istringstream stream(line);
+		std::vector<uint32_t> ports;
+		uint32_t value;
+		while(stream >> std::hex >> value) {
+			ports.push_back(value);
+		}
+		frames.push_back(ports);
+	}
+	return frames;
+}
+
+static void WritePpm(const std::string& path, const Framebuffer& screen) {
+	std::ofstream file(path, std::ios::binary);
+	if(!file) {
+		throw std::runtime_error("Can't create " + path);
+	}
+	file << "P6\n" << screen.GetWidth() << " " << screen.GetHeight() << "\n255\n";
+
+	const auto data = screen.Data();
+	for(int i = 0; i < screen.GetWidth() * screen.GetHeight(); i++) {
+		const char rgb[] = { (char)(data[i] & 0xFF), (char)(data[i] >> 8 & 0xFF), (char)(data[i] >> 16 & 0xFF) };
+		file.write(rgb, 3);
+	}
+}
+
+// 32 bit float stereo wav
+static void WriteWav(const std::string& path, const std::vector<float>& samples, int sampleRate) {
+	std::ofstream file(path, std::ios::binary);
+	if(!file) {
+		throw std::runtime_error("Can't create " + path);
+	}
+
+	auto write = [&](uint32_t value, int size) {
+		for(int i = 0; i < size; i++) {
+			file.put((char)(value >> (i * 8)));
+		}
+	};
+	const uint32_t dataSize = samples.size() * sizeof(float);
+
+	file.write("RIFF", 4);
+	write(36 + dataSize, 4);
+	file.write("WAVEfmt ", 8);
+	write(16, 4);
+	write(3, 2); // WAVE_FORMAT_IEEE_FLOAT
+	write(2, 2);
+	write(sampleRate, 4);
+	write(sampleRate * 2 * sizeof(float), 4);
+	write(2 * sizeof(float), 2);
+	write(32, 2);
+	file.write("data", 4);
+	write(dataSize, 4);
+	file.write((const char*)samples.data(), dataSize);
+}
+
+// keeps the outputs of the instances of a job apart
+static std::string InstancePath(const std::string& path, int instance, const Options& options) {
+	if(path.empty() || options.instances == 1) {
+		return path;
+	}
+	fs::path p(path);
+	return (p.parent_path() / (p.stem().string() + "-" + std::to_string(instance) + p.extension().string())).string();
+}
+
+static Result Run(const Job& job, const SystemRom& rom, size_t index, int instance, const Options& options) {
+	Result result;
+	result.job = index;
+	result.instance = instance;
+
+	auto emulator = CreateSystem(rom, options.system);
+
+	if(!job.state.empty()) {
+		saver state(job.state);
+		state.beginRead();
+		emulator->LoadState(state);
+		state.endRead();
+	}
+
+	std::vector<std::vector<uint32_t>> inputs;
+	if(!job.input.empty()) {
+		inputs = LoadInputScript(job.input);
+	}
+
+	std::vector<float> samples;
+	const auto audioPath = InstancePath(job.audio, instance, options);
+	if(!audioPath.empty()) {
+		emulator->SetSampleSink({ [](void* user, float left, float right) {
+									 auto samples = static_cast<std::vector<float>*>(user);
+									 samples->push_back(left);
+									 samples->push_back(right);
+								 },
+								  &samples });
+	}
+
+	const auto cycles = emulator->Cycles();
+	const auto begin = std::chrono::steady_clock::now();
+
+	for(size_t i = 0; i < (size_t)job.frames; i++) {
+		if(i < inputs.size()) {
+			for(size_t port = 0; port < inputs[i].size(); port++) {
+				emulator->SetInput(port, inputs[i][port]);
+			}
+		} else if(i == inputs.size()) {
+			emulator->SetInput(0, 0);
+			emulator->SetInput(1, 0);
+		}
+		emulator->RunFrame();
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+	result.seconds = std::chrono::duration<double>(end - begin).count();
+	result.cycles = emulator->Cycles() - cycles;
+	result.samples = samples.size() / 2;
+
+	const auto& screen = emulator->Screen();
+	result.screenHash = md5((const char*)screen.Data(), screen.GetWidth() * screen.GetHeight() * sizeof(uint32_t)).ToString();
+
+	const auto framebufferPath = InstancePath(job.framebuffer, instance, options);
+	if(!framebufferPath.empty()) {
+		WritePpm(framebufferPath, screen);
+	}
+	if(!audioPath.empty()) {
+		WriteWav(audioPath, samples, emulator->SampleRate() ? emulator->SampleRate() : 44100);
+	}
+
+	return result;
+}
+
+static std::vector<Job> LoadJobs(const std::string& path) {
+	Json json;
+	std::ifstream file(path);
+	if(!file) {
+		throw std::runtime_error("Can't open " + path);
+	}
+	file >> json;
+
+	auto arr = json.asArray();
+	if(!arr) {
+		throw std::runtime_error("The job file has to hold an array of jobs");
+	}
+
+	std::vector<Job> jobs;
+	for(auto& item : *arr) {
+		Job job;
+
+		if(item.contains("rom")) job.rom = (std::string)item["rom"];
+		if(item.contains("system")) job.system = (std::string)item["system"];
+		if(item.contains("state")) job.state = (std::string)item["state"];
+		if(item.contains("input")) job.input = (std::string)item["input"];
+		if(item.contains("framebuffer")) job.framebuffer = (std::string)item["framebuffer"];
+		if(item.contains("audio")) job.audio = (std::string)item["audio"];
+		if(item.contains("frames")) job.frames = (int)(double)item["frames"];
+
+		if(job.system.empty()) {
+			if(job.rom.empty()) {
+				throw std::runtime_error("Every job needs a rom or a system");
+			}
+			job.system = GuessSystem(job.rom);
+		}
+		if(job.frames < 0) {
+			throw std::runtime_error("frames can't be negative");
+		}
+		jobs.push_back(job);
+	}
+	return jobs;
+}
+
+static void PrintCsv(const std::vector<Job>& jobs, const std::vector<Result>& results) {
+	printf("job,instance,system,rom,frames,wall_ms,frames_per_sec,cycles_per_sec,samples,screen_md5,error\n");
+	for(const auto& result : results) {
+		const auto& job = jobs[result.job];
+		printf("%zu,%i,%s,\"%s\",%i,%.3f,%.2f,%.0f,%zu,%s,\"%s\"\n", result.job, result.instance, job.system.c_str(),
+			   job.rom.empty() ? "synthetic" : job.rom.c_str(), job.frames, result.seconds * 1000, job.frames / result.seconds,
+			   result.cycles / result.seconds, result.samples, result.screenHash.c_str(), result.error.c_str());
+	}
+}
+
+static void PrintJson(const std::vector<Job>& jobs, const std::vector<Result>& results, int threads, double seconds) {
+	std::vector<Json> instances;
+	uint64_t frames = 0;
+	int failed = 0;
+
+	for(const auto& result : results) {
+		const auto& job = jobs[result.job];
+		if(result.error.empty()) {
+			frames += job.frames;
+		} else {
+			failed++;
+		}
+
+		instances.push_back(Json {
+			{ "job", (double)result.job },
+			{ "instance", result.instance },
+			{ "system", job.system },
+			{ "rom", job.rom.empty() ? "synthetic" : job.rom },
+			{ "frames", job.frames },
+			{ "wall_ms", result.seconds * 1000 },
+			{ "frames_per_sec", job.frames / result.seconds },
+			{ "cycles_per_sec", result.cycles / result.seconds },
+			{ "samples", (double)result.samples },
+			{ "screen_md5", result.screenHash },
+			{ "error", result.error },
+		});
+	}
+
+	std::cout << std::setprecision(10) << Json {
+		{ "threads", threads },
+		{ "wall_ms", seconds * 1000 },
+		{ "frames", (double)frames },
+		{ "failed", failed },
+		// summed over all instances, scales with the thread count as long as the instances don't share anything
+		{ "frames_per_sec", frames / seconds },
+		{ "results", instances },
+	} << std::endl;
+}
+
+static void PrintUsage() {
+	fprintf(stderr,
+			"usage: emu-batch [options] <jobs.json>\n"
+			"The job file holds an array of objects with the fields\n"
+			"  rom          rom to run, the synthetic rom of system if missing\n"
+			"  system       nes|gb|chip8, guessed from the rom extension if missing\n"
+			"  frames       (600)\n"
+			"  state        save state to load after the rom\n"
+			"  input        .fm2/.bk2 movie or text file with one line of hex values per frame, one for each port\n"
+			"  framebuffer  ppm file the final screen is written to\n"
+			"  audio        wav file all samples are written to\n"
+			"options:\n"
+			"  --threads <n>          worker threads (hardware concurrency)\n"
+			"  --instances <n>        run every job n times, outputs get -<instance> appended (1)\n"
+			"  --format json|csv      (json)\n"
+			"  --catch-up             nes: catch the ppu up instead of running it in lockstep\n"
+			"  --instruction-core     nes: run whole cpu instructions at once\n");
+}
+
+static Options ParseOptions(int argc, char** argv) {
+	Options options;
+
+	for(int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		auto next = [&]() -> std::string {
+			if(i + 1 >= argc) throw std::runtime_error("Missing value for " + arg);
+			return argv[++i];
+		};
+
+		if(arg == "--threads") options.threads = std::stoi(next());
+		else if(arg == "--instances") options.instances = std::stoi(next());
+		else if(arg == "--format") options.csv = next() == "csv";
+		else if(arg == "--catch-up") options.system.catchUp = true;
+		else if(arg == "--instruction-core") options.system.instructionCore = true;
+		else if(arg == "--help" || arg == "-h") {
+			PrintUsage();
+			exit(0);
+		} else if(arg[0] == '-') throw std::runtime_error("Unknown option " + arg);
+		else options.jobs = arg;
+	}
+
+	if(options.jobs.empty()) {
+		throw std::runtime_error("No job file");
+	}
+	if(options.threads <= 0) {
+		options.threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	if(options.instances <= 0) {
+		throw std::runtime_error("instances has to be positive");
+	}
+
+	return options;
+}
+
+int main(int argc, char** argv) {
+	// rom loading is chatty, only errors matter here
+	Log::SetSink([](const char*) {});
+
+	Options options;
+	std::vector<Job> jobs;
+	try {
+		options = ParseOptions(argc, argv);
+		jobs = LoadJobs(options.jobs);
+	} catch(std::exception& e) {
+		fprintf(stderr, "error: %s\n", e.what());
+		PrintUsage();
+		return 1;
+	}
+
+	// every rom is loaded once and shared read only by all instances running it
+	std::map<std::pair<std::string, std::string>, std::shared_ptr<const SystemRom>> roms;
+	std::vector<std::shared_ptr<const SystemRom>> jobRoms;
+	std::vector<std::string> loadErrors(jobs.size());
+
+	for(size_t i = 0; i < jobs.size(); i++) {
+		auto& rom = roms[{ jobs[i].system, jobs[i].rom }];
+		if(!rom) {
+			try {
+				rom = std::make_shared<const SystemRom>(LoadSystemRom(jobs[i].system, jobs[i].rom));
+			} catch(std::exception& e) {
+				loadErrors[i] = e.what();
+			}
+		}
+		jobRoms.push_back(rom);
+	}
+
+	const auto count = jobs.size() * options.instances;
+	std::vector<Result> results(count);
+	std::atomic<size_t> nextJob { 0 };
+
+	// every worker takes the next job until none are left, the results are written to their own slots
+	auto worker = [&]() {
+		for(size_t i = nextJob++; i < count; i = nextJob++) {
+			const auto job = i / options.instances;
+			const int instance = i % options.instances;
+
+			try {
+				if(!jobRoms[job]) {
+					throw std::runtime_error(loadErrors[job]);
+				}
+				results[i] = Run(jobs[job], *jobRoms[job], job, instance, options);
+			} catch(std::exception& e) {
+				results[i].job = job;
+				results[i].instance = instance;
+				results[i].error = e.what();
+			}
+		}
+	};
+
+	const auto threads = std::min<size_t>(options.threads, count);
+	const auto begin = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> pool;
+	for(size_t i = 0; i < threads; i++) {
+		pool.emplace_back(worker);
+	}
+	for(auto& thread : pool) {
+		thread.join();
+	}
+
+	const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	if(options.csv) {
+		PrintCsv(jobs, results);
+	} else {
+		PrintJson(jobs, results, threads, seconds);
+	}
+
+	bool failed = false;
+	for(const auto& result : results) {
+		if(!result.error.empty()) {
+			fprintf(stderr, "job %zu instance %i failed: %s\n", result.job, result.instance, result.error.c_str());
+			failed = true;
+		}
+	}
+	return failed ? 1 : 0;
+}
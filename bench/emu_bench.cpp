@@ -0,0 +1,218 @@
+// Runs the emulation cores headless for a fixed number of frames and reports how fast they are.
+// Every iteration starts from the same state so the numbers of two builds can be compared directly
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "json.h"
+#include "logSink.h"
+#include "saver.h"
+
+#include "systems.h"
+
+struct Options {
+	std::string system;
+	std::string rom;
+	std::string state;
+	int frames = 600;
+	int warmup = 60;
+	int iterations = 5;
+	bool csv = false;
+	bool catchUp = false;
+	bool instructionCore = false;
+	bool render = true;
+};
+
+struct Iteration {
+	double seconds;
+	uint64_t cycles;
+	uint64_t instructions;
+};
+
+struct Result {
+	std::string system;
+	std::string rom;
+	int frames;
+	std::vector<Iteration> iterations;
+};
+
+static Result Run(const std::string& system, const std::string& rom, const Options& options) {
+	auto emulator = CreateSystem(system, rom, { options.catchUp, options.instructionCore, options.render });
+
+	if(!options.state.empty()) {
+		saver state(options.state);
+		state.beginRead();
+		emulator->LoadState(state);
+		state.endRead();
+	}
+
+	for(int i = 0; i < options.warmup; i++) {
+		emulator->RunFrame();
+	}
+
+	saver start;
+	emulator->SaveState(start);
+
+	Result result { system, rom.empty() ? "synthetic" : rom, options.frames, {} };
+	for(int i = 0; i < options.iterations; i++) {
+		start.beginRead();
+		emulator->LoadState(start);
+		start.endRead();
+
+		const auto cycles = emulator->Cycles();
+		const auto instructions = emulator->Instructions();
+		const auto begin = std::chrono::steady_clock::now();
+
+		for(int j = 0; j < options.frames; j++) {
+			emulator->RunFrame();
+		}
+
+		const auto end = std::chrono::steady_clock::now();
+		result.iterations.push_back({ std::chrono::duration<double>(end - begin).count(),
+									  emulator->Cycles() - cycles,
+									  emulator->Instructions() - instructions });
+	}
+
+	return result;
+}
+
+static void PrintCsv(const std::vector<Result>& results) {
+	printf("system,rom,iteration,frames,wall_ms,frames_per_sec,cycles_per_sec,instructions_per_sec\n");
+	for(const auto& result : results) {
+		for(size_t i = 0; i < result.iterations.size(); i++) {
+			const auto& it = result.iterations[i];
+			printf("%s,\"%s\",%zu,%i,%.3f,%.2f,%.0f,%.0f\n", result.system.c_str(), result.rom.c_str(), i, result.frames,
+				   it.seconds * 1000, result.frames / it.seconds, it.cycles / it.seconds, it.instructions / it.seconds);
+		}
+	}
+}
+
+static void PrintJson(const std::vector<Result>& results, const Options& options) {
+	std::vector<Json> systems;
+
+	for(const auto& result : results) {
+		std::vector<Json> iterations;
+		double best = 0, total = 0;
+
+		for(const auto& it : result.iterations) {
+			const auto fps = result.frames / it.seconds;
+			best = std::max(best, fps);
+			total += fps;
+
+			iterations.push_back(Json {
+				{ "wall_ms", it.seconds * 1000 },
+				{ "frames_per_sec", fps },
+				{ "cycles_per_sec", it.cycles / it.seconds },
+				{ "instructions_per_sec", it.instructions / it.seconds },
+			});
+		}
+
+		systems.push_back(Json {
+			{ "system", result.system },
+			{ "rom", result.rom },
+			{ "frames", result.frames },
+			{ "iterations", iterations },
+			{ "mean_frames_per_sec", result.iterations.empty() ? 0 : total / result.iterations.size() },
+			{ "best_frames_per_sec", best },
+		});
+	}
+
+	std::cout << std::setprecision(10) << Json {
+		{ "warmup", options.warmup },
+		{ "catch_up", options.catchUp },
+		{ "instruction_core", options.instructionCore },
+		{ "render", options.render },
+		{ "results", systems },
+	} << std::endl;
+}
+
+static void PrintUsage() {
+	fprintf(stderr,
+			"usage: emu-bench [options] [rom]\n"
+			"Without a rom the synthetic rom of every system (or only --system) is run.\n"
+			"  --system nes|gb|chip8  system of the rom, guessed from its extension otherwise\n"
+			"  --state <file>         save state to load after the rom\n"
+			"  --frames <n>           frames per iteration (600)\n"
+			"  --warmup <n>           frames run before the first iteration (60)\n"
+			"  --iterations <n>       (5)\n"
+			"  --format json|csv      (json)\n"
+			"  --catch-up             nes: catch the ppu up instead of running it in lockstep\n"
+			"  --instruction-core     nes: run whole cpu instructions at once\n"
+			"  --no-render            nes, gb: skip drawing pixels like fast-forwarded frames\n");
+}
+
+static Options ParseOptions(int argc, char** argv) {
+	Options options;
+
+	for(int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		auto next = [&]() -> std::string {
+			if(i + 1 >= argc) throw std::runtime_error("Missing value for " + arg);
+			return argv[++i];
+		};
+
+		if(arg == "--system") options.system = next();
+		else if(arg == "--state") options.state = next();
+		else if(arg == "--frames") options.frames = std::stoi(next());
+		else if(arg == "--warmup") options.warmup = std::stoi(next());
+		else if(arg == "--iterations") options.iterations = std::stoi(next());
+		else if(arg == "--format") options.csv = next() == "csv";
+		else if(arg == "--catch-up") options.catchUp = true;
+		else if(arg == "--instruction-core") options.instructionCore = true;
+		else if(arg == "--no-render") options.render = false;
+		else if(arg == "--help" || arg == "-h") {
+			PrintUsage();
+			exit(0);
+		} else if(arg[0] == '-') throw std::runtime_error("Unknown option " + arg);
+		else options.rom = arg;
+	}
+
+	if(options.frames <= 0 || options.iterations <= 0 || options.warmup < 0) {
+		throw std::runtime_error("frames and iterations have to be positive");
+	}
+	if(!options.rom.empty() && options.system.empty()) {
+		options.system = GuessSystem(options.rom);
+	}
+	if(!options.state.empty() && options.system.empty()) {
+		throw std::runtime_error("--state needs a rom or --system");
+	}
+
+	return options;
+}
+
+int main(int argc, char** argv) {
+	// rom loading is chatty, only errors matter here
+	Log::SetSink([](const char*) {});
+
+	try {
+		const auto options = ParseOptions(argc, argv);
+
+		std::vector<std::string> systems { "nes", "gb", "chip8" };
+		if(!options.system.empty()) {
+			systems = { options.system };
+		}
+
+		std::vector<Result> results;
+		for(const auto& system : systems) {
+			results.push_back(Run(system, options.rom, options));
+		}
+
+		if(options.csv) {
+			PrintCsv(results);
+		} else {
+			PrintJson(results, options);
+		}
+	} catch(std::exception& e) {
+		fprintf(stderr, "error: %s\n", e.what());
+		PrintUsage();
+		return 1;
+	}
+
+	return 0;
+}
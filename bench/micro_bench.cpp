@@ -0,0 +1,638 @@
+// Times single hot functions of the cores in isolation and reports ns/op with a 95% confidence interval.
+// Every sample runs the operation in a loop long enough for the clock resolution not to matter
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Emulation/GB/Cartridge.h"
+#include "Emulation/GB/Gameboy.h"
+#include "Emulation/NES/Bus.h"
+#include "Framebuffer.h"
+#include "json.h"
+#include "jsonReader.h"
+#include "logSink.h"
+#include "saver.h"
+
+#include "synthetic.h"
+
+// runs the operation the given number of times
+using Runner = std::function<void(uint64_t ops)>;
+
+struct Benchmark {
+	std::string name;
+	// creates the state the operation works on
+	std::function<Runner()> setup;
+};
+
+namespace Gameboy {
+
+struct BenchAccess {
+	static PPU& Ppu(Gameboy& gameboy) { return gameboy.ppu; }
+
+	static void DrawBg(PPU& ppu) { ppu.DrawBg(false); }
+	static void DrawSprites(PPU& ppu) { ppu.DrawSprites(false); }
+
+	// line 50 with every tile different and 10 sprites on it
+	static void SetupLine(PPU& ppu) {
+		for(int i = 0; i < 0x1800; i++) {
+			ppu.VRAM[0][i] = i * 7;
+		}
+		for(int i = 0x1800; i < 0x2000; i++) {
+			ppu.VRAM[0][i] = i;
+		}
+
+		for(int i = 0; i < 40; i++) {
+			const uint8_t sprite[] = { (uint8_t)(50 + 16 - (i % 4) * 2), (uint8_t)(8 + i * 4), (uint8_t)i, (uint8_t)((i & 1) << 4) };
+			std::copy(std::begin(sprite), std::end(sprite), &ppu.OAM[i * 4]);
+		}
+
+		ppu.Control.reg = 0x93;
+		ppu.LY = 50;
+		ppu.SCX = 3;
+		ppu.SCY = 5;
+		ppu.BGP = 0xE4;
+		ppu.OBP0 = 0xD2;
+		ppu.OBP1 = 0x1B;
+	}
+};
+
+}
+
+#pragma region Nes
+// the cpu mixes are loops at $8000
+
+static const std::vector<uint8_t> aluProgram = {
+	0xA5, 0x10,       // LDA $10
+	0x69, 0x37,       // ADC #$37
+	0x85, 0x11,       // STA $11
+	0x49, 0x5A,       // EOR #$5A
+	0x29, 0xF0,       // AND #$F0
+	0x09, 0x03,       // ORA #$03
+	0xAA,             // TAX
+	0xE8,             // INX
+	0x8A,             // TXA
+	0x0A,             // ASL
+	0x18,             // CLC
+	0x65, 0x11,       // ADC $11
+	0x85, 0x10,       // STA $10
+	0x4C, 0x00, 0x80, // JMP $8000
+};
+
+static const std::vector<uint8_t> memoryProgram = {
+	0xA2, 0x00,       // LDX #$00
+	// loop: $8002
+	0xBD, 0x00, 0x03, // LDA $0300,X
+	0x9D, 0x00, 0x04, // STA $0400,X
+	0xFE, 0x00, 0x05, // INC $0500,X
+	0x3E, 0x00, 0x06, // ROL $0600,X
+	0xE6, 0x20,       // INC $20
+	0xAD, 0x00, 0x02, // LDA $0200
+	0x8D, 0x01, 0x02, // STA $0201
+	0xE8,             // INX
+	0x4C, 0x02, 0x80, // JMP loop
+};
+
+static const std::vector<uint8_t> branchProgram = {
+	0xA2, 0x08,       // LDX #$08
+	// inner: $8002
+	0x20, 0x15, 0x80, // JSR sub
+	0xCA,             // DEX
+	0xD0, 0xFA,       // BNE inner
+	0xA5, 0x10,       // LDA $10
+	0xF0, 0x02,       // BEQ skip
+	0xC6, 0x10,       // DEC $10
+	// skip: $800E
+	0xE6, 0x10,       // INC $10
+	0x30, 0xEE,       // BMI $8000
+	0x4C, 0x00, 0x80, // JMP $8000
+	// sub: $8015
+	0xC8,             // INY
+	0x60,             // RTS
+};
+
+struct NesState {
+	Framebuffer texture { 256, 240 };
+	Nes::Bus bus;
+
+	NesState(std::shared_ptr<Nes::Mapper> cart) {
+		bus.ppu.texture = &texture;
+		texture.SetPalette(Nes::ppu2C02::colors, 64);
+
+		bus.InsertCartridge(cart);
+		bus.HardReset();
+	}
+};
+
+static Runner NesCpu(const std::vector<uint8_t>& program) {
+	auto state = std::make_shared<NesState>(Synthetic::NesCart(program, 0x8000, 0x8000));
+
+	// only the cpu runs so there are no interrupts
+	return [state](uint64_t ops) {
+		auto& cpu = state->bus.cpu;
+		for(uint64_t i = 0; i < ops; i++) {
+			cpu.Clock();
+		}
+	};
+}
+
+// the programs on the whole bus with the ppu caught up lazily and rendering off, one op is one cpu cycle.
+// Unlike nes/cpu this includes the per cycle work of the bus and the apu that comes with every cpu cycle
+static Runner NesBusCpu(const std::vector<uint8_t>& program, Nes::CpuCore core) {
+	auto state = std::make_shared<NesState>(Synthetic::NesCart(program, 0x8000, 0x8000));
+	state->bus.SetPpuSync(Nes::PpuSync::CatchUp);
+	state->bus.SetCpuCore(core);
+
+	return [state](uint64_t ops) {
+		auto& bus = state->bus;
+		const auto end = bus.systemClockCounter + ops * 3;
+		while(bus.systemClockCounter < end) {
+			if(bus.GetCpuCore() == Nes::CpuCore::Instruction && bus.systemClockCounter % 3 == 0 && bus.cpu.InstructionStart()) {
+				bus.cpu.Step();
+			} else {
+				bus.Clock();
+			}
+		}
+		bus.apu.EndFrame();
+	};
+}
+
+// palette, nametables and oam filled through the registers with 8 sprites on most lines
+static std::shared_ptr<NesState> NesPpuState(uint8_t mask) {
+	auto state = std::make_shared<NesState>(Synthetic::NesCart());
+	auto& ppu = state->bus.ppu;
+
+	ppu.cpuWrite(0x2006, 0x3F);
+	ppu.cpuWrite(0x2006, 0x00);
+	for(int i = 0; i < 32; i++) {
+		ppu.cpuWrite(0x2007, i);
+	}
+
+	ppu.cpuWrite(0x2006, 0x20);
+	ppu.cpuWrite(0x2006, 0x00);
+	for(int i = 0; i < 0x800; i++) {
+		ppu.cpuWrite(0x2007, i * 3);
+	}
+
+	ppu.cpuWrite(0x2003, 0);
+	for(int i = 0; i < 64; i++) {
+		ppu.cpuWrite(0x2004, (i / 8) * 28); // y
+		ppu.cpuWrite(0x2004, i);			// tile
+		ppu.cpuWrite(0x2004, i & 0xE3);		// attributes
+		ppu.cpuWrite(0x2004, (i % 8) * 30); // x
+	}
+
+	ppu.cpuWrite(0x2000, 0x10);
+	ppu.cpuWrite(0x2001, mask);
+	return state;
+}
+
+static Runner NesPpuClock(uint8_t mask) {
+	auto state = NesPpuState(mask);
+
+	return [state](uint64_t ops) {
+		auto& ppu = state->bus.ppu;
+		for(uint64_t i = 0; i < ops; i++) {
+			ppu.Clock();
+		}
+	};
+}
+
+// whole frames through the scanline renderer
+static Runner NesPpuRun(uint8_t mask) {
+	auto state = NesPpuState(mask);
+
+	return [state](uint64_t ops) {
+		for(uint64_t i = 0; i < ops; i++) {
+			state->bus.ppu.Run(341 * 262);
+		}
+	};
+}
+
+// pulse, triangle and noise playing. The length counters only run on frame counter steps, so they never stop
+static std::shared_ptr<NesState> NesApuState() {
+	auto state = std::make_shared<NesState>(Synthetic::NesCart());
+	auto& apu = state->bus.apu;
+
+	const std::pair<uint16_t, uint8_t> writes[] = {
+		{ 0x4015, 0x0F },
+		{ 0x4000, 0xBF }, { 0x4002, 0x50 }, { 0x4003, 0x01 },
+		{ 0x4004, 0x7F }, { 0x4006, 0x80 }, { 0x4007, 0x01 },
+		{ 0x4008, 0xFF }, { 0x400A, 0x40 }, { 0x400B, 0x01 },
+		{ 0x400C, 0x1F }, { 0x400E, 0x03 }, { 0x400F, 0x08 },
+	};
+	for(auto [addr, val] : writes) {
+		apu.CpuWrite(addr, val);
+	}
+	return state;
+}
+
+static Runner NesApuClock() {
+	auto state = NesApuState();
+
+	return [state](uint64_t ops) {
+		auto& apu = state->bus.apu;
+		for(uint64_t i = 0; i < ops; i++) {
+			apu.Clock();
+			// the visualization buffer only holds a few frames
+			if((i & 0x3FFF) == 0x3FFF) apu.EndFrame();
+		}
+	};
+}
+
+// same as NesApuClock with something listening, so the channels get mixed and the samples synthesized
+static Runner NesApuMix() {
+	auto state = NesApuState();
+	state->bus.apu.SetSampleSink({ [](void*, float, float) {}, nullptr });
+
+	return [state](uint64_t ops) {
+		auto& apu = state->bus.apu;
+		for(uint64_t i = 0; i < ops; i++) {
+			apu.Clock();
+			if((i & 0x3FFF) == 0x3FFF) apu.EndFrame();
+		}
+	};
+}
+
+static std::shared_ptr<NesState> NesRunningState() {
+	auto state = std::make_shared<NesState>(Synthetic::NesCart());
+
+	for(int i = 0; i < 10; i++) {
+		state->bus.RunFrame();
+		state->bus.ppu.frameComplete = false;
+		state->bus.apu.EndFrame();
+	}
+	return state;
+}
+
+static Runner NesSaveState() {
+	auto state = NesRunningState();
+	auto save = std::make_shared<saver>();
+
+	return [state, save](uint64_t ops) {
+		for(uint64_t i = 0; i < ops; i++) {
+			save->clear();
+			state->bus.SaveState(*save);
+		}
+	};
+}
+
+static Runner NesLoadState() {
+	auto state = NesRunningState();
+	auto save = std::make_shared<saver>();
+	state->bus.SaveState(*save);
+
+	return [state, save](uint64_t ops) {
+		for(uint64_t i = 0; i < ops; i++) {
+			save->beginRead();
+			state->bus.LoadState(*save);
+			save->endRead();
+		}
+	};
+}
+#pragma endregion
+
+#pragma region Gameboy
+struct GameboyState {
+	Framebuffer texture { 160, 144 };
+	Gameboy::Gameboy gameboy { texture };
+
+	GameboyState() {
+		Gameboy::Mode mode;
+		gameboy.InsertCartridge(Gameboy::LoadCart(Synthetic::GameboyRom(), mode));
+		gameboy.Reset(mode);
+
+		// get past the setup code and into the main loop
+		while(gameboy.cyclesPassed < 4194304 / 60.0) {
+			gameboy.Clock();
+		}
+		gameboy.cyclesPassed = 0;
+	}
+};
+
+static Runner GameboyStep() {
+	auto state = std::make_shared<GameboyState>();
+
+	return [state](uint64_t ops) {
+		auto& gameboy = state->gameboy;
+		for(uint64_t i = 0; i < ops; i++) {
+			gameboy.Clock();
+		}
+		gameboy.cyclesPassed = 0;
+	};
+}
+
+// one machine cycle of timer, ppu and apu
+static Runner GameboyAdvance() {
+	auto state = std::make_shared<GameboyState>();
+
+	return [state](uint64_t ops) {
+		auto& gameboy = state->gameboy;
+		for(uint64_t i = 0; i < ops; i++) {
+			gameboy.pendingCycles = 4;
+			gameboy.Advance();
+		}
+		gameboy.cyclesPassed = 0;
+	};
+}
+
+static Runner GameboyPpuLine(void (*draw)(Gameboy::PPU&)) {
+	auto state = std::make_shared<GameboyState>();
+	Gameboy::BenchAccess::SetupLine(Gameboy::BenchAccess::Ppu(state->gameboy));
+
+	return [state, draw](uint64_t ops) {
+		auto& ppu = Gameboy::BenchAccess::Ppu(state->gameboy);
+		for(uint64_t i = 0; i < ops; i++) {
+			draw(ppu);
+		}
+	};
+}
+
+static Runner GameboySaveState() {
+	auto state = std::make_shared<GameboyState>();
+	auto save = std::make_shared<saver>();
+
+	return [state, save](uint64_t ops) {
+		for(uint64_t i = 0; i < ops; i++) {
+			save->clear();
+			state->gameboy.SaveState(*save);
+		}
+	};
+}
+
+static Runner GameboyLoadState() {
+	auto state = std::make_shared<GameboyState>();
+	auto save = std::make_shared<saver>();
+	state->gameboy.SaveState(*save);
+
+	return [state, save](uint64_t ops) {
+		for(uint64_t i = 0; i < ops; i++) {
+			save->beginRead();
+			state->gameboy.LoadState(*save);
+			save->endRead();
+		}
+	};
+}
+#pragma endregion
+
+#pragma region Json
+// 64 KiB shaped like the nes cart db. Every op parses all of it
+static std::shared_ptr<const std::string> CartDbDocument() {
+	std::string doc = R"({"database":{"@version":"1.0","game":[)";
+
+	for(int i = 0; doc.size() < 64 * 1024; i++) {
+		char sha[41];
+		snprintf(sha, sizeof(sha), "%08X%08X%08X%08X%08X", i * 2654435761u, i * 40503u, ~i, i * 7u, i ^ 0x5A5A5A5A);
+
+		if(i) doc += ',';
+		doc += R"({"@name":"Game )" + std::to_string(i) + R"( \"Deluxe\"","@region":"USA","@players":"2",)";
+		doc += R"("cartridge":{"@system":"NES-NTSC","@crc":"836C4FA7","board":{"@type":"NES-NROM-256","@mapper":")" + std::to_string(i % 5) + R"(",)";
+		doc += R"("prg":{"@size":"32k","@sha1":")" + std::string(sha) + R"("},"chr":{"@size":"8k"},"pad":{"@h":0,"@v":1}}}})";
+	}
+	doc += "]}}";
+
+	return std::make_shared<const std::string>(std::move(doc));
+}
+
+static Runner JsonReaderDocument() {
+	auto doc = CartDbDocument();
+
+	return [doc](uint64_t ops) {
+		size_t strings = 0;
+		for(uint64_t i = 0; i < ops; i++) {
+			JsonReader reader(*doc);
+			for(auto token = reader.Next(); token != JsonToken::End; token = reader.Next()) {
+				strings += token == JsonToken::String;
+			}
+		}
+		if(strings == 0) throw std::runtime_error("No strings read");
+	};
+}
+
+static Runner JsonDomDocument() {
+	auto doc = CartDbDocument();
+
+	return [doc](uint64_t ops) {
+		for(uint64_t i = 0; i < ops; i++) {
+			std::istringstream stream(*doc);
+			Json json;
+			stream >> json;
+		}
+	};
+}
+#pragma endregion
+
+static const std::vector<Benchmark> benchmarks = {
+	{ "nes/cpu/alu", [] { return NesCpu(aluProgram); } },
+	{ "nes/cpu/memory", [] { return NesCpu(memoryProgram); } },
+	{ "nes/cpu/branch", [] { return NesCpu(branchProgram); } },
+	{ "nes/bus/cycle-core-alu", [] { return NesBusCpu(aluProgram, Nes::CpuCore::Cycle); } },
+	{ "nes/bus/cycle-core-memory", [] { return NesBusCpu(memoryProgram, Nes::CpuCore::Cycle); } },
+	{ "nes/bus/cycle-core-branch", [] { return NesBusCpu(branchProgram, Nes::CpuCore::Cycle); } },
+	{ "nes/bus/instruction-core-alu", [] { return NesBusCpu(aluProgram, Nes::CpuCore::Instruction); } },
+	{ "nes/bus/instruction-core-memory", [] { return NesBusCpu(memoryProgram, Nes::CpuCore::Instruction); } },
+	{ "nes/bus/instruction-core-branch", [] { return NesBusCpu(branchProgram, Nes::CpuCore::Instruction); } },
+	{ "nes/ppu/clock-idle", [] { return NesPpuClock(0x00); } },
+	{ "nes/ppu/clock-background", [] { return NesPpuClock(0x0A); } },
+	{ "nes/ppu/clock-sprites", [] { return NesPpuClock(0x1E); } },
+	{ "nes/ppu/run-frame", [] { return NesPpuRun(0x1E); } },
+	{ "nes/apu/clock", NesApuClock },
+	{ "nes/apu/clock-mixed", NesApuMix },
+	{ "nes/state/save", NesSaveState },
+	{ "nes/state/load", NesLoadState },
+	{ "gb/cpu/step", GameboyStep },
+	{ "gb/advance", GameboyAdvance },
+	{ "gb/ppu/draw-bg", [] { return GameboyPpuLine(Gameboy::BenchAccess::DrawBg); } },
+	{ "gb/ppu/draw-sprites", [] { return GameboyPpuLine(Gameboy::BenchAccess::DrawSprites); } },
+	{ "gb/state/save", GameboySaveState },
+	{ "gb/state/load", GameboyLoadState },
+	{ "json/reader/cart-db-64k", JsonReaderDocument },
+	{ "json/dom/cart-db-64k", JsonDomDocument },
+};
+
+struct Options {
+	std::string filter;
+	int samples = 20;
+	double minSampleTime = 0.01;
+	std::string format = "table";
+};
+
+struct Result {
+	std::string name;
+	uint64_t opsPerSample;
+	std::vector<double> samples; // ns/op
+
+	double mean, stddev, median, min;
+	// half width of the 95% confidence interval of the mean
+	double ci;
+};
+
+// 97.5% quantile of the t distribution
+static double StudentT(int df) {
+	static const double table[] = {
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+	};
+	if(df <= 30) {
+		return table[df - 1];
+	}
+	// first term of the expansion around the normal quantile
+	return 1.96 + 2.37 / df;
+}
+
+static double Time(const Runner& run, uint64_t ops) {
+	const auto begin = std::chrono::steady_clock::now();
+	run(ops);
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - begin).count();
+}
+
+static Result Measure(const Benchmark& benchmark, const Options& options) {
+	const auto run = benchmark.setup();
+
+	// grow the batch until one sample takes long enough. This also warms up the caches
+	uint64_t ops = 1;
+	while(true) {
+		const auto time = Time(run, ops);
+		if(time >= options.minSampleTime) break;
+
+		const auto scale = time > 0 ? options.minSampleTime / time * 1.2 : 16;
+		ops = std::max(ops + 1, (uint64_t)(ops * std::min(scale, 16.0)));
+	}
+
+	Result result { benchmark.name, ops, {}, 0, 0, 0, 0, 0 };
+	for(int i = 0; i < options.samples; i++) {
+		result.samples.push_back(Time(run, ops) * 1e9 / ops);
+	}
+
+	const auto n = result.samples.size();
+	for(auto sample : result.samples) {
+		result.mean += sample;
+	}
+	result.mean /= n;
+
+	for(auto sample : result.samples) {
+		result.stddev += (sample - result.mean) * (sample - result.mean);
+	}
+	result.stddev = n > 1 ? std::sqrt(result.stddev / (n - 1)) : 0;
+	result.ci = n > 1 ? StudentT(n - 1) * result.stddev / std::sqrt(n) : 0;
+
+	auto sorted = result.samples;
+	std::sort(sorted.begin(), sorted.end());
+	result.min = sorted.front();
+	result.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+
+	return result;
+}
+
+static void PrintTableHeader() {
+	printf("%-28s %12s %10s %8s %12s %12s %10s\n", "benchmark", "ns/op", "95% ci", "ci %", "median", "min", "ops");
+}
+
+// printed as soon as a benchmark finishes
+static void PrintTableRow(const Result& r) {
+	printf("%-28s %12.3f %10.3f %7.2f%% %12.3f %12.3f %10llu\n", r.name.c_str(), r.mean, r.ci, r.ci / r.mean * 100, r.median, r.min, (unsigned long long)r.opsPerSample);
+	fflush(stdout);
+}
+
+static void PrintCsv(const std::vector<Result>& results) {
+	printf("benchmark,ns_per_op,ci95,stddev,median,min,samples,ops_per_sample\n");
+	for(const auto& r : results) {
+		printf("%s,%.4f,%.4f,%.4f,%.4f,%.4f,%zu,%llu\n", r.name.c_str(), r.mean, r.ci, r.stddev, r.median, r.min, r.samples.size(), (unsigned long long)r.opsPerSample);
+	}
+}
+
+static void PrintJson(const std::vector<Result>& results) {
+	std::vector<Json> items;
+	for(const auto& r : results) {
+		items.push_back(Json {
+			{ "name", r.name },
+			{ "ns_per_op", r.mean },
+			{ "ci95", r.ci },
+			{ "stddev", r.stddev },
+			{ "median", r.median },
+			{ "min", r.min },
+			{ "ops_per_sample", (double)r.opsPerSample },
+			{ "samples", r.samples },
+		});
+	}
+	std::cout << std::setprecision(10) << Json { { "results", items } } << std::endl;
+}
+
+static void PrintUsage() {
+	fprintf(stderr,
+			"usage: micro-bench [options]\n"
+			"  --filter <text>       only run benchmarks whose name contains text\n"
+			"  --samples <n>         samples per benchmark (20)\n"
+			"  --min-time <ms>       minimum time of one sample (10)\n"
+			"  --format table|json|csv\n"
+			"  --list                print the benchmark names\n");
+}
+
+int main(int argc, char** argv) {
+	Log::SetSink([](const char*) {});
+
+	Options options;
+	try {
+		for(int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			auto next = [&]() -> std::string {
+				if(i + 1 >= argc) throw std::runtime_error("Missing value for " + arg);
+				return argv[++i];
+			};
+
+			if(arg == "--filter") options.filter = next();
+			else if(arg == "--samples") options.samples = std::stoi(next());
+			else if(arg == "--min-time") options.minSampleTime = std::stod(next()) / 1000;
+			else if(arg == "--format") options.format = next();
+			else if(arg == "--list") {
+				for(const auto& benchmark : benchmarks) {
+					printf("%s\n", benchmark.name.c_str());
+				}
+				return 0;
+			} else if(arg == "--help" || arg == "-h") {
+				PrintUsage();
+				return 0;
+			} else throw std::runtime_error("Unknown option " + arg);
+		}
+		if(options.samples < 2 || options.minSampleTime <= 0) {
+			throw std::runtime_error("Need at least 2 samples and a positive sample time");
+		}
+	} catch(std::exception& e) {
+		fprintf(stderr, "error: %s\n", e.what());
+		PrintUsage();
+		return 1;
+	}
+
+	const bool table = options.format == "table";
+	if(table) {
+		PrintTableHeader();
+	}
+
+	std::vector<Result> results;
+	for(const auto& benchmark : benchmarks) {
+		if(benchmark.name.find(options.filter) == std::string::npos) continue;
+
+		results.push_back(Measure(benchmark, options));
+		if(table) {
+			PrintTableRow(results.back());
+		}
+	}
+
+	if(options.format == "json") {
+		PrintJson(results);
+	} else if(options.format == "csv") {
+		PrintCsv(results);
+	}
+
+	return 0;
+}
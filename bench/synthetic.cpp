@@ -0,0 +1,219 @@
+#include "synthetic.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "Emulation/NES/Mappers/Mapper000.h"
+
+namespace Synthetic {
+
+// the labels are the addresses the program runs at
+static const uint8_t nesFrameProgram[] = {
+	// reset: $8000
+	0x78,                  // SEI
+	0xD8,                  // CLD
+	0xA2, 0xFF,            // LDX #$FF
+	0x9A,                  // TXS
+	// vw1: $8005
+	0x2C, 0x02, 0x20,      // BIT $2002
+	0x10, 0xFB,            // BPL vw1
+	// vw2: $800A
+	0x2C, 0x02, 0x20,      // BIT $2002
+	0x10, 0xFB,            // BPL vw2
+	0xA9, 0x3F,            // LDA #$3F
+	0x8D, 0x06, 0x20,      // STA $2006
+	0xA9, 0x00,            // LDA #$00
+	0x8D, 0x06, 0x20,      // STA $2006
+	0xA2, 0x00,            // LDX #$00
+	// pal: $801B
+	0x8A,                  // TXA
+	0x8D, 0x07, 0x20,      // STA $2007
+	0xE8,                  // INX
+	0xE0, 0x20,            // CPX #$20
+	0xD0, 0xF7,            // BNE pal
+	0xA9, 0x20,            // LDA #$20
+	0x8D, 0x06, 0x20,      // STA $2006
+	0xA9, 0x00,            // LDA #$00
+	0x8D, 0x06, 0x20,      // STA $2006
+	0xA0, 0x08,            // LDY #$08
+	// nt: $8030
+	0x8A,                  // TXA
+	0x8D, 0x07, 0x20,      // STA $2007
+	0xE8,                  // INX
+	0xD0, 0xF9,            // BNE nt
+	0x88,                  // DEY
+	0xD0, 0xF6,            // BNE nt
+	// spr: $803A
+	0x8A,                  // TXA
+	0x9D, 0x00, 0x02,      // STA $0200,X
+	0xE8,                  // INX
+	0xD0, 0xF9,            // BNE spr
+	0xA9, 0x0F,            // LDA #$0F
+	0x8D, 0x15, 0x40,      // STA $4015
+	0xA9, 0xBF,            // LDA #$BF
+	0x8D, 0x00, 0x40,      // STA $4000
+	0xA9, 0x50,            // LDA #$50
+	0x8D, 0x02, 0x40,      // STA $4002
+	0xA9, 0x01,            // LDA #$01
+	0x8D, 0x03, 0x40,      // STA $4003
+	0xA9, 0x1F,            // LDA #$1F
+	0x8D, 0x0C, 0x40,      // STA $400C
+	0xA9, 0x03,            // LDA #$03
+	0x8D, 0x0E, 0x40,      // STA $400E
+	0xA9, 0x08,            // LDA #$08
+	0x8D, 0x0F, 0x40,      // STA $400F
+	0xA9, 0x80,            // LDA #$80
+	0x8D, 0x00, 0x20,      // STA $2000
+	0xA9, 0x1E,            // LDA #$1E
+	0x8D, 0x01, 0x20,      // STA $2001
+	// main: $806E
+	0xE6, 0x10,            // INC $10
+	0xA6, 0x10,            // LDX $10
+	0xBD, 0x00, 0x03,      // LDA $0300,X
+	0x65, 0x10,            // ADC $10
+	0x9D, 0x00, 0x03,      // STA $0300,X
+	0x4C, 0x6E, 0x80,      // JMP main
+	// nmi: $807D
+	0x48,                  // PHA
+	0xA9, 0x02,            // LDA #$02
+	0x8D, 0x14, 0x40,      // STA $4014
+	0xE6, 0x12,            // INC $12
+	0xA5, 0x12,            // LDA $12
+	0x8D, 0x05, 0x20,      // STA $2005
+	0x8D, 0x05, 0x20,      // STA $2005
+	0x8D, 0x02, 0x40,      // STA $4002
+	0xEE, 0x00, 0x02,      // INC $0200
+	0xEE, 0x03, 0x02,      // INC $0203
+	0x68,                  // PLA
+	0x40,                  // RTI
+	// irq: $8098
+	0x40,                  // RTI
+};
+
+// entry point jumps here
+static const uint8_t gbProgram[] = {
+	// $0150
+	0x31, 0xFE, 0xFF, // LD SP,$FFFE
+	0x3E, 0x80,       // LD A,$80
+	0xE0, 0x26,       // LDH (NR52),A
+	0x3E, 0x77,       // LD A,$77
+	0xE0, 0x24,       // LDH (NR50),A
+	0x3E, 0xFF,       // LD A,$FF
+	0xE0, 0x25,       // LDH (NR51),A
+	0x3E, 0xF0,       // LD A,$F0
+	0xE0, 0x12,       // LDH (NR12),A
+	0x3E, 0x87,       // LD A,$87
+	0xE0, 0x14,       // LDH (NR14),A
+	0x3E, 0xE4,       // LD A,$E4
+	0xE0, 0x47,       // LDH (BGP),A
+	0x3E, 0x93,       // LD A,$93
+	0xE0, 0x40,       // LDH (LCDC),A
+	// loop: $016F
+	0x21, 0x00, 0x80, // LD HL,$8000
+	// fill: $0172
+	0x7E,             // LD A,(HL)
+	0x3C,             // INC A
+	0x22,             // LD (HL+),A
+	0x7C,             // LD A,H
+	0xFE, 0x98,       // CP $98
+	0x20, 0xF8,       // JR NZ,fill
+	0xF0, 0x42,       // LDH A,(SCY)
+	0x3C,             // INC A
+	0xE0, 0x42,       // LDH (SCY),A
+	0x18, 0xEE,       // JR loop
+};
+
+// loaded at $200
+static const uint8_t chip8Program[] = {
+	0x00, 0xE0, // CLS
+	0x60, 0x00, // V0 = 0
+	0x61, 0x00, // V1 = 0
+	0x62, 0x00, // V2 = 0
+	// loop: $208
+	0xF2, 0x29, // I = font V2
+	0xD0, 0x15, // draw V0, V1, 5
+	0x70, 0x08, // V0 += 8
+	0x72, 0x01, // V2 += 1
+	0x40, 0x40, // skip if V0 != 64
+	0x71, 0x06, // V1 += 6
+	0x40, 0x40, // skip if V0 != 64
+	0x60, 0x00, // V0 = 0
+	0x41, 0x1E, // skip if V1 != 30
+	0x61, 0x00, // V1 = 0
+	0x12, 0x08, // jump loop
+};
+
+// tiles with some variation so the pattern fetches aren't all the same
+static std::vector<uint8_t> NesChr() {
+	std::vector<uint8_t> chr(0x2000);
+	uint32_t x = 1;
+	for(auto& val : chr) {
+		x = x * 1103515245 + 12345;
+		val = x >> 16;
+	}
+	return chr;
+}
+
+Nes::Rom NesRom(const std::vector<uint8_t>& program, uint16_t nmi, uint16_t irq) {
+	std::vector<uint8_t> prg(0x8000, 0xEA);
+	assert(program.size() <= 0x7FFA);
+	std::copy(program.begin(), program.end(), prg.begin());
+
+	const uint16_t vectors[] = { nmi, 0x8000, irq };
+	for(int i = 0; i < 3; i++) {
+		prg[0x7FFA + i * 2] = vectors[i] & 0xFF;
+		prg[0x7FFB + i * 2] = vectors[i] >> 8;
+	}
+
+	return Nes::Rom::FromData(prg, NesChr());
+}
+
+Nes::Rom NesRom() {
+	return NesRom({ std::begin(nesFrameProgram), std::end(nesFrameProgram) }, 0x807D, 0x8098);
+}
+
+std::shared_ptr<Nes::Mapper> NesCart(const std::vector<uint8_t>& program, uint16_t nmi, uint16_t irq) {
+	return std::make_shared<Nes::Mapper000>(NesRom(program, nmi, irq));
+}
+
+std::shared_ptr<Nes::Mapper> NesCart() {
+	return std::make_shared<Nes::Mapper000>(NesRom());
+}
+
+std::vector<uint8_t> GameboyRom() {
+	static const uint8_t logo[] = {
+		0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B, 0x03, 0x73, 0x00, 0x83, 0x00, 0x0C, 0x00, 0x0D,
+		0x00, 0x08, 0x11, 0x1F, 0x88, 0x89, 0x00, 0x0E, 0xDC, 0xCC, 0x6E, 0xE6, 0xDD, 0xDD, 0xD9, 0x99,
+		0xBB, 0xBB, 0x67, 0x63, 0x6E, 0x0E, 0xEC, 0xCC, 0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E
+	};
+
+	std::vector<uint8_t> rom(0x8000);
+	// entry point: NOP, JP $0150
+	const uint8_t entry[] = { 0x00, 0xC3, 0x50, 0x01 };
+	std::copy(std::begin(entry), std::end(entry), rom.begin() + 0x100);
+	std::copy(std::begin(logo), std::end(logo), rom.begin() + 0x104);
+
+	const char title[] = "EMU-BENCH";
+	std::copy(title, title + strlen(title), rom.begin() + 0x134);
+
+	// ROM only, 32KB, no ram
+	rom[0x147] = 0;
+	rom[0x148] = 0;
+	rom[0x149] = 0;
+
+	uint8_t checksum = 0;
+	for(int i = 0x134; i <= 0x14C; i++) {
+		checksum = checksum - rom[i] - 1;
+	}
+	rom[0x14D] = checksum;
+
+	std::copy(std::begin(gbProgram), std::end(gbProgram), rom.begin() + 0x150);
+	return rom;
+}
+
+std::vector<uint8_t> Chip8Rom() {
+	return { std::begin(chip8Program), std::end(chip8Program) };
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Emulation/NES/Mappers/Mapper.h"
+
+// Small generated roms so the benchmarks don't need any games
+namespace Synthetic {
+
+// NROM rom with program at $8000, which is also the reset vector
+Nes::Rom NesRom(const std::vector<uint8_t>& program, uint16_t nmi, uint16_t irq);
+// keeps the ppu rendering with sprites, runs two apu channels, does an oam dma and scrolls every frame
+Nes::Rom NesRom();
+
+// NROM cartridges of the roms above
+std::shared_ptr<Nes::Mapper> NesCart(const std::vector<uint8_t>& program, uint16_t nmi, uint16_t irq);
+std::shared_ptr<Nes::Mapper> NesCart();
+
+// ROM only cartridge that turns the lcd and channel 1 on and then keeps rewriting tile data and scrolling
+std::vector<uint8_t> GameboyRom();
+
+// draws the font over the whole screen
+std::vector<uint8_t> Chip8Rom();
+
+}
@@ -0,0 +1,194 @@
+#include "systems.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Emulation/CHIP-8/chip8.h"
+#include "Emulation/GB/Cartridge.h"
+#include "Emulation/GB/Gameboy.h"
+#include "Emulation/NES/Bus.h"
+#include "Emulation/NES/Cartridge.h"
+#include "Emulation/NES/StandardController.h"
+#include "fs.h"
+
+#include "synthetic.h"
+
+class NesSystem : public HeadlessSystem {
+  private:
+	Framebuffer texture { 256, 240 };
+	std::unique_ptr<Nes::Bus> bus = std::make_unique<Nes::Bus>();
+	std::shared_ptr<Nes::StandardController> controllers[2] {
+		std::make_shared<Nes::StandardController>(),
+		std::make_shared<Nes::StandardController>()
+	};
+
+  public:
+	NesSystem(std::shared_ptr<Nes::Mapper> cart, const SystemOptions& options) {
+		bus->ppu.texture = &texture;
+		texture.SetPalette(Nes::ppu2C02::colors, 64);
+
+		bus->controller1 = controllers[0];
+		bus->controller2 = controllers[1];
+
+		bus->InsertCartridge(cart);
+		bus->HardReset();
+
+		bus->SetPpuSync(options.catchUp ? Nes::PpuSync::CatchUp : Nes::PpuSync::Lockstep);
+		bus->SetCpuCore(options.instructionCore ? Nes::CpuCore::Instruction : Nes::CpuCore::Cycle);
+		bus->ppu.render = options.render;
+	}
+
+	void RunFrame() override {
+		bus->RunFrame();
+		bus->ppu.frameComplete = false;
+		bus->apu.EndFrame();
+	}
+	uint64_t Cycles() const override { return bus->systemClockCounter; }
+	uint64_t Instructions() const override { return bus->cpu.instructionCount; }
+
+	void SetInput(size_t port, uint32_t value) override {
+		if(port < 2) {
+			controllers[port]->buttons = value;
+		}
+	}
+	void SetSampleSink(Audio::SampleSink sink) override { bus->apu.SetSampleSink(sink); }
+	int SampleRate() const override { return Nes::RP2A03::sampleRate; }
+	const Framebuffer& Screen() override { return texture; }
+
+	void SaveState(saver& saver) override { bus->SaveState(saver); }
+	void LoadState(saver& saver) override { bus->LoadState(saver); }
+};
+
+class GameboySystem : public HeadlessSystem {
+  private:
+	Framebuffer texture { 160, 144 };
+	std::unique_ptr<Gameboy::Gameboy> gameboy = std::make_unique<Gameboy::Gameboy>(texture);
+	uint64_t cycles = 0;
+
+  public:
+	GameboySystem(const RomData& rom, const SystemOptions& options) {
+		Gameboy::Mode mode;
+		gameboy->InsertCartridge(Gameboy::LoadCart(rom, mode));
+		gameboy->Reset(mode);
+		gameboy->SetRender(options.render);
+	}
+
+	void RunFrame() override {
+		const auto frameCycles = 4194304 / 60.0;
+		const auto start = gameboy->cyclesPassed;
+
+		while(gameboy->cyclesPassed < frameCycles) {
+			gameboy->Clock();
+		}
+		cycles += (uint64_t)(gameboy->cyclesPassed - start);
+		gameboy->cyclesPassed -= frameCycles;
+		gameboy->EndFrame();
+	}
+	uint64_t Cycles() const override { return cycles; }
+	uint64_t Instructions() const override { return gameboy->InstructionCount(); }
+
+	void SetInput(size_t port, uint32_t value) override {
+		if(port == 0) {
+			gameboy->buttons = value;
+		}
+	}
+	void SetSampleSink(Audio::SampleSink sink) override { gameboy->SetSampleSink(sink); }
+	int SampleRate() const override { return Gameboy::APU::sampleRate; }
+	const Framebuffer& Screen() override { return texture; }
+
+	void SaveState(saver& saver) override { gameboy->SaveState(saver); }
+	void LoadState(saver& saver) override { gameboy->LoadState(saver); }
+};
+
+class Chip8System : public HeadlessSystem {
+  private:
+	Chip8::Chip8 emulator;
+	Framebuffer texture { 64, 32 };
+	uint64_t instructions = 0;
+
+  public:
+	Chip8System(const RomData& rom) {
+		const Color palette[] = { { 0, 0, 0 }, { 255, 255, 255 } };
+		texture.SetPalette(palette, 2);
+
+		emulator.LoadRom(rom);
+	}
+
+	void RunFrame() override {
+		// target clock rate 540hz/60 = 9
+		for(int i = 0; i < 9; i++) {
+			emulator.Clock();
+		}
+		instructions += 9;
+
+		if(emulator.delay_timer > 0) {
+			emulator.delay_timer--;
+		}
+		if(emulator.sound_timer > 0) {
+			emulator.sound_timer--;
+		}
+	}
+	// every instruction is one clock
+	uint64_t Cycles() const override { return instructions; }
+	uint64_t Instructions() const override { return instructions; }
+
+	void SetInput(size_t port, uint32_t value) override {
+		if(port == 0) {
+			emulator.keys = value;
+		}
+	}
+	// the beep is made up by the frontend
+	void SetSampleSink(Audio::SampleSink sink) override {}
+	int SampleRate() const override { return 0; }
+	const Framebuffer& Screen() override {
+		for(int y = 0; y < 32; ++y) {
+			std::copy_n(&emulator.gfx[y * 64], 64, texture.IndexLine(y));
+		}
+		return texture;
+	}
+
+	void SaveState(saver& saver) override { emulator.SaveState(saver); }
+	void LoadState(saver& saver) override { emulator.LoadState(saver); }
+};
+
+std::string GuessSystem(const std::string& path) {
+	auto ext = fs::path(path).extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+
+	if(ext == ".nes") return "nes";
+	if(ext == ".gb" || ext == ".gbc") return "gb";
+	if(ext == ".ch8" || ext == ".c8") return "chip8";
+	throw std::runtime_error("Can't tell the system of " + path + ", use --system");
+}
+
+SystemRom LoadSystemRom(const std::string& system, const std::string& path) {
+	SystemRom rom { system, {}, nullptr };
+
+	if(system == "nes") {
+		if(path.empty()) {
+			auto cart = std::make_shared<Nes::CartImage>();
+			cart->rom = Synthetic::NesRom();
+			rom.cart = cart;
+		} else {
+			rom.file = RomData::Load(path);
+			rom.cart = std::make_shared<Nes::CartImage>(Nes::LoadCartImage(rom.file));
+		}
+	} else if(system == "gb") {
+		rom.file = path.empty() ? Synthetic::GameboyRom() : RomData::Load(path);
+	} else if(system == "chip8") {
+		rom.file = path.empty() ? Synthetic::Chip8Rom() : RomData::Load(path);
+	} else {
+		throw std::runtime_error("Unknown system " + system);
+	}
+	return rom;
+}
+
+std::unique_ptr<HeadlessSystem> CreateSystem(const SystemRom& rom, const SystemOptions& options) {
+	if(rom.system == "nes") {
+		return std::make_unique<NesSystem>(Nes::CreateMapper(*rom.cart), options);
+	}
+	if(rom.system == "gb") {
+		return std::make_unique<GameboySystem>(rom.file, options);
+	}
+	return std::make_unique<Chip8System>(rom.file);
+}
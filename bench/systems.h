@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Framebuffer.h"
+#include "RomData.h"
+#include "audioSink.h"
+#include "saver.h"
+
+namespace Nes {
+struct CartImage;
+}
+
+// The cores wrapped behind one interface so the headless tools can drive any of them a frame at a time.
+// Every instance owns all of its state, battery backed ram included, so different instances can run on different threads
+class HeadlessSystem {
+  public:
+	virtual ~HeadlessSystem() = default;
+
+	virtual void RunFrame() = 0;
+	// master clock ticks since power on
+	virtual uint64_t Cycles() const = 0;
+	virtual uint64_t Instructions() const = 0;
+
+	// nes: one StandardController per port, gb: port 0 with the layout of Gameboy::buttons, chip8: port 0 with one bit per key
+	virtual void SetInput(size_t port, uint32_t value) = 0;
+	virtual void SetSampleSink(Audio::SampleSink sink) = 0;
+	// 0 if the system makes no sound
+	virtual int SampleRate() const = 0;
+	virtual const Framebuffer& Screen() = 0;
+
+	virtual void SaveState(saver& saver) = 0;
+	virtual void LoadState(saver& saver) = 0;
+};
+
+struct SystemOptions {
+	// nes: catch the ppu up instead of running it in lockstep
+	bool catchUp = false;
+	// nes: run whole cpu instructions at once
+	bool instructionCore = false;
+	// nes, gb: draw pixels, the emulation is the same without them
+	bool render = true;
+};
+
+// A rom loaded once and shared read only by every system created from it
+struct SystemRom {
+	std::string system;
+	RomData file;
+	// nes: the parsed cartridge
+	std::shared_ptr<const Nes::CartImage> cart;
+};
+
+// nes, gb or chip8 from the extension of path
+std::string GuessSystem(const std::string& path);
+// the synthetic rom of system if path is empty
+SystemRom LoadSystemRom(const std::string& system, const std::string& path);
+
+std::unique_ptr<HeadlessSystem> CreateSystem(const SystemRom& rom, const SystemOptions& options = {});
+inline std::unique_ptr<HeadlessSystem> CreateSystem(const std::string& system, const std::string& path, const SystemOptions& options = {}) {
+	return CreateSystem(LoadSystemRom(system, path), options);
+}
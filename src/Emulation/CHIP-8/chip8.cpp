@@ -1,10 +1,10 @@
 #include "chip8.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
-#include <fstream>
+#include <stdexcept>
 
-#include "../../Input.h"
 
 static const uint8_t chip8_fontset[] = {
 	0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
@@ -32,14 +32,15 @@ Chip8::Chip8() {
 }
 
 void Chip8::LoadRom(const std::string& path) {
-	std::ifstream stream(path, std::ios::binary | std::ios::ate);
-	auto len = stream.tellg();
-	if(len > 0x1000 - 0x200) {
+	LoadRom(RomData::Load(path));
+}
+
+void Chip8::LoadRom(const RomData& rom) {
+	if(rom.size() > 0x1000 - 0x200) {
 		throw std::runtime_error("File too big");
 	}
 
-	stream.seekg(0, std::ios::beg);
-	stream.read((char*)&memory[0x200], len);
+	std::copy(rom.begin(), rom.end(), memory.begin() + 0x200);
 }
 
 void Chip8::Reset() {
@@ -172,12 +173,12 @@ void Chip8::Clock() {
 		case 0xE000:
 			switch(opcode & 0xFF) {
 				case 0x9E:
-					if(Input::Chip8.GetKey(vx)) {
+					if(GetKey(vx)) {
 						PC += 2;
 					}
 					break;
 				case 0xA1:
-					if(!Input::Chip8.GetKey(vx)) {
+					if(!GetKey(vx)) {
 						PC += 2;
 					}
 					break;
@@ -193,7 +194,7 @@ void Chip8::Clock() {
 				case 0x0A: {
 					bool hasInput = false;
 					for(int i = 0; i < 16; i++) {
-						if(Input::Chip8.GetKey(i)) {
+						if(GetKey(i)) {
 							hasInput = true;
 							vx = i;
 							break;
@@ -241,4 +242,24 @@ void Chip8::Clock() {
 	}
 }
 
+void Chip8::SaveState(saver& saver) {
+	saver << V;
+	saver << memory;
+	saver << I << PC;
+	saver << delay_timer << sound_timer;
+	saver << SP;
+	saver << stack;
+	saver << gfx;
+}
+
+void Chip8::LoadState(saver& saver) {
+	saver >> V;
+	saver >> memory;
+	saver >> I >> PC;
+	saver >> delay_timer >> sound_timer;
+	saver >> SP;
+	saver >> stack;
+	saver >> gfx;
+}
+
 }
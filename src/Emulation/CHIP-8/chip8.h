@@ -1,7 +1,11 @@
 #pragma once
 #include <array>
+#include <cstdint>
 #include <string>
 
+#include "../../RomData.h"
+#include "../../saver.h"
+
 namespace Chip8 {
 
 struct Chip8 {
@@ -16,13 +20,22 @@ struct Chip8 {
 
 	uint8_t gfx[64 * 32];
 
+	// one bit per key 0-F. Set by the frontend
+	uint16_t keys = 0;
+
+	bool GetKey(uint8_t key) const { return key < 16 && (keys >> key & 1); }
+
   public:
 	Chip8();
 
 	void LoadRom(const std::string& path);
+	void LoadRom(const RomData& rom);
 
 	void Reset();
 	void Clock();
+
+	void SaveState(saver& saver);
+	void LoadState(saver& saver);
 };
 
 }
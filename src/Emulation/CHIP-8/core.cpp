@@ -1,5 +1,7 @@
 #include "core.h"
 
+#include <algorithm>
+
 #define _USE_MATH_DEFINES
 #include <math.h>
 
@@ -10,7 +12,10 @@
 
 namespace Chip8 {
 
-Core::Core() : texture(64, 32), disassembler(emulator) { }
+Core::Core() : texture(64, 32), disassembler(emulator) {
+	const Color palette[] = { { 0, 0, 0 }, { 255, 255, 255 } };
+	texture.SetPalette(palette, 2);
+}
 
 std::vector<MemoryDomain> Core::GetMemoryDomains() {
 	return {
@@ -49,25 +54,19 @@ void Core::DrawMenuBar(bool& menuOpen) {
 }
 
 void Core::SaveState(saver& saver) {
-	saver << emulator.V;
-	saver << emulator.memory;
-	saver << emulator.I << emulator.PC;
-	saver << emulator.delay_timer << emulator.sound_timer;
-	saver << emulator.SP;
-	saver << emulator.stack;
-	saver << emulator.gfx;
+	emulator.SaveState(saver);
 }
 void Core::LoadState(saver& saver) {
-	saver >> emulator.V;
-	saver >> emulator.memory;
-	saver >> emulator.I >> emulator.PC;
-	saver >> emulator.delay_timer >> emulator.sound_timer;
-	saver >> emulator.SP;
-	saver >> emulator.stack;
-	saver >> emulator.gfx;
+	emulator.LoadState(saver);
 }
 
 void Core::Update() {
+	uint16_t keys = 0;
+	for(int i = 0; i < 16; i++) {
+		keys |= Input::Chip8.GetKey(i) << i;
+	}
+	emulator.keys = keys;
+
 	// target clock rate 540hz/60 = 9
 	for(int i = 0; i < 9; i++) {
 		emulator.Clock();
@@ -78,7 +77,8 @@ void Core::Update() {
 
 	if(emulator.sound_timer > 0) {
 		emulator.sound_timer--;
-		if(emulator.sound_timer == 0) {
+		// the beep isn't part of the save state, frames without audio must not touch it
+		if(emulator.sound_timer == 0 && audioOutput) {
 			// beep should play for 200 ms
 			// 200ms / 16.66ms = 12 frames
 			beepFrames = 12;
@@ -86,7 +86,7 @@ void Core::Update() {
 		}
 	}
 
-	if(beepFrames > 0) {
+	if(beepFrames > 0 && audioOutput) {
 		// beep plays at 800hz
 		const auto frac = (M_PI * 800 * 2) / (735 * 60);
 		for(int i = 0; i < 735; ++i) {
@@ -96,12 +96,10 @@ void Core::Update() {
 		beepFrames--;
 	}
 
-	Color black { 0, 0, 0 };
-	Color white { 255, 255, 255 };
-
-	for(int y = 0; y < 32; ++y) {
-		for(int x = 0; x < 64; ++x) {
-			texture.SetPixel(x, y, emulator.gfx[x + y * 64] ? white : black);
+	if(videoOutput) {
+		// gfx only holds 0 and 1 which index the palette set in the constructor
+		for(int y = 0; y < 32; ++y) {
+			std::copy_n(&emulator.gfx[y * 64], 64, texture.IndexLine(y));
 		}
 	}
 }
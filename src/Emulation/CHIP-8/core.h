@@ -1,8 +1,7 @@
 #pragma once
 #include "../ICore.h"
 
-#include <fstream>
-
+#include "../../RomData.h"
 #include "chip8.h"
 #include "disassembler.h"
 
@@ -18,6 +17,9 @@ class Core : public ICore {
 	int beepFrames = 12;
 	int beepPos = 0;
 
+	bool videoOutput = true;
+	bool audioOutput = true;
+
 	DisassemblerWindow disassembler;
 
   public:
@@ -41,13 +43,14 @@ class Core : public ICore {
 	void SaveState(saver& saver) override;
 	void LoadState(saver& saver) override;
 
-	void LoadRom(const std::string& path) override {
+	void LoadRom(const std::string& path, bool persistSaveRam) override {
+		const auto rom = RomData::Load(path);
+
 		emulator.Reset();
-		emulator.LoadRom(path);
+		emulator.LoadRom(rom);
 		disassembler.Update();
 
-		std::ifstream file(path, std::ios::binary);
-		currentFileHash = md5(file);
+		currentFileHash = md5((const char*)rom.data(), rom.size());
 
 		currentFile = path;
 	}
@@ -61,6 +64,12 @@ class Core : public ICore {
 		emulator.LoadRom(currentFile);
 	}
 	void Update() override;
+
+	void SetOutput(bool video, bool audio) override {
+		videoOutput = video;
+		audioOutput = audio;
+	}
+	RenderImage& Screen() override { return texture; }
 };
 
 }
\ No newline at end of file
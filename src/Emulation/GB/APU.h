@@ -1,7 +1,9 @@
 #pragma once
 #include <cstdint>
+#include <iterator>
 
-#include "../../audio.h"
+#include "../../audioSink.h"
+#include "../../blipBuffer.h"
 
 namespace Gameboy {
 
@@ -12,6 +14,39 @@ const uint8_t WAVE_DUTY_TABLE[4][8] = {
 	{ 1, 1, 1, 1, 1, 1, 0, 0 }
 };
 
+// The channel timers count down to 0 and reload with period on the following tick.
+// Instead of ticking them every cycle they are run to whenever something needs their state
+
+// Number of reloads in the next ticks of a timer at timer
+inline uint32_t TimerSteps(uint16_t timer, uint32_t period, uint32_t ticks) {
+	if(ticks <= timer) return 0;
+	return 1 + (ticks - timer - 1) / period;
+}
+
+// Runs timer for ticks and calls step(tick) on every reload, tick counted from the start of the run
+template<typename F>
+void RunTimer(uint16_t& timer, uint32_t period, uint32_t ticks, F step) {
+	uint32_t tick = 0;
+	while(ticks - tick > timer) {
+		tick += timer;
+		timer = period - 1;
+		step(tick);
+		tick++;
+	}
+	timer -= ticks - tick;
+}
+
+// Same as RunTimer without the callback. Returns the number of reloads
+inline uint32_t SkipTimer(uint16_t& timer, uint32_t period, uint32_t ticks) {
+	const auto steps = TimerSteps(timer, period, ticks);
+	if(steps == 0) {
+		timer -= ticks;
+	} else {
+		timer = period - 1 - (ticks - timer - 1) % period;
+	}
+	return steps;
+}
+
 struct Length {
 	uint16_t lengthCounter;
 
@@ -127,18 +162,32 @@ struct SquareBase : Envelope, Length {
 		frequency = (frequency & ~0xFF) | data;
 	}
 
-	void clock() {
-		if(freqTimer == 0) {
-			freqTimer = 2048 - frequency;
-			wavePos = (wavePos + 1) & 7;
-		}
+	// wavePos after ticks more cycles
+	uint8_t positionAfter(uint32_t ticks) const {
+		return (wavePos + TimerSteps(freqTimer, 2048 - frequency, ticks)) & 7;
+	}
 
-		freqTimer--;
+	// step(tick) is called on every change of the output
+	template<typename F>
+	void run(uint32_t ticks, F step) {
+		RunTimer(freqTimer, 2048 - frequency, ticks, [&](uint32_t tick) {
+			const auto last = WAVE_DUTY_TABLE[soundPattern][wavePos];
+			wavePos = (wavePos + 1) & 7;
+			if(WAVE_DUTY_TABLE[soundPattern][wavePos] != last) step(tick);
+		});
+	}
+	void skip(uint32_t ticks) {
+		wavePos = (wavePos + SkipTimer(freqTimer, 2048 - frequency, ticks)) & 7;
+	}
+	// nothing changes the output until the next register write or frame sequencer step
+	bool steady() const {
+		return !dacEnabled || !channelEnabled || envVolume == 0;
 	}
 
-	float output() {
+	// -15 to 15 from the dac, 0 while it is off
+	int8_t level() const {
 		if(dacEnabled && channelEnabled) {
-			return (WAVE_DUTY_TABLE[soundPattern][wavePos] * envVolume) / 7.5 - 1;
+			return WAVE_DUTY_TABLE[soundPattern][wavePos] * envVolume * 2 - 15;
 		}
 		return 0;
 	}
@@ -233,21 +282,26 @@ struct Wave : Length {
 	uint8_t outputLevel;
 	uint8_t wavePos;
 
-	void clock() {
-		if(freqTimer == 0) {
-			freqTimer = 2048 - frequency;
-			wavePos = (wavePos + 1) & 31;
-		}
-		freqTimer--;
+	// the timer ticks twice per cycle
+	uint8_t positionAfter(uint32_t ticks) const {
+		return (wavePos + TimerSteps(freqTimer, 2048 - frequency, ticks * 2)) & 31;
+	}
 
-		if(freqTimer == 0) {
-			freqTimer = 2048 - frequency;
+	template<typename F>
+	void run(uint32_t ticks, F step) {
+		RunTimer(freqTimer, 2048 - frequency, ticks * 2, [&](uint32_t tick) {
 			wavePos = (wavePos + 1) & 31;
-		}
-		freqTimer--;
+			step(tick / 2);
+		});
+	}
+	void skip(uint32_t ticks) {
+		wavePos = (wavePos + SkipTimer(freqTimer, 2048 - frequency, ticks * 2)) & 31;
+	}
+	bool steady() const {
+		return !dacEnabled || !channelEnabled || outputLevel == 0;
 	}
 
-	float output() {
+	int8_t level() const {
 		// TODO: not channelEnabled?
 		if(dacEnabled && channelEnabled) {
 			auto sample = (waveRam[wavePos / 2] >> (wavePos & 1 ? 4 : 0)) & 0xF;
@@ -258,7 +312,7 @@ struct Wave : Length {
 				case 2: volumeShift = 1; break;
 				case 3: volumeShift = 2; break;
 			}
-			return (sample >> volumeShift) / 7.5 - 1;
+			return (sample >> volumeShift) * 2 - 15;
 		}
 		return 0;
 	}
@@ -293,21 +347,29 @@ struct Noise : Envelope, Length {
 		shiftClock = data >> 4;
 	}
 
-	void clock() {
-		if(freqTimer == 0) {
-			freqTimer = (divider == 0 ? 2 : divider << 2) << shiftClock;
+	// the lfsr has to be stepped even while nothing listens
+	template<typename F>
+	void run(uint32_t ticks, F step) {
+		// periods above 0xFFFF get cut off by the 16 bit timer
+		const uint16_t period = (divider == 0 ? 2 : divider << 2) << shiftClock;
 
+		RunTimer(freqTimer, period ? period : 0x10000, ticks, [&](uint32_t tick) {
 			auto mask = counterStep ? 0x4040 : 0x4000;
 			auto newHigh = (lfsr ^ (lfsr >> 1)) & 1;
+			auto last = lfsr & 1;
 			lfsr >>= 1;
 			lfsr = newHigh ? lfsr | mask : lfsr & ~mask;
-		}
-		freqTimer--;
+
+			if((lfsr & 1) != last) step(tick);
+		});
+	}
+	bool steady() const {
+		return !dacEnabled || !channelEnabled || envVolume == 0;
 	}
 
-	float output() {
+	int8_t level() const {
 		if(dacEnabled && channelEnabled) {
-			return ((!(lfsr & 1)) * envVolume) / 7.5f - 1;
+			return (!(lfsr & 1)) * envVolume * 2 - 15;
 		}
 		return 0;
 	}
@@ -334,21 +396,51 @@ struct Noise : Envelope, Length {
 
 class APU {
   private:
-	Square1 ch1;
-	Square2 ch2;
-	Wave ch3;
-	Noise ch4;
-
-	uint16_t cycles;
-	uint16_t fsStep;
-	uint16_t sampleCounter;
-	uint8_t nr50;
-	uint8_t nr51;
-	bool enabled;
+	// reset doesn't touch every register, zero the rest so equal runs produce equal samples
+	Square1 ch1 {};
+	Square2 ch2 {};
+	Wave ch3 {};
+	Noise ch4 {};
+
+	uint16_t cycles = 0;
+	uint16_t fsStep = 0;
+	uint8_t nr50 = 0;
+	uint8_t nr51 = 0;
+	bool enabled = false;
+
+	// cycles since the last endFrame and up to which the channels have been run
+	uint32_t time = 0;
+	uint32_t channelTime = 0;
+
+	// level of every channel and amplitude of both sides that were last sent to blip
+	int8_t levels[4] {};
+	int32_t amplitude[2] {};
+	BlipBuffer blip[2] {
+		{ clockRate, sampleRate, sampleRate / 10 },
+		{ clockRate, sampleRate, sampleRate / 10 },
+	};
+
+	// receives the samples at sampleRate whenever a frame ends
+	Audio::SampleSink sampleSink;
 
   public:
+	// the apu is clocked once per cycle, at double speed as well
+	static constexpr int clockRate = 4194304 / 4;
+	static constexpr int sampleRate = 44100;
+	// amplitude of one dac step at full volume
+	static constexpr int32_t levelAmplitude = BlipBuffer::one / (15 * 4 * 7);
+
 	bool gbc;
 
+	// Nothing is mixed while no sink is connected, connecting one mixes the current levels again
+	void setSampleSink(Audio::SampleSink sink) {
+		const bool reconnect = sink.Connected() && !sampleSink.Connected();
+		// the channels up to now were skipped without a sink
+		catchUp();
+		sampleSink = sink;
+		if(reconnect) updateOutput();
+	}
+
 	uint8_t read(uint16_t address) const {
 		// printf("%04X read\n", address);
 
@@ -386,7 +478,7 @@ class APU {
 					   enabled << 7;
 			case 0xFF30: case 0xFF31: case 0xFF32: case 0xFF33: case 0xFF34: case 0xFF35: case 0xFF36: case 0xFF37:
 			case 0xFF38: case 0xFF39: case 0xFF3A: case 0xFF3B: case 0xFF3C: case 0xFF3D: case 0xFF3E: case 0xFF3F:
-				return ch3.channelEnabled ? ch3.waveRam[ch3.wavePos / 2] : ch3.waveRam[address - 0xFF30];
+				return ch3.channelEnabled ? ch3.waveRam[ch3.positionAfter(pendingTicks()) / 2] : ch3.waveRam[address - 0xFF30];
 		}
 
 		return 0;
@@ -397,10 +489,10 @@ class APU {
 
 		uint8_t val = 0;
 		if(ch1.dacEnabled && ch1.channelEnabled) {
-			val |= (WAVE_DUTY_TABLE[ch1.soundPattern][ch1.wavePos] * ch1.envVolume) & 0xF;
+			val |= (WAVE_DUTY_TABLE[ch1.soundPattern][ch1.positionAfter(pendingTicks())] * ch1.envVolume) & 0xF;
 		}
 		if(ch2.dacEnabled && ch2.channelEnabled) {
-			val |= (WAVE_DUTY_TABLE[ch2.soundPattern][ch2.wavePos] * ch2.envVolume) << 4;
+			val |= (WAVE_DUTY_TABLE[ch2.soundPattern][ch2.positionAfter(pendingTicks())] * ch2.envVolume) << 4;
 		}
 		return val;
 	}
@@ -414,6 +506,13 @@ class APU {
 		if(!enabled && address != 0xFF26)
 			return;
 
+		catchUp();
+		writeRegister(address, data);
+		updateOutput();
+	}
+
+  private:
+	void writeRegister(uint16_t address, uint8_t data) {
 		switch(address) {
 #pragma region Sound Channel 1
 			case 0xFF10: // Sweep register
@@ -546,7 +645,7 @@ class APU {
 					ch2.wavePos = 0;
 					ch3.wavePos = 0;
 					
-					for(size_t i = 0xFF10; i < 0xFF26; i++) write(i, 0);
+					for(size_t i = 0xFF10; i < 0xFF26; i++) writeRegister(i, 0);
 				} else if(data & 0x80 && !enabled) {
 				}
 
@@ -555,16 +654,15 @@ class APU {
 		}
 	}
 
+  public:
 	void clock() {
+		time++;
 		if(!enabled) return;
 
-		ch1.clock();
-		ch2.clock();
-		ch3.clock();
-		ch4.clock();
-
 		// should be 0x1FFF but gets ticked 4 times
 		if(cycles == 0x7FF) {
+			catchUp();
+
 			switch(fsStep) {
 				case 0:
 				case 4:
@@ -589,46 +687,39 @@ class APU {
 			}
 
 			fsStep = (fsStep + 1) & 7;
+			updateOutput();
 		}
 
 		cycles = (cycles + 1) & 0x7FF;
+	}
 
-		sampleCounter++;
-		if(sampleCounter == 23) {
-			sampleCounter = 0;
-
-			auto left = 0.0;
-			auto right = 0.0;
-
-			// todo: cache output values?
-
-			if(nr51 & 0x10) left += ch1.output();
-			if(nr51 & 0x01) right += ch1.output();
-
-			if(nr51 & 0x20) left += ch2.output();
-			if(nr51 & 0x02) right += ch2.output();
-
-			if(nr51 & 0x40) left += ch3.output();
-			if(nr51 & 0x04) right += ch3.output();
-
-			if(nr51 & 0x80) left += ch4.output();
-			if(nr51 & 0x08) right += ch4.output();
-
-			auto leftVolume = (nr50 >> 4) & 7;
-			auto rightVolume = (nr50 >> 4) & 7;
+	// Runs the channels to the current cycle and sends the samples of the frame to sampleSink
+	void endFrame() {
+		catchUp();
 
-			left = (leftVolume / 7.0) * (left / 4.0);
-			right = (rightVolume / 7.0) * (right / 4.0);
+		if(sampleSink.Connected()) {
+			blip[0].EndFrame(time);
+			blip[1].EndFrame(time);
 
-			Audio::PushSample(left, right);
+			float left[512];
+			float right[512];
+			while(size_t count = blip[0].Read(left, std::size(left))) {
+				blip[1].Read(right, count);
+				for(size_t i = 0; i < count; i++) {
+					sampleSink.Push(left[i], right[i]);
+				}
+			}
 		}
+
+		time = 0;
+		channelTime = 0;
 	}
 
 	void reset() {
+		catchUp();
 		enabled = true;
 		cycles = 0;
 		fsStep = 0;
-		sampleCounter = 0;
 
 		// write(0xFF10, 0x80);
 		ch1.sweepShift = 0;
@@ -676,6 +767,8 @@ class APU {
 	}
 
 	void SaveState(saver& saver) {
+		catchUp();
+
 		ch1.Save(saver);
 		ch2.SaveSquare(saver);
 		ch3.Save(saver);
@@ -683,7 +776,6 @@ class APU {
 
 		saver << cycles;
 		saver << fsStep;
-		saver << sampleCounter;
 		saver << nr50;
 		saver << nr51;
 		saver << enabled;
@@ -696,10 +788,100 @@ class APU {
 
 		saver >> cycles;
 		saver >> fsStep;
-		saver >> sampleCounter;
 		saver >> nr50;
 		saver >> nr51;
 		saver >> enabled;
+
+		// the loaded channels are at the current cycle, the output steps from before the load to them
+		channelTime = time;
+		updateOutput();
+	}
+
+  private:
+	// cycles the channels are behind
+	uint32_t pendingTicks() const { return time - channelTime; }
+
+	// Advances the channels to the current cycle. Changes of their output are added to blip at the cycle they happened,
+	// a channel that can't change or nobody listens to is skipped over
+	void catchUp() {
+		const auto ticks = pendingTicks();
+		if(ticks == 0) return;
+
+		if(enabled) {
+			const bool listening = sampleSink.Connected();
+			const auto start = channelTime;
+
+			if(listening && !ch1.steady()) {
+				ch1.run(ticks, [&](uint32_t tick) { setLevel(0, ch1.level(), start + tick); });
+			} else {
+				ch1.skip(ticks);
+			}
+			if(listening && !ch2.steady()) {
+				ch2.run(ticks, [&](uint32_t tick) { setLevel(1, ch2.level(), start + tick); });
+			} else {
+				ch2.skip(ticks);
+			}
+			if(listening && !ch3.steady()) {
+				ch3.run(ticks, [&](uint32_t tick) { setLevel(2, ch3.level(), start + tick); });
+			} else {
+				ch3.skip(ticks);
+			}
+			if(listening && !ch4.steady()) {
+				ch4.run(ticks, [&](uint32_t tick) { setLevel(3, ch4.level(), start + tick); });
+			} else {
+				ch4.run(ticks, [](uint32_t) {});
+			}
+		}
+		channelTime = time;
+	}
+
+	int leftVolume() const { return (nr50 >> 4) & 7; }
+	int rightVolume() const { return (nr50 >> 4) & 7; }
+
+	// Only one channel changed, the others are still where they were
+	void setLevel(int channel, int8_t level, uint32_t at) {
+		const int delta = level - levels[channel];
+		if(delta == 0) return;
+		levels[channel] = level;
+
+		if(nr51 & (0x10 << channel)) {
+			const auto step = delta * leftVolume() * levelAmplitude;
+			blip[0].AddDelta(at, step);
+			amplitude[0] += step;
+		}
+		if(nr51 & (0x01 << channel)) {
+			const auto step = delta * rightVolume() * levelAmplitude;
+			blip[1].AddDelta(at, step);
+			amplitude[1] += step;
+		}
+	}
+
+	// Mixes all channels again after registers or the frame sequencer changed them
+	void updateOutput() {
+		if(!sampleSink.Connected()) return;
+
+		levels[0] = ch1.level();
+		levels[1] = ch2.level();
+		levels[2] = ch3.level();
+		levels[3] = ch4.level();
+
+		int32_t left = 0;
+		int32_t right = 0;
+		for(int i = 0; i < 4; i++) {
+			if(nr51 & (0x10 << i)) left += levels[i];
+			if(nr51 & (0x01 << i)) right += levels[i];
+		}
+		left *= leftVolume() * levelAmplitude;
+		right *= rightVolume() * levelAmplitude;
+
+		if(left != amplitude[0]) {
+			blip[0].AddDelta(time, left - amplitude[0]);
+			amplitude[0] = left;
+		}
+		if(right != amplitude[1]) {
+			blip[1].AddDelta(time, right - amplitude[1]);
+			amplitude[1] = right;
+		}
 	}
 };
 
@@ -0,0 +1,102 @@
+#include "Cartridge.h"
+
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+#include "Mappers/MBC1.h"
+#include "Mappers/MBC2.h"
+#include "Mappers/MBC3.h"
+#include "Mappers/MBC5.h"
+#include "Mappers/NoMBC.h"
+
+namespace Gameboy {
+
+std::unique_ptr<MBC> LoadCart(const RomData& data, Mode& mode, bool persistSaveRam) {
+	if(data.size() < 0x150) {
+		throw std::runtime_error("Not a gameboy game");
+	}
+
+	if(!checkLogo(&data[0x0104])) {
+		throw std::runtime_error("Not a gameboy game");
+	}
+
+	mode = Mode::DMG;
+	uint8_t cgbFlag = data[0x143];
+	if(cgbFlag == 0x80 || cgbFlag == 0xC0) {
+		mode = Mode::CGB;
+	}
+	auto sgbFlag = data[0x0146];
+	if(sgbFlag == 0x03) {
+		mode = Mode::SGB;
+	}
+	uint8_t cartType = data[0x0147];
+	uint32_t romSize = data[0x0148];
+	if(romSize < 9) {
+		romSize = 0x8000 << romSize;
+	} else {
+		throw std::runtime_error("Invalid rom size");
+	}
+
+	if(data.size() != romSize) {
+		throw std::runtime_error("File size not equal to rom size");
+	}
+
+	uint32_t ramSize = data[0x0149];
+	switch(ramSize) {
+		case 0: ramSize = 0x0; break;
+		case 1: ramSize = 0x800; break;
+		case 2: ramSize = 0x2000; break;
+		case 3: ramSize = 0x8000; break;
+		default: throw std::runtime_error("Invalid ram size");
+	}
+
+	uint8_t headerChecksum = data[0x014D];
+	uint8_t x = 0;
+	for(int i = 0x0134; i <= 0x014C; i++) {
+		x = x - data[i] - 1;
+	}
+	if(headerChecksum != x) {
+		throw std::runtime_error("Invalid header checksum");
+	}
+
+	uint16_t globalChecksum = data[0x014E] << 8 | data[0x014F];
+	uint32_t check = 0;
+	for(const uint8_t i : data) check += i;
+	check -= globalChecksum & 0xFF;
+	check -= globalChecksum >> 8;
+	if(globalChecksum != (check & 0xFFFF)) {
+		// throw std::runtime_error("Invalid global checksum");
+	}
+
+	std::unique_ptr<MBC> mbc;
+	switch(cartType) {
+		case 0x0:  assert(ramSize == 0); mbc = std::make_unique<NoMBC>(data, ramSize, false); break;
+		case 0x1:  assert(ramSize == 0); mbc = std::make_unique<MBC1>(data, ramSize, false); break;
+		case 0x2: 						 mbc = std::make_unique<MBC1>(data, ramSize, false); break;
+		case 0x3:  assert(ramSize != 0); mbc = std::make_unique<MBC1>(data, ramSize, true); break;
+		case 0x5:  assert(ramSize == 0); mbc = std::make_unique<MBC2>(data, false); break;
+		case 0x6:  assert(ramSize == 0); mbc = std::make_unique<MBC2>(data, true); break;
+		case 0x8:  assert(ramSize != 0); mbc = std::make_unique<NoMBC>(data, ramSize, false); break;
+		case 0x9:  assert(ramSize != 0); mbc = std::make_unique<NoMBC>(data, ramSize, true); break;
+		case 0x0F: assert(ramSize == 0); mbc = std::make_unique<MBC3>(data, ramSize, true, true); break;
+		case 0x10: assert(ramSize != 0); mbc = std::make_unique<MBC3>(data, ramSize, true, true); break;
+		case 0x11: assert(ramSize == 0); mbc = std::make_unique<MBC3>(data, ramSize, false, false); break;
+		case 0x12: assert(ramSize != 0); mbc = std::make_unique<MBC3>(data, ramSize, false, false); break;
+		case 0x13: assert(ramSize != 0); mbc = std::make_unique<MBC3>(data, ramSize, true, false); break;
+		case 0x19: assert(ramSize == 0); mbc = std::make_unique<MBC5>(data, ramSize, false, false); break;
+		case 0x1A: assert(ramSize != 0); mbc = std::make_unique<MBC5>(data, ramSize, false, false); break;
+		case 0x1B: assert(ramSize != 0); mbc = std::make_unique<MBC5>(data, ramSize, true, false); break;
+		case 0x1C: assert(ramSize == 0); mbc = std::make_unique<MBC5>(data, ramSize, false, true); break;
+		case 0x1D: assert(ramSize != 0); mbc = std::make_unique<MBC5>(data, ramSize, false, true); break;
+		case 0x1E: assert(ramSize != 0); mbc = std::make_unique<MBC5>(data, ramSize, true, true); break;
+		default: throw std::runtime_error("unknown mbc " + std::to_string(cartType));
+	}
+
+	if(persistSaveRam) {
+		mbc->MapSaveRam();
+	}
+	return mbc;
+}
+
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Gameboy.h"
+
+namespace Gameboy {
+
+// checks the header of a .gb/.gbc rom and creates the matching mbc. mode is set to the model the game is made for.
+// Battery backed ram starts zeroed and only goes to ./saves with persistSaveRam, see MBC::MapSaveRam
+std::unique_ptr<MBC> LoadCart(const RomData& data, Mode& mode, bool persistSaveRam = false);
+
+}
@@ -2,7 +2,6 @@
 
 #include <cstring>
 
-#include "../../Input.h"
 
 namespace Gameboy {
 
@@ -153,16 +152,16 @@ uint8_t Gameboy::CpuRead(uint16_t addr) const {
 			case 0xFF00: {
 				uint8_t val = 0;
 				if(JoyPadSelect == 1) {
-					val |= (!Input::GB.GetKey(0)) << 0; // right
-					val |= (!Input::GB.GetKey(1)) << 1; // left
-					val |= (!Input::GB.GetKey(2)) << 2; // up
-					val |= (!Input::GB.GetKey(3)) << 3; // down
+					val |= (!(buttons >> 0 & 1)) << 0; // right
+					val |= (!(buttons >> 1 & 1)) << 1; // left
+					val |= (!(buttons >> 2 & 1)) << 2; // up
+					val |= (!(buttons >> 3 & 1)) << 3; // down
 					val |= 0x20;
 				} else if(JoyPadSelect == 2) {
-					val |= (!Input::GB.GetKey(4)) << 0; // A
-					val |= (!Input::GB.GetKey(5)) << 1; // B
-					val |= (!Input::GB.GetKey(6)) << 2; // Select
-					val |= (!Input::GB.GetKey(7)) << 3; // Start
+					val |= (!(buttons >> 4 & 1)) << 0; // A
+					val |= (!(buttons >> 5 & 1)) << 1; // B
+					val |= (!(buttons >> 6 & 1)) << 2; // Select
+					val |= (!(buttons >> 7 & 1)) << 3; // Start
 					val |= 0x10;
 				}
 				return val | 0xC0;
@@ -416,6 +415,9 @@ void Gameboy::Advance() {
 }
 
 void Gameboy::SaveState(saver& saver) {
+	const auto start = saver.size();
+	saver.writeVersion(stateVersion);
+
 	cpu.SaveState(saver);
 	ppu.SaveState(saver);
 	apu.SaveState(saver);
@@ -442,9 +444,21 @@ void Gameboy::SaveState(saver& saver) {
 	saver << vramBank;
 	saver << JoyPadSelect;
 	saver << inBios;
+	saver << pendingCycles;
+	saver << cyclesPassed;
+
+	stateSize = saver.size() - start;
 }
 
 void Gameboy::LoadState(saver& saver) {
+	// the whole state has to be there before the first part of it is loaded
+	if(stateSize == 0) {
+		::saver current;
+		SaveState(current);
+	}
+	saver.readVersion(stateVersion);
+	saver.require(stateSize - sizeof(stateVersion));
+
 	cpu.LoadState(saver);
 	ppu.LoadState(saver);
 	apu.LoadState(saver);
@@ -471,6 +485,8 @@ void Gameboy::LoadState(saver& saver) {
 	saver >> vramBank;
 	saver >> JoyPadSelect;
 	saver >> inBios;
+	saver >> pendingCycles;
+	saver >> cyclesPassed;
 }
 
 void Gameboy::clockTimer() {
@@ -30,6 +30,7 @@ enum class Interrupt {
 
 class Gameboy {
 	friend class Core;
+	friend struct BenchAccess;
 	friend class GbsMBC;
 	friend class LR35902;
 
@@ -38,6 +39,8 @@ class Gameboy {
 	PPU ppu;
 	APU apu;
 	std::unique_ptr<MBC> mbc;
+	// bytes SaveState writes with the current cartridge, 0 until the next SaveState
+	size_t stateSize = 0;
 
 	uint16_t DIV;
 
@@ -77,12 +80,25 @@ class Gameboy {
   	float cyclesPassed;
 
 	bool gbc = false;
+	// right, left, up, down, A, B, Select, Start from bit 0 to 7. Set by the frontend
+	uint8_t buttons = 0;
 
-	Gameboy(RenderImage& texture) : cpu(*this), ppu(*this, texture) {}
+	Gameboy(Framebuffer& texture) : cpu(*this), ppu(*this, texture) {}
+
+	void InsertCartridge(std::unique_ptr<MBC> cartridge) {
+		mbc = std::move(cartridge);
+		stateSize = 0;
+	}
+	uint64_t InstructionCount() const { return cpu.instructionCount; }
+	void SetSampleSink(Audio::SampleSink sink) { apu.setSampleSink(sink); }
+	// without rendering no pixels are drawn, the emulation stays the same
+	void SetRender(bool render) { ppu.render = render; }
 
 	void Reset(Mode mode);
 	void Clock();
 	void Advance();
+	// sends the samples of the frame to the sample sink, has to be called at least every 100ms of emulated time
+	void EndFrame() { apu.endFrame(); }
 
 	void Interrupt(Interrupt interrupt) {
 		InterruptFlag |= 1 << (int)interrupt;
@@ -91,7 +107,10 @@ class Gameboy {
 	uint8_t CpuRead(uint16_t addr) const;
 	void CpuWrite(uint16_t addr, uint8_t val);
 
+	// layout of the save states, bumped whenever SaveState writes something else
+	static constexpr uint32_t stateVersion = 2;
 	void SaveState(saver& saver);
+	// throws if the state has a different stateVersion or is too short, the system is left as it was
 	void LoadState(saver& saver);
 
   private:
@@ -1,25 +1,16 @@
 #include "GameboyCore.h"
 
-#include <fstream>
 #include <vector>
 
 #include "../../Input.h"
+#include "../../audio.h"
 #include "../../fs.h"
 
+#include "Cartridge.h"
 #include "Mappers/GbsMBC.h"
-#include "Mappers/MBC1.h"
-#include "Mappers/MBC2.h"
-#include "Mappers/MBC3.h"
-#include "Mappers/MBC5.h"
-#include "Mappers/NoMBC.h"
 
 namespace Gameboy {
 
-static std::vector<uint8_t> readFile(const std::string& path) {
-	std::ifstream input(path, std::ios::binary);
-	return std::vector<uint8_t>(std::istreambuf_iterator<char>(input), {});
-}
-
 enum Domain {
 	CpuRam,
 	Hram,
@@ -29,7 +20,9 @@ enum Domain {
 	Rom
 };
 
-Core::Core() : texture(160, 144), gameboy(texture), _ppuWindow(gameboy.ppu) { }
+Core::Core() : texture(160, 144), gameboy(texture), _ppuWindow(gameboy.ppu) {
+	gameboy.SetSampleSink(Audio::Output());
+}
 
 std::vector<MemoryDomain> Core::GetMemoryDomains() {
 	return {
@@ -49,7 +42,8 @@ void Core::WriteMemory(int domain, size_t address, uint8_t val) {
 		case CpuBus: gameboy.CpuWrite(address, val); break;
 		case VRam: ((uint8_t*)&gameboy.ppu.VRAM)[address] = val; break;
 		case Oam: gameboy.ppu.OAM[address] = val; break;
-		case Rom: gameboy.mbc->rom[address] = val; break;
+		// the rom is shared read only
+		case Rom: break;
 	}
 }
 
@@ -66,90 +60,16 @@ uint8_t Core::ReadMemory(int domain, size_t address) {
 	throw std::logic_error("Unreachable");
 }
 
-void Core::LoadRom(const std::string& path) {
+void Core::LoadRom(const std::string& path, bool persistSaveRam) {
 	auto ext = fs::path(path).extension().string();
 	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
 
 	if(ext == ".gb" || ext == ".gbc") {
-		auto data = readFile(path);
-
-		if(!checkLogo(&data[0x0104])) {
-			throw std::runtime_error("Not a gameboy game");
-		}
-
-		mode = Mode::DMG;
-		uint8_t cgbFlag = data[0x143];
-		if(cgbFlag == 0x80 || cgbFlag == 0xC0) {
-			mode = Mode::CGB;
-		}
-		auto sgbFlag = data[0x0146];
-		if(sgbFlag == 0x03) {
-			mode = Mode::SGB;
-		}
-		uint8_t cartType = data[0x0147];
-		uint32_t romSize = data[0x0148];
-		if(romSize < 9) {
-			romSize = 0x8000 << romSize;
-		} else {
-			throw std::runtime_error("Invalid rom size");
-		}
-
-		if(data.size() != romSize) {
-			throw std::runtime_error("File size not equal to rom size");
-		}
+		const auto data = RomData::Load(path);
 
-		uint32_t ramSize = data[0x0149];
-		switch(ramSize) {
-			case 0: ramSize = 0x0; break;
-			case 1: ramSize = 0x800; break;
-			case 2: ramSize = 0x2000; break;
-			case 3: ramSize = 0x8000; break;
-			default: throw std::runtime_error("Invalid ram size");
-		}
-
-		uint8_t headerChecksum = data[0x014D];
-		uint8_t x = 0;
-		for(int i = 0x0134; i <= 0x014C; i++) {
-			x = x - data[i] - 1;
-		}
-		if(headerChecksum != x) {
-			throw std::runtime_error("Invalid header checksum");
-		}
-
-		uint16_t globalChecksum = data[0x014E] << 8 | data[0x014F];
-		uint32_t check = 0;
-		for(const uint8_t i : data) check += i;
-		check -= globalChecksum & 0xFF;
-		check -= globalChecksum >> 8;
-		if(globalChecksum != (check & 0xFFFF)) {
-			// throw std::runtime_error("Invalid global checksum");
-		}
+		gameboy.InsertCartridge(LoadCart(data, mode, persistSaveRam));
+		romHash = md5((const char*)data.data(), data.size());
 
-		romHash = md5((char*)data.data(), data.size());
-
-		switch(cartType) {
-			case 0x0:  assert(ramSize == 0); gameboy.mbc = std::make_unique<NoMBC>(data, ramSize, false); break;
-			case 0x1:  assert(ramSize == 0); gameboy.mbc = std::make_unique<MBC1>(data, ramSize, false); break;
-			case 0x2: 						 gameboy.mbc = std::make_unique<MBC1>(data, ramSize, false); break;
-			case 0x3:  assert(ramSize != 0); gameboy.mbc = std::make_unique<MBC1>(data, ramSize, true); break;
-			case 0x5:  assert(ramSize == 0); gameboy.mbc = std::make_unique<MBC2>(data, false); break;
-			case 0x6:  assert(ramSize == 0); gameboy.mbc = std::make_unique<MBC2>(data, true); break;
-			case 0x8:  assert(ramSize != 0); gameboy.mbc = std::make_unique<NoMBC>(data, ramSize, false); break;
-			case 0x9:  assert(ramSize != 0); gameboy.mbc = std::make_unique<NoMBC>(data, ramSize, true); break;
-			case 0x0F: assert(ramSize == 0); gameboy.mbc = std::make_unique<MBC3>(data, ramSize, true, true); break;
-			case 0x10: assert(ramSize != 0); gameboy.mbc = std::make_unique<MBC3>(data, ramSize, true, true); break;
-			case 0x11: assert(ramSize == 0); gameboy.mbc = std::make_unique<MBC3>(data, ramSize, false, false); break;
-			case 0x12: assert(ramSize != 0); gameboy.mbc = std::make_unique<MBC3>(data, ramSize, false, false); break;
-			case 0x13: assert(ramSize != 0); gameboy.mbc = std::make_unique<MBC3>(data, ramSize, true, false); break;
-			case 0x19: assert(ramSize == 0); gameboy.mbc = std::make_unique<MBC5>(data, ramSize, false, false); break;
-			case 0x1A: assert(ramSize != 0); gameboy.mbc = std::make_unique<MBC5>(data, ramSize, false, false); break;
-			case 0x1B: assert(ramSize != 0); gameboy.mbc = std::make_unique<MBC5>(data, ramSize, true, false); break;
-			case 0x1C: assert(ramSize == 0); gameboy.mbc = std::make_unique<MBC5>(data, ramSize, false, true); break;
-			case 0x1D: assert(ramSize != 0); gameboy.mbc = std::make_unique<MBC5>(data, ramSize, false, true); break;
-			case 0x1E: assert(ramSize != 0); gameboy.mbc = std::make_unique<MBC5>(data, ramSize, true, true); break;
-			default: throw std::runtime_error("unknown mbc " + std::to_string(cartType));
-		}
-		
 		gameboy.Reset(mode);
 	} else if(ext == ".gbs") {
 		gameboy.mbc = std::make_unique<GbsMBC>(gameboy, path);
@@ -162,18 +82,31 @@ void Core::Reset() {
 }
 
 void Core::Update() {
+	uint8_t buttons = 0;
+	for(int i = 0; i < 8; i++) {
+		buttons |= Input::GB.GetKey(i) << i;
+	}
+	gameboy.buttons = buttons;
+
 	const auto cycles = 4194304 / 60.0;
 
 	while(gameboy.cyclesPassed < cycles) {
 		gameboy.Clock();
 	}
 	gameboy.cyclesPassed -= cycles;
+	gameboy.EndFrame();
 
-	if(mode == Mode::DMG && gameboy.cpu.state == CpuState::Stop) {
+	if(videoOutput && mode == Mode::DMG && gameboy.cpu.state == CpuState::Stop) {
 		texture.Clear({ 0xFF, 0xFF, 0xFF });
 	}
 }
 
+void Core::SetOutput(bool video, bool audio) {
+	videoOutput = video;
+	gameboy.SetRender(video);
+	gameboy.SetSampleSink(audio ? Audio::Output() : Audio::SampleSink {});
+}
+
 void Core::Draw() {
 	auto mbc = gameboy.mbc.get();
 
@@ -15,6 +15,8 @@ class Core final : public ICore {
 	int selectedTrack = -1;
 	Mode mode;
 
+	bool videoOutput = true;
+
   public:
 	Gameboy gameboy;
 	ppuWindow _ppuWindow;
@@ -36,13 +38,16 @@ class Core final : public ICore {
 	void SaveState(saver& saver) override { gameboy.SaveState(saver); }
 	void LoadState(saver& saver) override { gameboy.LoadState(saver); }
 
-	void LoadRom(const std::string& path) override;
+	void LoadRom(const std::string& path, bool persistSaveRam) override;
 
 	void Reset() override;
 	void HardReset() override {
 		Reset(); // no hard reset
 	}
 	void Update() override;
+
+	void SetOutput(bool video, bool audio) override;
+	RenderImage& Screen() override { return texture; }
 };
 
 }
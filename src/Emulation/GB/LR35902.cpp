@@ -261,6 +261,7 @@ void LR35902::Step() {
 	}
 
 	auto opcode = read(PC++);
+	instructionCount++;
 	if(state == CpuState::HaltBug) {
 		PC--;
 	}
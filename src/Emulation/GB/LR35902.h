@@ -99,6 +99,9 @@ class LR35902 {
 	CpuState state;
 
   public:
+	// instructions executed since power on, not part of save states
+	uint64_t instructionCount = 0;
+
 	LR35902(Gameboy& bus) : bus(bus) {}
 
 	void Reset(Mode mode);
@@ -1,5 +1,5 @@
 #pragma once
-#include <fstream>
+#include <cstring>
 #include <string>
 
 #include "../../../math.h"
@@ -8,11 +8,6 @@
 
 namespace Gameboy {
 
-template<typename T>
-void read(std::ifstream& stream, T& ref) {
-	stream.read((char*)&ref, sizeof(T));
-};
-
 struct GbsHeader {
 	char identifier[3];
 	uint8_t version;
@@ -59,9 +54,12 @@ class GbsMBC : public MBC {
 };
 
 inline GbsMBC::GbsMBC(Gameboy& gb, const std::string& path) : MBC({}, 0x2000, false) , gb(gb) {
-	std::ifstream stream(path, std::ios::binary);
+	const auto file = RomData::Load(path);
+	if(file.size() < sizeof(GbsHeader)) {
+		throw std::runtime_error("Invalid gbs format");
+	}
 
-	read(stream, header);
+	std::memcpy(&header, file.data(), sizeof(GbsHeader));
 	if(header.identifier[0] != 'G' ||
 	   header.identifier[1] != 'B' ||
 	   header.identifier[2] != 'S') {
@@ -69,46 +67,48 @@ inline GbsMBC::GbsMBC(Gameboy& gb, const std::string& path) : MBC({}, 0x2000, fa
 	}
 	assert(header.loadAddress >= 0x400);
 
-	auto data = std::vector<uint8_t>(std::istreambuf_iterator(stream), {});
+	auto data = file.Slice(sizeof(GbsHeader), file.size() - sizeof(GbsHeader));
 	auto romSize = math::roundPow2((data.size() + header.loadAddress + 0x3FFF) & ~0x3FFF);
 
-	rom.resize(romSize);
+	std::vector<uint8_t> image(romSize);
 	romMask = romSize - 1;
 
-	std::copy(data.begin(), data.end(), rom.begin() + header.loadAddress);
+	std::copy(data.begin(), data.end(), image.begin() + header.loadAddress);
 
 	bool hasInterrupts = header.TAC & 0x40;
 	// Generate interrupt handlers
 	for(unsigned i = 0; i <= (hasInterrupts ? 0x50 : 0x38); i += 8) {
-		rom[i] = 0xc3; // jp $XXXX
-		rom[i + 1] = (header.loadAddress + i);
-		rom[i + 2] = (header.loadAddress + i) >> 8;
+		image[i] = 0xc3; // jp $XXXX
+		image[i + 1] = (header.loadAddress + i);
+		image[i + 2] = (header.loadAddress + i) >> 8;
 	}
 	for(unsigned i = hasInterrupts ? 0x58 : 0x40; i <= 0x60; i += 8) {
-		rom[i] = 0xc9; // ret
+		image[i] = 0xc9; // ret
 	}
 
 	// Generate entry
 	// generate_gbs_entry(gb, gb.rom + GBS_ENTRY);
 	auto pos = 0x100;
-	rom[pos++] = 0x31; // LD SP,d16
-	rom[pos++] = header.SP;
-	rom[pos++] = header.SP >> 8;
-	rom[pos++] = 0x3E; // LD A,d8
-	rom[pos++] = header.firstSong;
-	rom[pos++] = 0xCD; // Call a16
-	rom[pos++] = header.initAddress;
-	rom[pos++] = header.initAddress >> 8;
-	rom[pos++] = 0x76; // HALT
-	rom[pos++] = 0x00; // NOP
-	rom[pos++] = 0xAF; // XOR a
-	rom[pos++] = 0xE0; // LDH [$FFXX], a
-	rom[pos++] = 0x0F;
-	rom[pos++] = 0xCD; // Call a16
-	rom[pos++] = header.playAddress;
-	rom[pos++] = header.playAddress >> 8;
-	rom[pos++] = 0x18; // JR pc ± $XX
-	rom[pos++] = -10;  // To HALT
+	image[pos++] = 0x31; // LD SP,d16
+	image[pos++] = header.SP;
+	image[pos++] = header.SP >> 8;
+	image[pos++] = 0x3E; // LD A,d8
+	image[pos++] = header.firstSong;
+	image[pos++] = 0xCD; // Call a16
+	image[pos++] = header.initAddress;
+	image[pos++] = header.initAddress >> 8;
+	image[pos++] = 0x76; // HALT
+	image[pos++] = 0x00; // NOP
+	image[pos++] = 0xAF; // XOR a
+	image[pos++] = 0xE0; // LDH [$FFXX], a
+	image[pos++] = 0x0F;
+	image[pos++] = 0xCD; // Call a16
+	image[pos++] = header.playAddress;
+	image[pos++] = header.playAddress >> 8;
+	image[pos++] = 0x18; // JR pc ± $XX
+	image[pos++] = -10;  // To HALT
+
+	rom = RomData(std::move(image));
 }
 
 inline void GbsMBC::LoadTrack(int track) {
@@ -125,7 +125,10 @@ inline void GbsMBC::LoadTrack(int track) {
 	gb.CpuWrite(0xFF24, 0x77);
 	gb.CpuWrite(0xFFFF, header.TAC || header.TMA ? 4 : 1);
 
-	rom[0x104] = track; // replace load track number
+	// the generated image isn't shared with anything so it's fine to replace it
+	std::vector<uint8_t> image(rom.begin(), rom.end());
+	image[0x104] = track; // replace load track number
+	rom = RomData(std::move(image));
 }
 
 } // namespace Gameboy
@@ -4,6 +4,7 @@
 
 #include "../../../saver.h"
 #include "../../../MemoryMapped.h"
+#include "../../../RomData.h"
 #include "../../../md5.h"
 
 namespace Gameboy {
@@ -28,25 +29,20 @@ class MBC {
 
 	std::vector<uint8_t> _ram;
 	std::unique_ptr<MemoryMapped> _mapped;
+	bool battery;
   protected:
-	std::vector<uint8_t> rom;
+	// shared with every other mbc of the same rom, ram belongs to the mbc
+	RomData rom;
 	uint8_t* ram;
 
 	uint32_t romMask;
 	uint32_t ramMask;
 
   public:
-	MBC(const std::vector<uint8_t>& rom, uint32_t ramSize, bool hasBattery) : rom(rom) {
+	MBC(const RomData& rom, uint32_t ramSize, bool hasBattery) : battery(hasBattery && ramSize != 0), rom(rom) {
 		if(ramSize != 0) {
-			if(hasBattery) {
-				const md5 hash { reinterpret_cast<const char*>(&rom[0]), rom.size() };
-				auto path = "./saves/Gameboy/" + hash.ToString() + ".saveRam";
-				_mapped = std::make_unique<MemoryMapped>(path, ramSize);
-				ram = _mapped->begin();
-			} else {
-				_ram.resize(ramSize);
-				ram = &_ram[0];
-			}
+			_ram.resize(ramSize);
+			ram = &_ram[0];
 		}
 
 		// should be something like 0x1000 - 1 = 0xFFF
@@ -55,6 +51,18 @@ class MBC {
 	}
 	virtual ~MBC() = default;
 
+	// Keeps battery backed ram in ./saves/Gameboy instead of zeroed memory of this mbc alone.
+	// Every mbc of the rom that does this shares the file, so only one instance should
+	void MapSaveRam() {
+		if(!battery) return;
+
+		const md5 hash { reinterpret_cast<const char*>(&rom[0]), rom.size() };
+		auto path = "./saves/Gameboy/" + hash.ToString() + ".saveRam";
+		_mapped = std::make_unique<MemoryMapped>(path, ramMask + 1);
+		ram = _mapped->begin();
+		_ram = {};
+	}
+
 	virtual uint8_t Read0(uint16_t addr) const = 0;
 	virtual uint8_t Read4(uint16_t addr) const = 0;
 	virtual uint8_t ReadA(uint16_t addr) const = 0;
@@ -17,7 +17,7 @@ class MBC1 final : public MBC {
 	bool isMulti;
 
   public:
-	MBC1(const std::vector<uint8_t>& rom, uint32_t ramSize, bool hasBattery) : MBC(rom, ramSize, hasBattery) {
+	MBC1(const RomData& rom, uint32_t ramSize, bool hasBattery) : MBC(rom, ramSize, hasBattery) {
 		bool largeRom = rom.size() >= 0x100000;
 		bool largeRam = ramSize > 0x2000;
 		isMulti = largeRom && checkLogo(&rom[0x40104]);
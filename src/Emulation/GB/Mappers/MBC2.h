@@ -10,7 +10,7 @@ class MBC2 final : public MBC {
 	bool ramEnable = false;
 
   public:
-	MBC2(const std::vector<uint8_t>& rom, bool hasBattery) : MBC(rom, 0, hasBattery) {}
+	MBC2(const RomData& rom, bool hasBattery) : MBC(rom, 0, hasBattery) {}
 	~MBC2() override = default;
 
 	uint8_t Read0(uint16_t addr) const override { return rom[addr]; }
@@ -22,7 +22,7 @@ class MBC3 final : public MBC {
 	bool hasTimer;
 
   public:
-	MBC3(const std::vector<uint8_t>& rom, uint32_t ramSize, bool hasBattery, bool hasTimer) : MBC(rom, ramSize, hasBattery), hasTimer(hasTimer) {
+	MBC3(const RomData& rom, uint32_t ramSize, bool hasBattery, bool hasTimer) : MBC(rom, ramSize, hasBattery), hasTimer(hasTimer) {
 		startTime = std::chrono::system_clock::now();
 	}
 
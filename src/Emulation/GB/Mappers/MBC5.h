@@ -12,7 +12,7 @@ class MBC5 final : public MBC {
 	bool hasRumble;
 
   public:
-	MBC5(const std::vector<uint8_t>& rom, uint32_t ramSize, bool hasBattery, bool hasRumble) : MBC(rom, ramSize, hasBattery), hasRumble(hasRumble) {}
+	MBC5(const RomData& rom, uint32_t ramSize, bool hasBattery, bool hasRumble) : MBC(rom, ramSize, hasBattery), hasRumble(hasRumble) {}
 	~MBC5() override = default;
 
 	uint8_t Read0(uint16_t addr) const override { return rom[addr & 0x3FFF]; }
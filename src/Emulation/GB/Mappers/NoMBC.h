@@ -5,7 +5,7 @@ namespace Gameboy {
 
 class NoMBC final : public MBC {
   public:
-	NoMBC(const std::vector<uint8_t>& rom, uint32_t ramSize, bool hasBattery) : MBC(rom, ramSize, hasBattery) {}
+	NoMBC(const RomData& rom, uint32_t ramSize, bool hasBattery) : MBC(rom, ramSize, hasBattery) {}
 	~NoMBC() override = default;
 
 	uint8_t Read0(uint16_t addr) const override { return rom[addr & 0x3FFF]; }
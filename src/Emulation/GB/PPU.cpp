@@ -1,5 +1,7 @@
 #include "PPU.h"
 
+#include <algorithm>
+
 #include "../../math.h"
 #include "Gameboy.h"
 
@@ -18,6 +20,11 @@ const Color palette[] = {
 	{ 0x00, 0x00, 0x00 }
 };
 
+PPU::PPU(Gameboy& bus, Framebuffer& texture) : bus(bus), texture(texture) {
+	// dmg pixels are written as indices into palette, gbc colors directly
+	texture.SetPalette(palette, 4);
+}
+
 static const uint8_t tileInit[] = {
 	0xF0, 0xF0, 0xFC, 0xFC, 0xFC, 0xFC, 0xF3, 0xF3,
 	0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x3C,
@@ -99,45 +106,52 @@ void PPU::Clock() {
 		if(LX == 80) {
 			STAT.modeFlag = 3;
 
-			if(Control.lcdEnable) {
-				if(bus.gbc) {
-					DrawBg(true);
-					DrawWindow(true);
-					DrawSprites(true);
-
-					for(size_t i = 0; i < 160; i++) {
-						auto el = drawBuffer[i];
-						auto id = ((el.palette & 7) * 4 + el.id) * 2;
-
-						uint16_t col;
-						if(el.palette & 0x80) { // sprite
-							col = gbcOBP[id] | gbcOBP[id + 1] << 8;
-						} else { // bg/window
-							col = gbcBGP[id] | gbcBGP[id + 1] << 8;
+			if(render) {
+				if(Control.lcdEnable) {
+					if(bus.gbc) {
+						DrawBg(true);
+						DrawWindow(true);
+						DrawSprites(true);
+
+						for(size_t i = 0; i < 160; i++) {
+							auto el = drawBuffer[i];
+							auto id = ((el.palette & 7) * 4 + el.id) * 2;
+
+							uint16_t col;
+							if(el.palette & 0x80) { // sprite
+								col = gbcOBP[id] | gbcOBP[id + 1] << 8;
+							} else { // bg/window
+								col = gbcBGP[id] | gbcBGP[id + 1] << 8;
+							}
+
+							Color color { (col << 3) & 0xF8, (col >> 2) & 0xF8, (col >> 7) & 0xF8 };
+							texture.SetPixel(i, LY, color);
 						}
-
-						Color color { (col << 3) & 0xF8, (col >> 2) & 0xF8, (col >> 7) & 0xF8 };
-						texture.SetPixel(i, LY, color);
-					}
-				} else {
-					if(Control.bgWindowEnable) {
-						DrawBg(false);
-						DrawWindow(false);
 					} else {
-						std::fill(drawBuffer.begin(), drawBuffer.end(), Pixel { 0, 0, 0, 0 });
-					}
-					DrawSprites(false);
+						if(Control.bgWindowEnable) {
+							DrawBg(false);
+							DrawWindow(false);
+						} else {
+							std::fill(drawBuffer.begin(), drawBuffer.end(), Pixel { 0, 0, 0, 0 });
+						}
+						DrawSprites(false);
 
+						auto line = texture.IndexLine(LY);
+						for(size_t i = 0; i < 160; i++) {
+							auto el = drawBuffer[i];
+							line[i] = (el.palette >> (el.id << 1)) & 3;
+						}
+					}
+				} else if(bus.gbc) {
 					for(size_t i = 0; i < 160; i++) {
-						auto el = drawBuffer[i];
-						auto color = (el.palette >> (el.id << 1)) & 3;
-						texture.SetPixel(i, LY, palette[color]);
+						texture.SetPixel(i, LY, { 0xFF, 0xFF, 0xFF });
 					}
+				} else {
+					// palette[0] is white
+					std::fill_n(texture.IndexLine(LY), 160, 0);
 				}
-			} else {
-				for(size_t i = 0; i < 160; i++) {
-					texture.SetPixel(i, LY, { 0xFF, 0xFF, 0xFF });
-				}
+			} else if(Control.lcdEnable && (bus.gbc || Control.bgWindowEnable)) {
+				SkipWindow();
 			}
 		}
 
@@ -213,6 +227,13 @@ void PPU::DrawBg(bool gbc) {
 	}
 }
 
+// the window line counter has to advance even if the line isn't drawn
+void PPU::SkipWindow() {
+	if(Control.windowEnable && WY <= LY && WX - 7 < 160) {
+		windowCounter++;
+	}
+}
+
 void PPU::DrawWindow(bool gbc) {
 	if(!Control.windowEnable) return;
 
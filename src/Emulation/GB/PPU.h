@@ -2,7 +2,7 @@
 #include <array>
 #include <cstdint>
 
-#include "../../RenderImage.h"
+#include "../../Framebuffer.h"
 #include "../../saver.h"
 
 namespace Gameboy {
@@ -20,13 +20,15 @@ class PPU {
 	friend class Gameboy;
 	friend class Core;
 	friend class ppuWindow;
+	friend struct BenchAccess;
 
   private:
 	uint8_t VRAM[2][0x2000];
-	uint8_t OAM[0xA0];
+	// Reset leaves oam and the color palettes alone, they start out zeroed so every run from power on is the same
+	uint8_t OAM[0xA0] {};
 
-	std::array<Pixel, 160> drawBuffer;
-	std::array<uint8_t, 64> gbcBGP, gbcOBP;
+	std::array<Pixel, 160> drawBuffer {};
+	std::array<uint8_t, 64> gbcBGP {}, gbcOBP {};
 
 	uint16_t windowCounter;
 	int16_t LX;
@@ -69,15 +71,17 @@ class PPU {
 	uint8_t OBP0, OBP1;
 	uint8_t WY, WX;
 
-	uint8_t OPRI;
+	uint8_t OPRI = 0;
 
 	Gameboy& bus;
-	RenderImage& texture;
+	Framebuffer& texture;
 
   public:
 	bool frameComplete = false;
+	// lines are only drawn into texture while set, the timing and interrupts stay the same
+	bool render = true;
 
-	PPU(Gameboy& bus, RenderImage& texture) : bus(bus), texture(texture) {}
+	PPU(Gameboy& bus, Framebuffer& texture);
 
 	void Reset();
 
@@ -89,6 +93,7 @@ class PPU {
   private:
 	void DrawBg(bool gbc);
 	void DrawWindow(bool gbc);
+	void SkipWindow();
 	void DrawSprites(bool gbc);
 };
 
@@ -54,9 +54,16 @@ class ICore {
 	virtual void SaveState(saver& saver) = 0;
 	virtual void LoadState(saver& saver) = 0;
 
-	virtual void LoadRom(const std::string& path) = 0;
+	// With persistSaveRam battery backed ram is kept in ./saves. Only one instance of a rom may do that,
+	// every other one gets zeroed ram of its own
+	virtual void LoadRom(const std::string& path, bool persistSaveRam) = 0;
 
 	virtual void Reset() = 0;
 	virtual void HardReset() = 0;
 	virtual void Update() = 0;
+
+	// Output of the following updates. Without video the screen keeps its last picture,
+	// without audio no samples are pushed. The emulation itself runs the same either way
+	virtual void SetOutput(bool video, bool audio) = 0;
+	virtual RenderImage& Screen() = 0;
 };
@@ -1,15 +1,90 @@
 #include "Bus.h"
 #include "StandardController.h"
 
+#include <algorithm>
+
 namespace Nes {
-Bus::Bus() : cpu(mos6502(this)), apu(RP2A03(this)) {}
+Bus::Bus() : cpu(mos6502(this)), apu(RP2A03(this)) {
+	// 0x0000 - 0x1FFF
+	for(int i = 0; i < 0x20; i++) {
+		cpuPages.read[i] = cpuPages.write[i] = &CpuRam[(i << 8) & 0x07FF];
+	}
+}
 
 void Bus::InsertCartridge(std::shared_ptr<Mapper>& cartridge) {
+	if(this->cartridge) {
+		SyncPpu();
+	}
+
+	std::fill(std::begin(cpuPages.read) + 0x20, std::end(cpuPages.read), nullptr);
+	std::fill(std::begin(cpuPages.write) + 0x20, std::end(cpuPages.write), nullptr);
+	scheduler.Cancel(Event::Mapper);
+
 	this->cartridge = cartridge;
 	ppu.cartridge = cartridge;
+	stateSize = 0;
+	cartridge->AttachScheduler(&scheduler);
+	cartridge->AttachCpuPages(&cpuPages);
+	std::fill(std::begin(ppu.chrPages.rows), std::end(ppu.chrPages.rows), nullptr);
+	cartridge->AttachChrPages(&ppu.chrPages);
+
+	// the ppu drives the irq counter of these mappers so it can't fall behind
+	ppuCatchUp = ppuSync == PpuSync::CatchUp && !cartridge->ppuTimedIrq;
+	Reschedule();
+}
+
+void Bus::SetPpuSync(PpuSync sync) {
+	if(cartridge) {
+		SyncPpu();
+	}
+
+	ppuSync = sync;
+	ppuCatchUp = sync == PpuSync::CatchUp && cartridge && !cartridge->ppuTimedIrq;
+	Reschedule();
+}
+
+void Bus::CatchUpPpu(uint64_t clock) {
+	if(ppuClock < clock) {
+		ppu.Run(clock - ppuClock);
+		ppuClock = clock;
+	}
+
+	// next tick at which the ppu has to be clocked in step again
+	scheduler.Schedule(Event::Ppu, ppuClock + ppu.DotsTillEvent());
+}
+
+void Bus::ScheduleApuFrame(uint64_t apuTick) {
+	int cycles = apu.CyclesTillFrameStep();
+
+	if(cycles < 0) {
+		scheduler.Cancel(Event::ApuFrame);
+	} else {
+		scheduler.Schedule(Event::ApuFrame, apuTick + cycles * 3);
+	}
+}
+
+// Post every bus owned event again after the state was changed from outside
+void Bus::Reschedule() {
+	scheduler.Schedule(Event::Ppu, ppuClock + ppu.DotsTillEvent());
+
+	if(ppu.nmi) {
+		scheduler.Schedule(Event::Nmi, systemClockCounter);
+	} else {
+		scheduler.Cancel(Event::Nmi);
+	}
+	if(dmaTransfer) {
+		scheduler.Schedule(Event::Dma, systemClockCounter);
+	} else {
+		scheduler.Cancel(Event::Dma);
+	}
+
+	// the apu runs on the first tick divisible by 3
+	ScheduleApuFrame((systemClockCounter + 2) / 3 * 3);
 }
 
 void Bus::HardReset() {
+	SyncPpu();
+
 	cpu.HardReset();
 	ppu.HardReset();
 	// apu.HardReset();
@@ -27,15 +102,28 @@ void Bus::HardReset() {
 	dmaTransfer = false;
 	dmaDummy = true;
 
+	// keep mapper events on the same cpu cycle
+	const auto cpuClock = (systemClockCounter + 2) / 3 * 3;
+	scheduler.Rebase(cpuClock, 0);
+	cartridge->Rebase(cpuClock, 0);
 	systemClockCounter = 0;
 	CpuStall = 0;
+
+	ppuClock = 0;
+	Reschedule();
 }
 
 void Bus::Reset() {
+	SyncPpu();
+
 	cpu.Reset();
 	ppu.Reset();
 	apu.Reset();
 
+	// keep mapper events on the same cpu cycle
+	const auto cpuClock = (systemClockCounter + 2) / 3 * 3;
+	scheduler.Rebase(cpuClock, 0);
+	cartridge->Rebase(cpuClock, 0);
 	systemClockCounter = 0;
 	dmaPage = 0;
 	dmaAddr = 0;
@@ -45,61 +133,167 @@ void Bus::Reset() {
 	dmaDummy = true;
 
 	irqDelay = 0;
+
+	ppuClock = 0;
+	Reschedule();
 }
 // TODO: static int last4017 = 0; why is this even here?
 
 void Bus::Clock() {
-	ppu.Clock();
-
-	if(systemClockCounter % 3 == 0) {
-		// last4017++;
-		apu.Clock();
+	if(systemClockCounter < scheduler.Next()) {
+		FastClock();
+	} else {
+		ClockEvents();
+	}
+}
 
-		if(dmaTransfer) {
-			if(dmaDummy) {
-				if(systemClockCounter % 2 == 1) {
-					dmaDummy = false;
-				}
+void Bus::RunFrame() {
+	if(cpuCore == CpuCore::Instruction) {
+		// the frame can only end on an instruction boundary
+		while(!ppu.frameComplete) {
+			if(systemClockCounter % 3 == 0 && cpu.InstructionStart()) {
+				cpu.Step();
 			} else {
-				if(systemClockCounter % 2 == 0) {
-					dmaData = CpuRead(dmaPage << 8 | dmaAddr);
-				} else {
-					reinterpret_cast<uint8_t*>(ppu.oam)[(ppu.oamAddr + dmaAddr) & 0xFF] = dmaData;
-					dmaAddr++;
-
-					if(dmaAddr == 0) {
-						dmaTransfer = false;
-						dmaDummy = true;
-					}
-				}
+				Clock();
 			}
-		} else {
-			if(CpuStall) {
-				CpuStall--;
-			}
-			cpu.Clock();
-			cartridge->CpuClock();
+		}
+		return;
+	}
 
-			cpu.IRQ = irqDelay || cartridge->Irq;
-			irqDelay = apu.GetIrq();
+	while(!ppu.frameComplete) {
+		while(systemClockCounter < scheduler.Next()) {
+			FastClock();
 		}
+		ClockEvents();
 	}
+}
+
+// Tick on which no event is due. Nothing but the cpu, the apu channels and the irq line need attention
+inline void Bus::FastClock() {
+	if(!ppuCatchUp) {
+		ppu.Clock();
+		ppuClock++;
+	}
+
+	if(systemClockCounter % 3 == 0) {
+		apu.Clock();
+
+		if(CpuStall) {
+			CpuStall--;
+		}
+		cpu.Clock();
+
+		cpu.IRQ = irqDelay || cartridge->Irq;
+		irqDelay = apu.GetIrq();
+	}
+
+	systemClockCounter++;
+}
+
+void Bus::ClockEvents() {
+	if(BeginEventTick()) {
+		cpu.Clock();
+		EndCpuTick();
+	}
+	EndEventTick();
+}
+
+// Everything an event tick does before the cpu gets the bus. Returns false if the cpu doesn't run on this tick
+bool Bus::BeginEventTick() {
+	// nmi delay of the previous tick, it only has to happen before the ppu runs again
+	if(scheduler.Due(Event::Nmi)) {
+		scheduler.Cancel(Event::Nmi);
 
-	if(ppu.nmi) {
 		if(ppu.nmi == 5) {
 			ppu.nmi = 0;
 			cpu.Nmi();
 		} else if(!ppu.Control.enableNMI && (ppu.nmi <= 2)) {
 			ppu.nmi = 0;
-		} else {
+		} else if(ppu.nmi) {
 			ppu.nmi++;
 		}
 	}
 
+	if(!ppuCatchUp) {
+		ppu.Clock();
+		ppuClock++;
+		scheduler.Schedule(Event::Ppu, ppuClock + ppu.DotsTillEvent());
+	} else if(ppu.nmi || scheduler.Due(Event::Ppu)) {
+		// nmi timing is checked every tick so the ppu has to stay in step until it is delivered
+		CatchUpPpu(systemClockCounter + 1);
+	}
+
+	if(systemClockCounter % 3 != 0) {
+		return false;
+	}
+
+	// last4017++;
+	if(scheduler.Due(Event::ApuFrame)) {
+		apu.StepFrameCounter();
+	}
+	apu.Clock();
+	if(scheduler.Due(Event::ApuFrame)) {
+		ScheduleApuFrame(systemClockCounter + 3);
+	}
+
+	if(dmaTransfer) {
+		// the cpu is halted so mapper cpu cycle counters are as well
+		scheduler.Delay(Event::Mapper, 3);
+
+		if(dmaDummy) {
+			if(systemClockCounter % 2 == 1) {
+				dmaDummy = false;
+			}
+		} else {
+			if(systemClockCounter % 2 == 0) {
+				dmaData = CpuRead(dmaPage << 8 | dmaAddr);
+			} else {
+				if(ppuCatchUp) {
+					CatchUpPpu(systemClockCounter + 1);
+				}
+				reinterpret_cast<uint8_t*>(ppu.oam)[(ppu.oamAddr + dmaAddr) & 0xFF] = dmaData;
+				dmaAddr++;
+
+				if(dmaAddr == 0) {
+					dmaTransfer = false;
+					dmaDummy = true;
+				}
+			}
+		}
+		return false;
+	}
+
+	if(CpuStall) {
+		CpuStall--;
+	}
+	return true;
+}
+
+void Bus::EndEventTick() {
+	if(ppu.nmi) {
+		scheduler.Schedule(Event::Nmi, systemClockCounter + 1);
+	}
+	if(dmaTransfer) {
+		scheduler.Schedule(Event::Dma, systemClockCounter + 1);
+	} else if(scheduler.Pending(Event::Dma)) {
+		scheduler.Cancel(Event::Dma);
+	}
+
 	systemClockCounter++;
 }
 
 void Bus::CpuWrite(uint16_t addr, uint8_t data) {
+	uint8_t* page = cpuPages.write[addr >> 8];
+	if(page) {
+		page[addr & 0xFF] = data;
+		return;
+	}
+
+	// anything past the page table can be a ppu register, dma or a mapper changing chr banks or mirroring
+	if(ppuCatchUp) {
+		CatchUpPpu(systemClockCounter + 1);
+	}
+
 	if(cartridge->cpuWrite(addr, data)) {
 		// 0x4020-0xFFFF
 	} else if(addr < 0x2000) {
@@ -108,11 +302,16 @@ void Bus::CpuWrite(uint16_t addr, uint8_t data) {
 	} else if(addr < 0x4000) {
 		// 0x2000 - 0x3FFF
 		ppu.cpuWrite(addr & 0x2007, data);
+
+		if(ppu.nmi) {
+			scheduler.Schedule(Event::Nmi, systemClockCounter + 1);
+		}
 	} else if(addr < 0x4016) {
 		if(addr == 0x4014) {
 			dmaPage = data;
 			dmaAddr = 0;
 			dmaTransfer = true;
+			scheduler.Schedule(Event::Dma, systemClockCounter + 1);
 			// ppu.cpuWrite(addr, data);
 		} else {
 			apu.CpuWrite(addr, data);
@@ -126,10 +325,21 @@ void Bus::CpuWrite(uint16_t addr, uint8_t data) {
 		}
 	} else {
 		apu.CpuWrite(addr, data);
+
+		if(addr == 0x4017) {
+			// frame counter was reset, the apu already ran on this tick
+			ScheduleApuFrame(systemClockCounter + 3);
+		}
 	}
 }
 
 uint8_t Bus::CpuRead(uint16_t addr, bool readOnly) {
+	const uint8_t* page = cpuPages.read[addr >> 8];
+	if(page) {
+		cpuOpenBus = page[addr & 0xFF];
+		return cpuOpenBus;
+	}
+
 	uint8_t data = 0;
 
 	if(cartridge->cpuRead(addr, data)) {
@@ -137,6 +347,9 @@ uint8_t Bus::CpuRead(uint16_t addr, bool readOnly) {
 	} else if(addr < 0x2000) {
 		data = CpuRam[addr & 0x07FF];
 	} else if(addr < 0x4000) {
+		if(ppuCatchUp) {
+			CatchUpPpu(systemClockCounter + 1);
+		}
 		data = ppu.cpuRead(addr & 0x2007, readOnly);
 	} else {
 		switch(addr) {
@@ -162,6 +375,11 @@ uint8_t Bus::CpuRead(uint16_t addr, bool readOnly) {
 }
 
 void Bus::SaveState(saver& saver) {
+	SyncPpu();
+
+	const auto start = saver.size();
+	saver.writeVersion(stateVersion);
+
 	cpu.SaveState(saver);
 	ppu.SaveState(saver);
 	apu.SaveState(saver);
@@ -177,14 +395,28 @@ void Bus::SaveState(saver& saver) {
 	saver << dmaDummy;
 
 	saver << systemClockCounter;
+
+	stateSize = saver.size() - start;
 }
 
 void Bus::LoadState(saver& saver) {
+	// the whole state has to be there before the first part of it is loaded
+	if(stateSize == 0) {
+		::saver current;
+		SaveState(current);
+	}
+	saver.readVersion(stateVersion);
+	saver.require(stateSize - sizeof(stateVersion));
+
+	SyncPpu();
+
 	cpu.LoadState(saver);
 	ppu.LoadState(saver);
 	apu.LoadState(saver);
 
 	cartridge->LoadState(saver);
+	cartridge->UpdateCpuPages();
+	cartridge->UpdateChrPages();
 
 	saver >> CpuRam;
 	saver >> dmaPage;
@@ -195,5 +427,10 @@ void Bus::LoadState(saver& saver) {
 	saver >> dmaDummy;
 
 	saver >> systemClockCounter;
+
+	ppuClock = systemClockCounter;
+	scheduler.Cancel(Event::Mapper);
+	cartridge->Reschedule();
+	Reschedule();
 }
 }
\ No newline at end of file
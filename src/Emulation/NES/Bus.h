@@ -7,27 +7,74 @@
 
 #include "Cartridge.h"
 #include "Controller.h"
+#include "Scheduler.h"
 #include "mos6502.h"
 
 namespace Nes {
 
+enum class PpuSync {
+	// clock the ppu on every master clock tick
+	Lockstep,
+	// let the cpu run ahead and only catch the ppu up when the two can observe each other
+	CatchUp
+};
+
+enum class CpuCore {
+	// step the cpu state machine once per cpu cycle
+	Cycle,
+	// execute a whole instruction per call, the bus runs the rest of the system around each access
+	Instruction
+};
+
 class Bus {
   private:
-	bool irqDelay;
+	bool irqDelay = false;
 
 	uint8_t CpuRam[2 * 1024];
-	uint8_t cpuOpenBus;
+	uint8_t cpuOpenBus = 0;
+
+	// ram is mapped by the bus, everything above $4020 by the cartridge
+	CpuPageTable cpuPages {};
+
+	uint8_t dmaPage = 0;
+	uint8_t dmaAddr = 0;
+	uint8_t dmaData = 0;
+
+	bool dmaTransfer = false;
+	bool dmaDummy = true;
 
-	uint8_t dmaPage;
-	uint8_t dmaAddr;
-	uint8_t dmaData;
+	// bytes SaveState writes with the current cartridge, 0 until the next SaveState
+	size_t stateSize = 0;
 
-	bool dmaTransfer;
-	bool dmaDummy;
+	CpuCore cpuCore = CpuCore::Cycle;
+	PpuSync ppuSync = PpuSync::Lockstep;
+	bool ppuCatchUp = false;
+	// cpu cycles the instruction core ran ahead of the rest of the system
+	int deferredCycles = 0;
+	// master clock ticks the ppu has already run
+	uint64_t ppuClock = 0;
+
+	void CatchUpPpu(uint64_t clock);
+	void ScheduleApuFrame(uint64_t apuTick);
+	void Reschedule();
+
+	void FastClock();
+	void ClockEvents();
+	bool BeginEventTick();
+	void EndCpuTick();
+	void EndEventTick();
+
+	// used by mos6502::Step around every bus access
+	void BeginCpuCycle();
+	void EndCpuCycle();
+	bool DeferCpuCycle(const uint8_t* page);
+	void FlushCpuCycles();
 
   public:
-	uint64_t systemClockCounter;
-	int CpuStall;
+	uint64_t systemClockCounter = 0;
+	int CpuStall = 0;
+
+	Scheduler scheduler { systemClockCounter };
 
 	std::shared_ptr<Mapper> cartridge = nullptr;
 	mos6502 cpu;
@@ -42,14 +89,99 @@ class Bus {
 	void HardReset();
 	void Reset();
 	void Clock();
+	// run until the ppu completes the frame
+	void RunFrame();
+	// run the ppu up to the current master clock
+	void SyncPpu() { CatchUpPpu(systemClockCounter); }
+
+	CpuCore GetCpuCore() const { return cpuCore; }
+	void SetCpuCore(CpuCore core) { cpuCore = core; }
+
+	PpuSync GetPpuSync() const { return ppuSync; }
+	void SetPpuSync(PpuSync sync);
 
 	void CpuWrite(uint16_t addr, uint8_t data);
 	uint8_t CpuRead(uint16_t addr, bool readOnly = false);
 
+	// layout of the save states, bumped whenever SaveState writes something else
+	static constexpr uint32_t stateVersion = 3;
 	void SaveState(saver& saver);
+	// throws if the state has a different stateVersion or is too short, the system is left as it was
 	void LoadState(saver& saver);
 
 	friend class Core;
+	friend class mos6502;
 };
 
+inline void Bus::EndCpuTick() {
+	if(scheduler.Due(Event::Mapper)) {
+		scheduler.Cancel(Event::Mapper);
+		cartridge->SchedulerEvent();
+	}
+
+	cpu.IRQ = irqDelay || cartridge->Irq;
+	irqDelay = apu.GetIrq();
+}
+
+// Run everything that happens on a cpu cycle before the cpu accesses the bus
+inline void Bus::BeginCpuCycle() {
+	if(systemClockCounter < scheduler.Next()) {
+		if(!ppuCatchUp) {
+			ppu.Clock();
+			ppuClock++;
+		}
+		apu.Clock();
+
+		if(CpuStall) {
+			CpuStall--;
+		}
+		return;
+	}
+
+	// an event is due or dma halts the cpu
+	while(!BeginEventTick()) {
+		EndEventTick();
+	}
+}
+
+// A cpu cycle that accesses ram or rom through the page table can't be observed by anything else on the bus.
+// If nothing else needs attention until it ends it is only counted and the rest of the system catches up later
+inline bool Bus::DeferCpuCycle(const uint8_t* page) {
+	if(page && ppuCatchUp && !apu.DmcActive() && systemClockCounter + deferredCycles * 3 + 2 < scheduler.Next()) {
+		deferredCycles++;
+		return true;
+	}
+
+	FlushCpuCycles();
+	return false;
+}
+
+// Same as BeginCpuCycle and EndCpuCycle for every deferred cycle
+inline void Bus::FlushCpuCycles() {
+	for(; deferredCycles > 0; deferredCycles--) {
+		apu.Clock();
+
+		if(CpuStall) {
+			CpuStall--;
+		}
+
+		cpu.IRQ = irqDelay || cartridge->Irq;
+		irqDelay = apu.GetIrq();
+		systemClockCounter += 3;
+	}
+}
+
+// Finish the cpu cycle after the access and run the two ticks until the next one
+inline void Bus::EndCpuCycle() {
+	EndCpuTick();
+	EndEventTick();
+
+	if(ppuCatchUp && systemClockCounter + 1 < scheduler.Next()) {
+		systemClockCounter += 2;
+	} else {
+		Clock();
+		Clock();
+	}
+}
+
 }
@@ -0,0 +1,305 @@
+#include "CartDb.h"
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string_view>
+#include <type_traits>
+
+#include "../../MemoryMapped.h"
+#include "../../fs.h"
+#include "../../jsonReader.h"
+#include "../../logSink.h"
+
+namespace Nes {
+
+// File layout: Header, Header::count Records sorted by prgHash, then the zero terminated names.
+// Everything is in host byte order, the file is only a cache of the json
+struct Header {
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t namesSize;
+};
+
+struct Record {
+	sha1 prgHash;
+	uint16_t mapper;
+	uint16_t unused;
+	// offset into the names
+	uint32_t name;
+};
+
+static_assert(std::is_trivially_copyable_v<Record> && sizeof(Record) == 28);
+
+static constexpr char magic[4] = { 'N', 'C', 'D', 'B' };
+static constexpr uint32_t version = 1;
+
+struct dbItem {
+	std::string name;
+	uint16_t mapper;
+};
+
+static void InsertPrg(std::map<sha1, dbItem>& db, sha1& hash, const dbItem& cart) {
+	auto it = db.find(hash);
+	if(it != db.end()) {
+		const auto& el = it->second;
+		if(el.mapper != cart.mapper) {
+			// we only care about the mapper
+			Log::Write("duplicate hash found: %s from %s\n", hash.ToString().c_str(), cart.name.c_str());
+		}
+	} else {
+		db.insert(std::make_pair(hash, cart));
+	}
+}
+
+// attributes of the xml the db was converted from are strings, numbers are accepted as well
+static int ReadInt(JsonReader& json) {
+	switch(json.Next()) {
+		case JsonToken::Number: return (int)json.Number();
+		case JsonToken::String: return std::stoi(std::string(json.String()));
+		default: throw std::runtime_error("Expected a number");
+	}
+}
+
+static std::string_view ReadString(JsonReader& json) {
+	if(json.Next() != JsonToken::String) {
+		throw std::runtime_error("Expected a string");
+	}
+	return json.String();
+}
+
+// Calls member with every key of the object that was just opened. member has to read or skip the value
+template<typename F>
+static void ForEachMember(JsonReader& json, F member) {
+	while(json.Next() == JsonToken::Key) {
+		member(json.String());
+	}
+}
+
+// The xml conversion turned elements that appear once into an object and repeated ones into an array.
+// Calls read after opening each object
+template<typename F>
+static void ForEachObject(JsonReader& json, F read) {
+	auto token = json.Next();
+	if(token == JsonToken::ObjectBegin) {
+		read();
+		return;
+	}
+	if(token != JsonToken::ArrayBegin) {
+		throw std::runtime_error("Expected an object or array");
+	}
+	while((token = json.Next()) == JsonToken::ObjectBegin) {
+		read();
+	}
+	if(token != JsonToken::ArrayEnd) {
+		throw std::runtime_error("Expected an object");
+	}
+}
+
+struct Cartridge {
+	uint16_t mapper = 0;
+	std::vector<sha1> prg;
+};
+
+static Cartridge ReadCartridge(JsonReader& json) {
+	Cartridge cart;
+	ForEachMember(json, [&](std::string_view key) {
+		if(key != "board") return json.Skip();
+
+		ForEachObject(json, [&]() {
+			ForEachMember(json, [&](std::string_view key) {
+				if(key == "@mapper") {
+					cart.mapper = ReadInt(json);
+				} else if(key == "prg") {
+					ForEachObject(json, [&]() {
+						ForEachMember(json, [&](std::string_view key) {
+							if(key == "@sha1") {
+								cart.prg.push_back(sha1::FromString(std::string(ReadString(json))));
+							} else {
+								json.Skip();
+							}
+						});
+					});
+				} else {
+					json.Skip();
+				}
+			});
+		});
+	});
+	return cart;
+}
+
+static void ReadGame(JsonReader& json, std::map<sha1, dbItem>& db) {
+	// the name isn't necessarily the first member
+	std::string name;
+	std::vector<Cartridge> carts;
+
+	ForEachMember(json, [&](std::string_view key) {
+		if(key == "@name") {
+			name = ReadString(json);
+		} else if(key == "cartridge") {
+			ForEachObject(json, [&]() { carts.push_back(ReadCartridge(json)); });
+		} else {
+			json.Skip();
+		}
+	});
+
+	for(auto& cart : carts) {
+		for(auto& hash : cart.prg) {
+			InsertPrg(db, hash, { name, cart.mapper });
+		}
+	}
+}
+
+void CartDb::Compile(const std::string& json, const std::string& path) {
+	Log::Write("Compiling nes cart db\n");
+
+	// {"database": {"game": [...]}} walked without building a tree
+	std::map<sha1, dbItem> db;
+	{
+		MemoryMapped file(json);
+		JsonReader reader(file.data(), file.Size());
+
+		if(reader.Next() != JsonToken::ObjectBegin) {
+			throw std::runtime_error("Expected an object");
+		}
+		ForEachMember(reader, [&](std::string_view key) {
+			if(key != "database") return reader.Skip();
+			if(reader.Next() != JsonToken::ObjectBegin) {
+				throw std::runtime_error("Expected an object");
+			}
+
+			ForEachMember(reader, [&](std::string_view key) {
+				if(key != "game") return reader.Skip();
+				ForEachObject(reader, [&]() { ReadGame(reader, db); });
+			});
+		});
+	}
+
+	std::vector<Record> records;
+	std::string names;
+	records.reserve(db.size());
+
+	// std::map is already sorted by hash
+	for(auto& [hash, item] : db) {
+		Record record {};
+		record.prgHash = hash;
+		record.mapper = item.mapper;
+		record.name = names.size();
+		records.push_back(record);
+
+		names += item.name;
+		names += '\0';
+	}
+
+	Header header {};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.count = records.size();
+	header.namesSize = names.size();
+
+	// written to a file of its own and renamed over path, so nobody ever maps half a db.
+	// Processes compiling at the same time each write their own file and the last rename wins
+	std::random_device random;
+	const auto tmp = path + "." + std::to_string(random()) + ".tmp";
+	try {
+		{
+			std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+			out.write(names.data(), names.size());
+			if(!out) {
+				throw std::runtime_error("Failed to write " + tmp);
+			}
+		}
+		fs::rename(tmp, path);
+	} catch(...) {
+		std::error_code ec;
+		fs::remove(tmp, ec);
+		throw;
+	}
+
+	Log::Write("Finished compiling %zu entries\n", records.size());
+}
+
+CartDb::CartDb(const std::string& json) {
+	const auto path = fs::path(json).replace_extension(".bin").string();
+
+	std::error_code ec;
+	const bool haveJson = fs::exists(json, ec);
+	const bool outdated = !fs::exists(path, ec) ||
+						  (haveJson && fs::last_write_time(json, ec) > fs::last_write_time(path, ec));
+
+	if(!outdated && Open(path)) {
+		return;
+	}
+	if(!haveJson) {
+		throw std::runtime_error("Missing cart db json: " + json);
+	}
+
+	Compile(json, path);
+	if(!Open(path)) {
+		throw std::runtime_error("Invalid cart db: " + path);
+	}
+}
+
+CartDb::~CartDb() = default;
+
+// Returns false if path isn't a db of this version. The file is only kept mapped if it is,
+// otherwise it can be compiled over right away
+bool CartDb::Open(const std::string& path) {
+	auto mapped = std::make_unique<MemoryMapped>(path);
+
+	Header header;
+	if(mapped->Size() < sizeof(header)) {
+		return false;
+	}
+	std::memcpy(&header, mapped->data(), sizeof(header));
+
+	if(std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version ||
+	   mapped->Size() != sizeof(header) + (size_t)header.count * sizeof(Record) + header.namesSize) {
+		return false;
+	}
+
+	file = std::move(mapped);
+	count = header.count;
+	records = file->data() + sizeof(header);
+	names = reinterpret_cast<const char*>(records + (size_t)count * sizeof(Record));
+	namesSize = header.namesSize;
+	return true;
+}
+
+bool CartDb::Find(const sha1& prgHash, Entry& entry) const {
+	// copied out of the mapping instead of accessed in place
+	auto get = [&](size_t i) {
+		Record record;
+		std::memcpy(&record, records + i * sizeof(Record), sizeof(Record));
+		return record;
+	};
+
+	size_t first = 0;
+	size_t last = count;
+	while(first < last) {
+		const auto mid = first + (last - first) / 2;
+		if(get(mid).prgHash < prgHash) {
+			first = mid + 1;
+		} else {
+			last = mid;
+		}
+	}
+	if(first == count) {
+		return false;
+	}
+
+	const auto record = get(first);
+	if(record.prgHash != prgHash || record.name >= namesSize) {
+		return false;
+	}
+	entry.mapper = record.mapper;
+	entry.name = std::string(names + record.name, strnlen(names + record.name, namesSize - record.name));
+	return true;
+}
+
+}
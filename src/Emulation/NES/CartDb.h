@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "../../sha1.h"
+
+class MemoryMapped;
+
+namespace Nes {
+
+// The cart db json compiled into records sorted by prg sha1, so it can be mapped and binary searched
+// instead of parsed every start. The binary file is rebuilt whenever the json it came from is newer
+class CartDb {
+  private:
+	std::unique_ptr<MemoryMapped> file;
+	uint32_t count = 0;
+	const uint8_t* records = nullptr;
+	const char* names = nullptr;
+	size_t namesSize = 0;
+
+  public:
+	struct Entry {
+		uint16_t mapper;
+		std::string name;
+	};
+
+	// Maps the binary db next to json (same name with .bin), compiling it first if it is missing or outdated
+	explicit CartDb(const std::string& json);
+	CartDb(const CartDb&) = delete;
+	~CartDb();
+
+	// Parses json and writes the binary db to path
+	static void Compile(const std::string& json, const std::string& path);
+
+	bool Find(const sha1& prgHash, Entry& entry) const;
+	size_t Size() const { return count; }
+
+  private:
+	bool Open(const std::string& path);
+};
+
+}
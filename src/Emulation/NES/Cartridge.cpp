@@ -1,13 +1,13 @@
 #include "Cartridge.h"
 
 #include <cmath>
-#include <fstream>
-#include <map>
+#include <cstring>
+#include <mutex>
 
+#include "CartDb.h"
 #include "Mappers/Mappers.h"
 #include "../../fs.h"
-#include "../../json.h"
-#include "../../logger.h"
+#include "../../logSink.h"
 #include "../../md5.h"
 #include "../../sha1.h"
 
@@ -28,89 +28,38 @@ struct INESheader {
 	uint8_t unused[5];
 };
 
-struct dbItem {
-	std::string name;
-	uint16_t mapper;
-	sha1 prgHash;
-};
-
-static bool dbInitialized = false;
-static std::map<sha1, dbItem> cartDb;
+// LoadCart can be called from several emulator threads, the first one that needs the db opens it
+static std::mutex dbMutex;
+static std::string dbPath;
+static bool dbOpened = false;
+static std::unique_ptr<CartDb> cartDb;
 
-static void InsertPrg(dbItem& cart) {
-	if(cartDb.count(cart.prgHash)) {
-		auto el = cartDb[cart.prgHash];
-		if(el.mapper != cart.mapper) {
-			// we only care about the mapper
-			logger.Log("duplicate hash found: %s from %s\n", cart.prgHash.ToString().c_str(), cart.name.c_str());
-		}
-	} else {
-		cartDb.insert(std::make_pair(cart.prgHash, cart));
-	}
+void LoadCardDb(const std::string& path) {
+	std::lock_guard lock(dbMutex);
+	dbPath = path;
 }
 
-static void InsertCart(std::string& name, Json& obj) {
-	auto board = obj["board"];
-	int mapper = board["@mapper"];
-
-	if(auto arr = board["prg"].asArray()) {
-		for(auto& entry : *arr) {
-			sha1 hash = sha1::FromString(entry["@sha1"]);
-
-			dbItem item {name, (uint16_t)mapper, hash};
-			InsertPrg(item);
-		}
-	} else {
-		sha1 hash = sha1::FromString(board["prg"]["@sha1"]);
-
-		dbItem item {name, (uint16_t)mapper, hash};
-		InsertPrg(item);
-	}
-}
+static bool FindCart(const sha1& prgHash, CartDb::Entry& entry) {
+	std::lock_guard lock(dbMutex);
+	if(!dbOpened && !dbPath.empty()) {
+		dbOpened = true;
 
-void LoadCardDb(const std::string& path) {
-	if(dbInitialized) {
-		return;
-	}
-	dbInitialized = true;
-
-	logger.Log("Loading nes cart db\n");
-
-	try {
-		Json test;
-		std::ifstream f(path);
-		f >> test;
-
-		for(auto& game : *test["database"]["game"].asArray()) {
-			std::string name = game["@name"];
-
-			auto& cartridge = game["cartridge"];
-			if(cartridge.asObject()) {
-				InsertCart(name, cartridge);
-			} else if(auto arr = cartridge.asArray()) {
-				for(auto& obj : *arr) {
-					InsertCart(name, obj);
-				}
-			} else {
-				logger.Log("invalid cart type\n");
-			}
+		try {
+			cartDb = std::make_unique<CartDb>(dbPath);
+			Log::Write("Loaded nes cart db with %zu entries\n", cartDb->Size());
+		} catch(std::exception& e) {
+			Log::Write("Failed to load cartDb: %s\n", e.what());
 		}
-		logger.Log("Finished loading %lu entries\n", cartDb.size());
-	} catch(std::exception& e) {
-		logger.Log("Failed to load cartDb: %s\n", e.what());
 	}
+	return cartDb && cartDb->Find(prgHash, entry);
 }
 
-std::shared_ptr<Mapper> LoadCart(const std::string& path) {
-	logger.Log("Loading nes ROM: %s\n", path.c_str());
-
-	std::ifstream stream(path, std::ios::binary);
-	if(!stream.good()) {
-		throw std::runtime_error("Could not open file");
-	}
-
+CartImage LoadCartImage(const RomData& file) {
 	INESheader header;
-	stream.read((char*)&header, sizeof(header));
+	if(file.size() < sizeof(header)) {
+		throw std::invalid_argument("Invalid iNES header");
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
 
 	if(!(header.name[0] == 'N' &&
 		 header.name[1] == 'E' &&
@@ -119,12 +68,13 @@ std::shared_ptr<Mapper> LoadCart(const std::string& path) {
 		throw std::invalid_argument("Invalid iNES header");
 	}
 
+	size_t offset = sizeof(header);
 	if(header.Flags6 & 0b0100) {
 		// skip trainer
-		stream.seekg(512, std::ios_base::cur);
+		offset += 512;
 	}
 
-	uint8_t mapperId = (header.Flags6 >> 4) | (header.Flags7 & 0xF0);
+	uint16_t mapperId = (header.Flags6 >> 4) | (header.Flags7 & 0xF0);
 
 	if((header.Flags7 & 0b1100) == 0b1000) {
 		throw std::logic_error("iNES 2.0 not implemented");
@@ -137,58 +87,74 @@ std::shared_ptr<Mapper> LoadCart(const std::string& path) {
 		throw std::runtime_error("Empty prg");
 	}
 
-	std::vector<uint8_t> prgRom;
-	std::vector<uint8_t> chrRom;
+	const size_t prgSize = prgBanks * 0x4000;
+	const size_t chrSize = chrBanks * 0x2000;
 
-	prgRom.resize(prgBanks * 0x4000);
-	chrRom.resize(chrBanks * 0x2000);
+	RomData prgRom, chrRom;
+	if(offset + prgSize + chrSize <= file.size()) {
+		prgRom = file.Slice(offset, prgSize);
+		chrRom = file.Slice(offset + prgSize, chrSize);
+	} else {
+		// truncated dump, the missing part reads as 0
+		std::vector<uint8_t> data(file.begin(), file.end());
+		data.resize(offset + prgSize + chrSize);
 
-	stream.read((char*)prgRom.data(), prgRom.size());
-	stream.read((char*)chrRom.data(), chrRom.size());
+		prgRom = std::vector<uint8_t>(data.begin() + offset, data.begin() + offset + prgSize);
+		chrRom = std::vector<uint8_t>(data.begin() + offset + prgSize, data.end());
+	}
 
-	sha1 prgHash((char*)prgRom.data(), prgRom.size());
-	// sha1 chrHash((char*)chrRom.data(), chrRom.size());
+	sha1 prgHash((const char*)prgRom.data(), prgRom.size());
 
-	logger.Log("prg sha1: %s\n", prgHash.ToString().c_str());
-	// logger.Log("chr sha1: %s\n", chrHash.ToString().c_str());
-	if(cartDb.count(prgHash)) {
-		const auto item = cartDb[prgHash];
-		mapperId = item.mapper;
+	Log::Write("prg sha1: %s\n", prgHash.ToString().c_str());
+	CartDb::Entry entry;
+	if(FindCart(prgHash, entry)) {
+		mapperId = entry.mapper;
 
-		logger.Log("Found cartridge \"%s\" in cartdb\n", item.name.c_str());
+		Log::Write("Found cartridge \"%s\" in cartdb\n", entry.name.c_str());
 	} else {
-		logger.Log("Couldn't find cartridge in cartdb\n");
+		Log::Write("Couldn't find cartridge in cartdb\n");
 	}
 
-	logger.Log("Mapper:%i, PRG:%i, CHR:%i  \n", mapperId, prgBanks, chrBanks);
-	std::shared_ptr<Mapper> mapper;
-	switch(mapperId) {
-		case 0: mapper = std::make_shared<Mapper000>(prgRom, chrRom); break;
-		case 1: mapper = std::make_shared<Mapper001>(prgRom, chrRom); break;
-		case 2: mapper = std::make_shared<Mapper002>(prgRom, chrRom); break;
-		case 3: mapper = std::make_shared<Mapper003>(prgRom, chrRom); break;
-		case 4: mapper = std::make_shared<Mapper004>(prgRom, chrRom); break;
-		case 7: mapper = std::make_shared<Mapper007>(prgRom, chrRom); break;
-		case 11: mapper = std::make_shared<Mapper011>(prgRom, chrRom); break;
-		// case 24: mapper = std::make_shared<VRC6Mapper>(prgRom, chrRom, false);
-		// case 26: mapper = std::make_shared<VRC6Mapper>(prgRom, chrRom, true);
-		case 65: mapper = std::make_shared<Mapper065>(prgRom, chrRom); break;
-		case 71: mapper = std::make_shared<Mapper071>(prgRom, chrRom); break;
-		case 79: mapper = std::make_shared<Mapper079>(prgRom, chrRom); break;
-		case 232: mapper = std::make_shared<Mapper232>(prgRom, chrRom); break;
-		default: throw std::logic_error("Mapper not implemented");
-	}
-	mapper->mirror = header.Flags6 & 1 ? MirrorMode::Vertical : MirrorMode::Horizontal;
+	Log::Write("Mapper:%i, PRG:%i, CHR:%i  \n", mapperId, prgBanks, chrBanks);
+
+	CartImage image;
+	image.rom = Rom::FromData(prgRom, chrRom);
+	image.mapper = mapperId;
+	image.mirror = header.Flags6 & 1 ? MirrorMode::Vertical : MirrorMode::Horizontal;
 	if(header.Flags6 & 8) {
-		mapper->mirror = MirrorMode::FourScreen;
+		image.mirror = MirrorMode::FourScreen;
 	}
+	image.hash = md5((const char*)file.data(), file.size());
+	image.hasSram = (header.Flags6 >> 1) & 1;
 
-	stream.clear();
-	stream.seekg(0, std::ios::beg);
-	mapper->hash = md5(stream);
-	mapper->hasSram = (header.Flags6 >> 1) & 1;
+	return image;
+}
 
-	if(mapper->hasSram) {
+std::shared_ptr<Mapper> CreateMapper(const CartImage& image, bool persistSaveRam) {
+	const auto& rom = image.rom;
+
+	std::shared_ptr<Mapper> mapper;
+	switch(image.mapper) {
+		case 0: mapper = std::make_shared<Mapper000>(rom); break;
+		case 1: mapper = std::make_shared<Mapper001>(rom); break;
+		case 2: mapper = std::make_shared<Mapper002>(rom); break;
+		case 3: mapper = std::make_shared<Mapper003>(rom); break;
+		case 4: mapper = std::make_shared<Mapper004>(rom); break;
+		case 7: mapper = std::make_shared<Mapper007>(rom); break;
+		case 11: mapper = std::make_shared<Mapper011>(rom); break;
+		// case 24: mapper = std::make_shared<VRC6Mapper>(rom, false);
+		// case 26: mapper = std::make_shared<VRC6Mapper>(rom, true);
+		case 65: mapper = std::make_shared<Mapper065>(rom); break;
+		case 71: mapper = std::make_shared<Mapper071>(rom); break;
+		case 79: mapper = std::make_shared<Mapper079>(rom); break;
+		case 232: mapper = std::make_shared<Mapper232>(rom); break;
+		default: throw std::logic_error("Mapper not implemented");
+	}
+	mapper->mirror = image.mirror;
+	mapper->hash = image.hash;
+	mapper->hasSram = image.hasSram;
+
+	if(mapper->hasSram && persistSaveRam) {
 		auto path = "./saves/NES/" + mapper->hash.ToString() + ".saveRam";
 		mapper->MapSaveRam(path);
 	}
@@ -196,4 +162,10 @@ std::shared_ptr<Mapper> LoadCart(const std::string& path) {
 	return mapper;
 }
 
+std::shared_ptr<Mapper> LoadCart(const std::string& path, bool persistSaveRam) {
+	Log::Write("Loading nes ROM: %s\n", path.c_str());
+
+	return CreateMapper(LoadCartImage(RomData::Load(path)), persistSaveRam);
+}
+
 }
\ No newline at end of file
@@ -8,7 +8,22 @@
 
 namespace Nes {
 
+// An iNES file parsed once. Every mapper created from it shares its rom
+struct CartImage {
+	Rom rom;
+	uint16_t mapper = 0;
+	MirrorMode mirror = MirrorMode::Horizontal;
+	bool hasSram = false;
+	// of the whole file, names the save ram
+	md5 hash;
+};
+
 void LoadCardDb(const std::string& path);
-std::shared_ptr<Mapper> LoadCart(const std::string& path);
+
+CartImage LoadCartImage(const RomData& file);
+// new mapper with its own registers and ram on top of the shared rom.
+// Battery backed ram starts zeroed and only goes to ./saves with persistSaveRam, every mapper of a rom that does that shares the file
+std::shared_ptr<Mapper> CreateMapper(const CartImage& image, bool persistSaveRam = false);
+std::shared_ptr<Mapper> LoadCart(const std::string& path, bool persistSaveRam = false);
 
 }
@@ -1,10 +1,15 @@
 #pragma once
 #include <cassert>
 #include <cstdint>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
+#include "../../../RomData.h"
+#include "../../../math.h"
 #include "../../../md5.h"
 #include "../../../saver.h"
+#include "../Scheduler.h"
 
 namespace Nes {
 
@@ -16,10 +21,61 @@ enum class MirrorMode : uint8_t {
 	FourScreen
 };
 
+// Direct pointers for every 256 byte page of the cpu address space.
+// nullptr means the page has side effects and has to go through cpuRead/cpuWrite
+struct CpuPageTable {
+	const uint8_t* read[256];
+	uint8_t* write[256];
+};
+
+// One row of an 8x8 tile in the layouts the ppu fetches it in
+struct ChrRow {
+	// both bit planes interleaved to 2 bits per pixel, leftmost pixel in the top bits
+	uint16_t pattern;
+	// low and high plane as stored and mirrored for horizontally flipped sprites
+	uint8_t planes[2][2];
+
+	static ChrRow Decode(uint8_t lo, uint8_t hi) {
+		return { math::interleave(lo, hi), { { lo, hi }, { math::reverse(lo), math::reverse(hi) } } };
+	}
+	// Index of the row containing addr in a block of decoded chr data
+	static uint32_t Index(uint32_t addr) {
+		return ((addr >> 1) & ~7u) | (addr & 7);
+	}
+};
+
+// Decoded rows for every 1 KiB page of the pattern tables.
+// nullptr means the page has side effects and has to go through ppuRead
+struct ChrPageTable {
+	const ChrRow* rows[8];
+	// rows of the chr ram inside the ppu
+	const ChrRow* ram;
+};
+
+// Rom of a cartridge with its chr already decoded. Copies share all of it,
+// so every mapper created from the same Rom uses the same memory
+struct Rom {
+	RomData prg;
+	RomData chr;
+	// indexed by ChrRow::Index of the offset in chr
+	std::shared_ptr<const std::vector<ChrRow>> chrRows;
+
+	static Rom FromData(RomData prg, RomData chr) {
+		auto rows = std::make_shared<std::vector<ChrRow>>(chr.size() / 2);
+		for(size_t i = 0; i + 16 <= chr.size(); i += 16) {
+			for(size_t j = 0; j < 8; j++) {
+				(*rows)[ChrRow::Index(i + j)] = ChrRow::Decode(chr[i + j], chr[i + j + 8]);
+			}
+		}
+		return { std::move(prg), std::move(chr), std::move(rows) };
+	}
+};
+
 class Mapper {
   public:
-	std::vector<uint8_t> prg;
-	std::vector<uint8_t> chr;
+	// shared with every other mapper of the same rom, writable memory belongs to the mapper
+	RomData prg;
+	RomData chr;
 
 	size_t prgMask;
 	size_t chrMask;
@@ -29,12 +85,52 @@ class Mapper {
 	md5 hash;
 
 	bool hasSram = false;
+	// irq is clocked by ppu bus accesses so the ppu has to run in lockstep with the cpu
+	bool ppuTimedIrq = false;
+
+  protected:
+	CpuPageTable* cpuPages = nullptr;
+	ChrPageTable* chrPages = nullptr;
+	// chr decoded once, indexed by ChrRow::Index of the offset in chr
+	std::shared_ptr<const std::vector<ChrRow>> chrRows;
+	Scheduler* scheduler = nullptr;
+
+	// Point the pages in [addr, addr + size) at data. nullptr hands them back to cpuRead/cpuWrite
+	void MapCpuRead(uint16_t addr, uint32_t size, const uint8_t* data) {
+		if(!cpuPages) return;
+		for(uint32_t i = 0; i < size; i += 0x100) {
+			cpuPages->read[(addr + i) >> 8] = data ? data + i : nullptr;
+		}
+	}
+	void MapCpuWrite(uint16_t addr, uint32_t size, uint8_t* data) {
+		if(!cpuPages) return;
+		for(uint32_t i = 0; i < size; i += 0x100) {
+			cpuPages->write[(addr + i) >> 8] = data ? data + i : nullptr;
+		}
+	}
+	// Map prg starting at offset as read only. Wraps the same way as prg[x & prgMask]
+	void MapPrg(uint16_t addr, uint32_t size, uint32_t offset) {
+		if(!cpuPages) return;
+		for(uint32_t i = 0; i < size; i += 0x100) {
+			cpuPages->read[(addr + i) >> 8] = &prg[(offset + i) & prgMask];
+		}
+	}
+
+	// Map chr starting at offset to the pattern table pages in [addr, addr + size). Wraps the same way as chr[x & chrMask].
+	// Without chr rom the ppu's chr ram is mapped at the same address instead
+	void MapChr(uint16_t addr, uint32_t size, uint32_t offset) {
+		if(!chrPages) return;
+		for(uint32_t i = 0; i < size; i += 0x400) {
+			if(chr.empty()) {
+				chrPages->rows[(addr + i) >> 10] = chrPages->ram + ChrRow::Index(addr + i);
+			} else {
+				chrPages->rows[(addr + i) >> 10] = &(*chrRows)[ChrRow::Index((offset + i) & chrMask)];
+			}
+		}
+	}
 
   public:
-	Mapper(std::vector<uint8_t> prg, std::vector<uint8_t> chr) : prg(std::move(prg)), chr(std::move(chr)) {
-		prgMask = this->prg.size() - 1;
-		chrMask = this->chr.size() - 1;
-	};
+	Mapper(const Rom& rom) : prg(rom.prg), chr(rom.chr), prgMask(prg.size() - 1), chrMask(chr.size() - 1), chrRows(rom.chrRows) {}
 	Mapper(const Mapper&) = delete;
 	virtual ~Mapper() = default;
 
@@ -52,7 +148,35 @@ class Mapper {
 		// throw std::logic_error("Saveram not supported");
 	};
 
-	virtual void CpuClock() {};
+	void AttachScheduler(Scheduler* scheduler) {
+		this->scheduler = scheduler;
+	}
+	// Called by the bus on the cpu cycle posted as Event::Mapper, after the cpu ran
+	virtual void SchedulerEvent() {};
+	// Post Event::Mapper again after loading a state
+	virtual void Reschedule() {};
+	// The master clock jumped back on a reset, times the mapper kept have to move along with it
+	virtual void Rebase(uint64_t oldClock, uint64_t newClock) {};
+
+	void AttachCpuPages(CpuPageTable* pages) {
+		cpuPages = pages;
+		UpdateCpuPages();
+	}
+	// Publish the current bank layout to the cpu page table. Has to be called whenever the layout changes.
+	// The default leaves every page to cpuRead/cpuWrite
+	virtual void UpdateCpuPages() {};
+
+	void AttachChrPages(ChrPageTable* pages) {
+		chrPages = pages;
+		UpdateChrPages();
+	}
+	// Publish the current chr banks to the ppu. Has to be called whenever they change.
+	// The default maps the ppu's chr ram for mappers that don't watch the ppu bus and leaves chr rom to ppuRead
+	virtual void UpdateChrPages() {
+		if(chr.empty() && !ppuTimedIrq) {
+			MapChr(0, 0x2000, 0);
+		}
+	};
 };
 
 }
@@ -2,7 +2,7 @@
 
 namespace Nes {
 
-Mapper000::Mapper000(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr) : Mapper(prg, chr) {
+Mapper000::Mapper000(const Rom& rom) : Mapper(rom) {
 	if(this->prg.size() > 0x8000) {
 		throw std::invalid_argument("Invalid prg size");
 	}
@@ -19,6 +19,14 @@ int Mapper000::cpuRead(uint16_t addr, uint8_t& data) {
 	return false;
 }
 
+void Mapper000::UpdateCpuPages() {
+	MapPrg(0x8000, 0x8000, 0);
+}
+
+void Mapper000::UpdateChrPages() {
+	MapChr(0x0000, 0x2000, 0);
+}
+
 bool Mapper000::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 	if(addr < 0x2000 && !chr.empty()) {
 		data = chr[addr];
@@ -5,7 +5,7 @@ namespace Nes {
 
 class Mapper000 : public Mapper {
   public:
-	Mapper000(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr);
+	Mapper000(const Rom& rom);
 	~Mapper000() override = default;
 
 	int cpuRead(uint16_t addr, uint8_t& data) override;
@@ -13,6 +13,9 @@ class Mapper000 : public Mapper {
 
 	void SaveState(saver& saver) override {}
 	void LoadState(saver& saver) override {}
+
+	void UpdateCpuPages() override;
+	void UpdateChrPages() override;
 };
 
 }
@@ -3,8 +3,8 @@
 
 namespace Nes {
 
-Mapper001::Mapper001(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr) : Mapper(prg, chr) {
-	prgRam = new uint8_t[0x2000];
+Mapper001::Mapper001(const Rom& rom) : Mapper(rom) {
+	prgRam = new uint8_t[0x2000]();
 
 	prgBankOffset[0] = 0;
 	prgBankOffset[1] = prg.size() - 0x4000;
@@ -44,13 +44,20 @@ bool Mapper001::cpuWrite(uint16_t addr, uint8_t data) {
 		return false;
 	}
 	if(lastWrite) {
-		return false;
+		lastWrite = false;
+
+		// reads from mapped pages don't reach cpuRead so check whether any cpu cycle passed since the reset.
+		// The cpu accesses the bus on every cycle so this is the same as clearing lastWrite on the next read
+		if(scheduler->Now() == lastWriteTime + 3) {
+			return false;
+		}
 	}
 
 	if(data & 0x80) {
 		shiftRegister = 0b100000;
 		Control |= 0x0C;
 		lastWrite = true;
+		lastWriteTime = scheduler->Now();
 
 		return false;
 	}
@@ -117,11 +124,14 @@ bool Mapper001::cpuWrite(uint16_t addr, uint8_t data) {
 		}
 
 		shiftRegister = 0b100000;
+		UpdateCpuPages();
+		UpdateChrPages();
 	}
 
 	return false;
 }
 
+
 bool Mapper001::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 	if(addr < 0x2000 && !chr.empty()) {
 		data = chr[((addr & 0x0FFF) | chrBankOffset[addr >> 12 & 1]) & chrMask];
@@ -132,6 +142,7 @@ bool Mapper001::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 
 void Mapper001::SaveState(saver& saver) {
 	saver << lastWrite;
+	saver << lastWriteTime;
 
 	saver << Control;
 	saver << shiftRegister;
@@ -145,11 +156,12 @@ void Mapper001::SaveState(saver& saver) {
 
 	saver << ramEnable;
 
-	saver << prgRam;
+	saver.write(prgRam, 0x2000);
 }
 
 void Mapper001::LoadState(saver& saver) {
 	saver >> lastWrite;
+	saver >> lastWriteTime;
 
 	saver >> Control;
 	saver >> shiftRegister;
@@ -163,7 +175,24 @@ void Mapper001::LoadState(saver& saver) {
 
 	saver >> ramEnable;
 
-	saver >> prgRam;
+	saver.read(prgRam, 0x2000);
+}
+
+void Mapper001::Rebase(uint64_t oldClock, uint64_t newClock) {
+	lastWriteTime = lastWriteTime - oldClock + newClock;
+}
+
+void Mapper001::UpdateCpuPages() {
+	MapCpuRead(0x6000, 0x2000, ramEnable ? prgRam : nullptr);
+	MapCpuWrite(0x6000, 0x2000, prgRam);
+
+	MapPrg(0x8000, 0x4000, prgBankOffset[0]);
+	MapPrg(0xC000, 0x4000, prgBankOffset[1]);
+}
+
+void Mapper001::UpdateChrPages() {
+	MapChr(0x0000, 0x1000, chrBankOffset[0]);
+	MapChr(0x1000, 0x1000, chrBankOffset[1]);
 }
 
 void Mapper001::MapSaveRam(const std::string& path) {
@@ -171,6 +200,7 @@ void Mapper001::MapSaveRam(const std::string& path) {
 
 	file = new MemoryMapped(path, 0x2000);
 	prgRam = file->begin();
+	UpdateCpuPages();
 }
 
 }
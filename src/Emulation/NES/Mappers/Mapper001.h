@@ -7,6 +7,8 @@ namespace Nes {
 class Mapper001 : public Mapper {
   private:
 	bool lastWrite = false;
+	// master clock of the last reset write, saved with the state and moved along on Rebase
+	uint64_t lastWriteTime = 0;
 
 	uint8_t Control = 0b01100;
 	uint8_t shiftRegister = 0b100000;
@@ -22,7 +24,7 @@ class Mapper001 : public Mapper {
 	MemoryMapped* file = nullptr;
 
   public:
-	Mapper001(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr);
+	Mapper001(const Rom& rom);
 	~Mapper001() override;
 
 	int cpuRead(uint16_t addr, uint8_t& data) override;
@@ -31,6 +33,10 @@ class Mapper001 : public Mapper {
 
 	void SaveState(saver& saver) override;
 	void LoadState(saver& saver) override;
+	void Rebase(uint64_t oldClock, uint64_t newClock) override;
+
+	void UpdateCpuPages() override;
+	void UpdateChrPages() override;
 
 	void MapSaveRam(const std::string& path) override;
 };
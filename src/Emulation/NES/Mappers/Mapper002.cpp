@@ -2,7 +2,7 @@
 
 namespace Nes {
 
-Mapper002::Mapper002(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr) : Mapper(prg, chr) {
+Mapper002::Mapper002(const Rom& rom) : Mapper(rom) {
 	if(!chr.empty()) {
 		throw std::invalid_argument("Chr not allowed");
 	}
@@ -25,11 +25,17 @@ int Mapper002::cpuRead(uint16_t addr, uint8_t& data) {
 bool Mapper002::cpuWrite(uint16_t addr, uint8_t data) {
 	if(addr >= 0x8000) {
 		selectedBank = data;
+		UpdateCpuPages();
 	}
 
 	return false;
 }
 
+void Mapper002::UpdateCpuPages() {
+	MapPrg(0x8000, 0x4000, selectedBank * 0x4000);
+	MapPrg(0xC000, 0x4000, prg.size() - 0x4000);
+}
+
 bool Mapper002::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 	return false;
 }
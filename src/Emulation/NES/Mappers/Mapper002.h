@@ -5,7 +5,7 @@ namespace Nes {
 
 class Mapper002 : public Mapper {
   public:
-	Mapper002(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr);
+	Mapper002(const Rom& rom);
 	~Mapper002() override = default;
 
 	int cpuRead(uint16_t addr, uint8_t& data) override;
@@ -15,6 +15,8 @@ class Mapper002 : public Mapper {
 	void SaveState(saver& saver) override;
 	void LoadState(saver& saver) override;
 
+	void UpdateCpuPages() override;
+
   private:
 	uint8_t selectedBank = 0;
 };
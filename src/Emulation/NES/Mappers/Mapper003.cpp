@@ -2,7 +2,7 @@
 
 namespace Nes {
 
-Mapper003::Mapper003(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr) : Mapper(prg, chr) {
+Mapper003::Mapper003(const Rom& rom) : Mapper(rom) {
 	if(this->prg.size() == 0x4000) {
 		prgMask = 0x3FFF;
 	} else if(this->prg.size() == 0x8000) {
@@ -24,11 +24,20 @@ int Mapper003::cpuRead(uint16_t addr, uint8_t& data) {
 bool Mapper003::cpuWrite(uint16_t addr, uint8_t data) {
 	if(addr >= 0x8000) {
 		selectedBank = data;
+		UpdateChrPages();
 	}
 
 	return false;
 }
 
+void Mapper003::UpdateCpuPages() {
+	MapPrg(0x8000, 0x8000, 0);
+}
+
+void Mapper003::UpdateChrPages() {
+	MapChr(0x0000, 0x2000, selectedBank * 0x2000);
+}
+
 bool Mapper003::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 	if(addr < 0x2000) {
 		data = chr[((addr & 0x1FFF) | (selectedBank * 0x2000)) & chrMask];
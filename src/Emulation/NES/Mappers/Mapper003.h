@@ -5,7 +5,7 @@ namespace Nes {
 
 class Mapper003 : public Mapper {
   public:
-	Mapper003(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr);
+	Mapper003(const Rom& rom);
 	~Mapper003() override = default;
 
 	int cpuRead(uint16_t addr, uint8_t& data) override;
@@ -15,6 +15,9 @@ class Mapper003 : public Mapper {
 	void SaveState(saver& saver) override;
 	void LoadState(saver& saver) override;
 
+	void UpdateCpuPages() override;
+	void UpdateChrPages() override;
+
   private:
 	uint8_t selectedBank = 0;
 };
@@ -3,8 +3,9 @@
 
 namespace Nes {
 
-Mapper004::Mapper004(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr) : Mapper(prg, chr) {
-	prgRam = new uint8_t[0x2000];
+Mapper004::Mapper004(const Rom& rom) : Mapper(rom) {
+	prgRam = new uint8_t[0x2000]();
+	ppuTimedIrq = true;
 
 	prgBankOffset[3] = prg.size() - 0x2000; // last bank
 	UpdateRegs();
@@ -49,7 +50,7 @@ bool Mapper004::cpuWrite(uint16_t addr, uint8_t data) {
 			break;
 		}
 		case 0x8001:
-			// logger.Log("%i = %i\n", bankSelect.bankNumber, data);
+			// Log::Write("%i = %i\n", bankSelect.bankNumber, data);
 			regs[bankSelect.bankNumber] = data;
 			UpdateRegs();
 			break;
@@ -133,7 +134,7 @@ void Mapper004::SaveState(saver& saver) {
 	saver << irqCounter;
 	saver << irqLatch;
 
-	saver << prgRam;
+	saver.write(prgRam, 0x2000);
 	// saver << ramEnable;
 }
 
@@ -149,7 +150,7 @@ void Mapper004::LoadState(saver& saver) {
 	saver >> irqCounter;
 	saver >> irqLatch;
 
-	saver >> prgRam;
+	saver.read(prgRam, 0x2000);
 	// saver >> ramEnable;
 }
 
@@ -187,6 +188,17 @@ void Mapper004::UpdateRegs() {
 		chrBankOffset[2] = (regs[1] & ~1) * 0x400;
 		chrBankOffset[3] = (regs[1] & ~1) * 0x400 + 0x400;
 	}
+
+	UpdateCpuPages();
+}
+
+void Mapper004::UpdateCpuPages() {
+	MapCpuRead(0x6000, 0x2000, prgRam);
+	MapCpuWrite(0x6000, 0x2000, prgRam);
+
+	for(int i = 0; i < 4; i++) {
+		MapPrg(0x8000 + i * 0x2000, 0x2000, prgBankOffset[i]);
+	}
 }
 
 void Mapper004::MapSaveRam(const std::string& path) {
@@ -194,6 +206,7 @@ void Mapper004::MapSaveRam(const std::string& path) {
 
 	file = new MemoryMapped(path, 0x2000);
 	prgRam = file->begin();
+	UpdateCpuPages();
 }
 
 }
@@ -36,7 +36,7 @@ class Mapper004 : public Mapper {
 	// not implemented because of compatibility issue between MMC3 and MMC6 (http://wiki.nesdev.com/w/index.php/MMC3)
 	// bool ramEnable;
   public:
-	Mapper004(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr);
+	Mapper004(const Rom& rom);
 	~Mapper004() override;
 
 	int cpuRead(uint16_t addr, uint8_t& data) override;
@@ -47,6 +47,8 @@ class Mapper004 : public Mapper {
 	void SaveState(saver& saver) override;
 	void LoadState(saver& saver) override;
 
+	void UpdateCpuPages() override;
+
 	void MapSaveRam(const std::string& path) override;
 
   private:
@@ -3,7 +3,7 @@
 
 namespace Nes {
 
-Mapper007::Mapper007(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr) : Mapper(prg, chr) {
+Mapper007::Mapper007(const Rom& rom) : Mapper(rom) {
 	if(chr.size() > 0x2000) {
 		throw std::invalid_argument("Invalid chr size");
 	}
@@ -29,10 +29,19 @@ bool Mapper007::cpuWrite(uint16_t addr, uint8_t data) {
 	} else {
 		mirror = MirrorMode::OnescreenLo;
 	}
+	UpdateCpuPages();
 
 	return false;
 }
 
+void Mapper007::UpdateCpuPages() {
+	MapPrg(0x8000, 0x8000, prgBank * 0x8000);
+}
+
+void Mapper007::UpdateChrPages() {
+	MapChr(0x0000, 0x2000, 0);
+}
+
 bool Mapper007::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 	if(addr < 0x2000 && !chr.empty()) {
 		data = chr[addr];
@@ -9,7 +9,7 @@ class Mapper011 : public Mapper {
 	uint8_t chrBank = 0;
 
   public:
-	Mapper011(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr);
+	Mapper011(const Rom& rom);
 	~Mapper011() override = default;
 
 	int cpuRead(uint16_t addr, uint8_t& data) override;
@@ -18,6 +18,9 @@ class Mapper011 : public Mapper {
 
 	void SaveState(saver& saver) override;
 	void LoadState(saver& saver) override;
+
+	void UpdateCpuPages() override;
+	void UpdateChrPages() override;
 };
 
 }
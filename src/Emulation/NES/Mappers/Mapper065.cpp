@@ -2,7 +2,7 @@
 
 namespace Nes {
 
-Mapper065::Mapper065(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr) : Mapper(prg, chr) {
+Mapper065::Mapper065(const Rom& rom) : Mapper(rom) {
 	prgBankOffset[0] = 0;
 	prgBankOffset[1] = 1;
 	prgBankOffset[2] = 0xFE;
@@ -22,12 +22,15 @@ bool Mapper065::cpuWrite(uint16_t addr, uint8_t data) {
 	switch(addr) {
 		case 0x8000:
 			prgBankOffset[0] = data;
+			UpdateCpuPages();
 			break;
 		case 0xA000:
 			prgBankOffset[1] = data;
+			UpdateCpuPages();
 			break;
 		case 0xC000:
 			prgBankOffset[2] = data;
+			UpdateCpuPages();
 			break;
 		case 0xB000:
 		case 0xB001:
@@ -38,6 +41,7 @@ bool Mapper065::cpuWrite(uint16_t addr, uint8_t data) {
 		case 0xB006:
 		case 0xB007:
 			chrBankOffset[addr & 7] = data;
+			UpdateChrPages();
 			break;
 		case 0x9001:
 			if(data >> 7) {
@@ -47,12 +51,14 @@ bool Mapper065::cpuWrite(uint16_t addr, uint8_t data) {
 			}
 			break;
 		case 0x9003:
-			irqEnable = data >> 7;
 			Irq = false;
+			irqCounter = IrqCounter();
+			irqEnable = data >> 7;
+			StartIrqCounter(irqCounter);
 			break;
 		case 0x9004:
-			irqCounter = irqReload;
 			Irq = false;
+			StartIrqCounter(irqReload);
 			break;
 		case 0x9005:
 			irqReload = (irqReload & 0x00FF) | (data << 8);
@@ -65,6 +71,18 @@ bool Mapper065::cpuWrite(uint16_t addr, uint8_t data) {
 	return false;
 }
 
+void Mapper065::UpdateCpuPages() {
+	for(int i = 0; i < 4; i++) {
+		MapPrg(0x8000 + i * 0x2000, 0x2000, prgBankOffset[i] << 13);
+	}
+}
+
+void Mapper065::UpdateChrPages() {
+	for(int i = 0; i < 8; i++) {
+		MapChr(i * 0x400, 0x400, chrBankOffset[i] << 10);
+	}
+}
+
 bool Mapper065::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 	if(addr < 0x2000) {
 		data = chr[((addr & 0x3FF) | (chrBankOffset[addr >> 10] << 10)) & chrMask];
@@ -77,16 +95,60 @@ bool Mapper065::ppuWrite(uint16_t addr, uint8_t data) {
 	return false;
 }
 
-void Mapper065::CpuClock() {
-	if(irqEnable && irqCounter != 0) {
-		irqCounter--;
-		if(irqCounter == 0) {
-			Irq = true;
-		}
+// The counter is decremented once per cpu cycle, starting with the cycle of the write.
+// Instead of doing that the cycle on which it reaches 0 is posted to the scheduler
+uint16_t Mapper065::IrqCounter() const {
+	if(!scheduler->Pending(Event::Mapper)) {
+		return irqCounter;
+	}
+	return (scheduler->Time(Event::Mapper) - scheduler->Now()) / 3 + 1;
+}
+
+void Mapper065::StartIrqCounter(uint16_t value) {
+	irqCounter = value;
+	scheduler->Cancel(Event::Mapper);
+
+	if(!irqEnable || irqCounter == 0) {
+		return;
 	}
+
+	if(irqCounter == 1) {
+		// reaches 0 on this cycle
+		irqCounter = 0;
+		Irq = true;
+	} else {
+		scheduler->Schedule(Event::Mapper, scheduler->Now() + (irqCounter - 1) * 3);
+	}
+}
+
+void Mapper065::SchedulerEvent() {
+	irqCounter = 0;
+	Irq = true;
+}
+
+void Mapper065::SaveState(saver& saver) {
+	saver << prgBankOffset;
+	saver << chrBankOffset;
+
+	saver << irqEnable;
+	saver << IrqCounter();
+	saver << irqReload;
 }
 
-void Mapper065::SaveState(saver& saver) {}
-void Mapper065::LoadState(saver& saver) {}
+void Mapper065::LoadState(saver& saver) {
+	saver >> prgBankOffset;
+	saver >> chrBankOffset;
+
+	saver >> irqEnable;
+	saver >> irqCounter;
+	saver >> irqReload;
+}
+
+void Mapper065::Reschedule() {
+	// a running counter is stored as the value it has on the next cpu cycle
+	if(irqEnable && irqCounter != 0) {
+		scheduler->Schedule(Event::Mapper, (scheduler->Now() + 2) / 3 * 3 + (irqCounter - 1) * 3);
+	}
+}
 
 }
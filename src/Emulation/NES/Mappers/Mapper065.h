@@ -9,11 +9,15 @@ class Mapper065 : public Mapper {
 	uint32_t chrBankOffset[8] {};
 
 	bool irqEnable = false;
+	// only valid while the counter is stopped, see IrqCounter
 	uint16_t irqCounter = 0;
 	uint16_t irqReload = 0;
 
+	uint16_t IrqCounter() const;
+	void StartIrqCounter(uint16_t value);
+
   public:
-	Mapper065(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr);
+	Mapper065(const Rom& rom);
 	~Mapper065() override = default;
 
 	int cpuRead(uint16_t addr, uint8_t& data) override;
@@ -24,7 +28,11 @@ class Mapper065 : public Mapper {
 	void SaveState(saver& saver) override;
 	void LoadState(saver& saver) override;
 
-	void CpuClock() override;
+	void UpdateCpuPages() override;
+	void UpdateChrPages() override;
+
+	void SchedulerEvent() override;
+	void Reschedule() override;
 };
 
 }
@@ -2,7 +2,7 @@
 
 namespace Nes {
 
-Mapper071::Mapper071(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr) : Mapper(prg, chr) {
+Mapper071::Mapper071(const Rom& rom) : Mapper(rom) {
 	prgBanks[0] = 0;
 	prgBanks[1] = 0xFF;
 }
@@ -28,6 +28,7 @@ bool Mapper071::cpuWrite(uint16_t addr, uint8_t data) {
 			case 0x6000:
 			case 0x7000:
 				prgBanks[0] = data & 0xF;
+				UpdateCpuPages();
 				break;
 		}
 	}
@@ -35,6 +36,15 @@ bool Mapper071::cpuWrite(uint16_t addr, uint8_t data) {
 	return false;
 }
 
+void Mapper071::UpdateCpuPages() {
+	MapPrg(0x8000, 0x4000, prgBanks[0] * 0x4000);
+	MapPrg(0xC000, 0x4000, prgBanks[1] * 0x4000);
+}
+
+void Mapper071::UpdateChrPages() {
+	MapChr(0x0000, 0x2000, 0);
+}
+
 bool Mapper071::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 	if(addr < 0x2000 && !chr.empty()) {
 		data = chr[addr & 0x1FFF];
@@ -8,7 +8,7 @@ class Mapper071 : public Mapper {
 	uint8_t prgBanks[2];
 
   public:
-	Mapper071(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr);
+	Mapper071(const Rom& rom);
 	~Mapper071() override = default;
 
 	int cpuRead(uint16_t addr, uint8_t& data) override;
@@ -17,6 +17,9 @@ class Mapper071 : public Mapper {
 
 	void SaveState(saver& saver) override;
 	void LoadState(saver& saver) override;
+
+	void UpdateCpuPages() override;
+	void UpdateChrPages() override;
 };
 
 }
@@ -2,7 +2,7 @@
 
 namespace Nes {
 
-Mapper079::Mapper079(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr) : Mapper(prg, chr) {}
+Mapper079::Mapper079(const Rom& rom) : Mapper(rom) {}
 
 int Mapper079::cpuRead(uint16_t addr, uint8_t& data) {
 	if(addr >= 0x8000) {
@@ -17,11 +17,21 @@ bool Mapper079::cpuWrite(uint16_t addr, uint8_t data) {
 	if((addr & 0b1110000100000000) == 0b0100000100000000) {
 		prgBank = (data >> 3) & 1;
 		chrBank = data & 7;
+		UpdateCpuPages();
+		UpdateChrPages();
 	}
 
 	return false;
 }
 
+void Mapper079::UpdateCpuPages() {
+	MapPrg(0x8000, 0x8000, prgBank * 0x8000);
+}
+
+void Mapper079::UpdateChrPages() {
+	MapChr(0x0000, 0x2000, chrBank * 0x2000);
+}
+
 bool Mapper079::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 	if(addr < 0x2000 && !chr.empty()) {
 		data = chr[((addr & 0x1FFF) | (chrBank * 0x2000)) & chrMask];
@@ -2,7 +2,7 @@
 
 namespace Nes {
 
-Mapper232::Mapper232(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr) : Mapper(prg, chr) {
+Mapper232::Mapper232(const Rom& rom) : Mapper(rom) {
 	prgBanks[0] = 0;
 	prgBanks[1] = 0xFF;
 }
@@ -28,11 +28,21 @@ bool Mapper232::cpuWrite(uint16_t addr, uint8_t data) {
 				prgBanks[1] = (prgBanks[1] & 0xC) | 3;
 				break;
 		}
+		UpdateCpuPages();
 	}
 
 	return false;
 }
 
+void Mapper232::UpdateCpuPages() {
+	MapPrg(0x8000, 0x4000, prgBanks[0] * 0x4000);
+	MapPrg(0xC000, 0x4000, prgBanks[1] * 0x4000);
+}
+
+void Mapper232::UpdateChrPages() {
+	MapChr(0x0000, 0x2000, 0);
+}
+
 bool Mapper232::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 	if(addr < 0x2000 && !chr.empty()) {
 		data = chr[addr & 0x1FFF];
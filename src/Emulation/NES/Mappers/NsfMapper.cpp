@@ -1,55 +1,54 @@
 #include "NsfMapper.h"
 
+#include <algorithm>
 #include <cstring>
-#include <fstream>
-
-#include "../../../fs.h"
-
-template<typename T>
-void read(std::ifstream& stream, T& ref) {
-	stream.read((char*)&ref, sizeof(T));
-}
 
 namespace Nes {
 
 NsfFormat::NsfFormat(const std::string& path) {
-	std::ifstream stream(path, std::ios::binary);
-
-	read(stream, format);
+	const auto file = RomData::Load(path);
+	if(file.size() < headerSize || std::memcmp(file.data(), "NESM\x1A", 5) != 0) {
+		throw std::runtime_error("Invalid nsf format");
+	}
 
-	read(stream, version);
-	read(stream, numSongs);
-	read(stream, startSong);
+	size_t pos = 0;
+	auto read = [&](auto& ref) {
+		std::memcpy(&ref, file.data() + pos, sizeof(ref));
+		pos += sizeof(ref);
+	};
 
-	read(stream, loadAddress);
-	read(stream, initAddress);
-	read(stream, playAddress);
+	read(format);
 
-	read(stream, songName);
-	read(stream, artist);
-	read(stream, copyright);
+	read(version);
+	read(numSongs);
+	read(startSong);
 
-	read(stream, playSpeedNtsc);
+	read(loadAddress);
+	read(initAddress);
+	read(playAddress);
 
-	read(stream, bankInit);
+	read(songName);
+	read(artist);
+	read(copyright);
 
-	read(stream, playSpeedPal);
+	read(playSpeedNtsc);
 
-	read(stream, palNtsc);
+	read(bankInit);
 
-	read(stream, extraSoundChip);
+	read(playSpeedPal);
 
-	length = 0;
+	read(palNtsc);
 
-	stream.read((char*)&length, 1); // reserverd
-	stream.read((char*)&length, 3); // actual length
+	read(extraSoundChip);
 
-	if(length == 0) {
-		length = fs::file_size(path) - 0x80;
+	// a reserved byte, then the 24 bit length of the data. 0 means everything up to the end of the file
+	length = file[0x7D] | file[0x7E] << 8 | file[0x7F] << 16;
+	const auto available = (uint32_t)(file.size() - headerSize);
+	if(length == 0 || length > available) {
+		length = available;
 	}
 
-	rom.resize(length);
-	stream.read((char*)rom.data(), length);
+	rom = file.Slice(headerSize, length);
 }
 
 //NSF ROM and general approaches are heavily derived from BizHawk. the general ideas:
@@ -63,7 +62,7 @@ const uint16_t NMI_VECTOR = 0x3800;
 const uint16_t RESET_VECTOR = 0x3820;
 
 NsfMapper::NsfMapper(const std::string& path)
-	: Mapper({}, {}), nsf(path) {
+	: Mapper(Rom {}), nsf(path) {
 	NSFROM[0x12] = nsf.initAddress & 0xFF;
 	NSFROM[0x13] = nsf.initAddress >> 8;
 	NSFROM[0x19] = nsf.playAddress & 0xFF;
@@ -82,9 +81,10 @@ NsfMapper::NsfMapper(const std::string& path)
 			BankSwitched = true;
 	}
 
+	// the only copy of the data, with the load address applied
 	if(!BankSwitched) {
 		int load_start = nsf.loadAddress - 0x8000;
-		int load_size = nsf.length;
+		int load_size = std::min<int>(nsf.length, sizeof(FakePRG) - load_start);
 
 		std::memset(FakePRG, 0, sizeof(FakePRG));
 		std::memcpy(FakePRG + load_start, nsf.rom.data(), load_size);
@@ -154,12 +154,31 @@ bool NsfMapper::cpuWrite(uint16_t addr, uint8_t data) {
 		case 0x5FFE:
 		case 0x5FFF:
 			prg_banks_4k[addr - 0x5FF8] = data >= (nsf.length >> 12) ? 0 : data;
+			UpdateCpuPages();
 			return true;
 	}
 
 	return false;
 }
 
+void NsfMapper::UpdateCpuPages() {
+	// the driver at $3800, the registers at $3FFx and the patched vectors at $FFFA stay on cpuRead
+	for(uint32_t addr = 0; addr < 0x7F00; addr += 0x100) {
+		const uint8_t* data = nullptr;
+
+		if(BankSwitched) {
+			uint32_t offset = (addr & 0xFFF) | (prg_banks_4k[(addr >> 12) & 7] << 12);
+			if(offset + 0x100 <= nsf.rom.size()) {
+				data = &nsf.rom[offset];
+			}
+		} else {
+			data = FakePRG + addr;
+		}
+
+		MapCpuRead(0x8000 + addr, 0x100, data);
+	}
+}
+
 bool NsfMapper::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 	return false;
 }
@@ -37,7 +37,10 @@ struct NsfFormat {
 	} extraSoundChip;
 
 	uint32_t length;
-	std::vector<uint8_t> rom;
+	// the data after the header, shares the read only mapping of the file
+	RomData rom;
+
+	static constexpr size_t headerSize = 0x80;
 
 	NsfFormat(const std::string& path);
 };
@@ -127,6 +130,8 @@ class NsfMapper : public Mapper {
 
 	void SaveState(saver& saver) override;
 	void LoadState(saver& saver) override;
+
+	void UpdateCpuPages() override;
 };
 
 }
@@ -2,7 +2,7 @@
 
 namespace Nes {
 
-VRC6Mapper::VRC6Mapper(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr, bool swap) : Mapper(prg, chr), swap(swap) {
+VRC6Mapper::VRC6Mapper(const Rom& rom, bool swap) : Mapper(rom), swap(swap) {
 	prgBanks = prg.size() / 0x4000;
 	chrBanks = chr.size() / 0x2000;
 
@@ -28,15 +28,18 @@ bool VRC6Mapper::cpuWrite(uint16_t addr, uint8_t data) {
 		case 0x8003:
 			prgBankOffset[0] = data * 0x4000;
 			prgBankOffset[1] = data * 0x4000 + 0x2000;
+			UpdateCpuPages();
 			return true;
 		case 0xC000:
 		case 0xC001:
 		case 0xC002:
 		case 0xC003:
 			prgBankOffset[2] = data * 0x2000;
+			UpdateCpuPages();
 			return true;
 		case 0xB003:
 			ramEnable = data >> 7;
+			UpdateCpuPages();
 			break;
 		case 0xD000:
 		case 0xD001:
@@ -52,6 +55,14 @@ bool VRC6Mapper::cpuWrite(uint16_t addr, uint8_t data) {
 	return false;
 }
 
+void VRC6Mapper::UpdateCpuPages() {
+	MapCpuRead(0x6000, 0x2000, ramEnable ? prgRam : nullptr);
+
+	for(int i = 0; i < 4; i++) {
+		MapPrg(0x8000 + i * 0x2000, 0x2000, prgBankOffset[i]);
+	}
+}
+
 bool VRC6Mapper::ppuRead(uint16_t addr, uint8_t& data, bool readOnly) {
 	if(addr >= 0x2000 || chrBanks == 0)
 		return false;
@@ -16,7 +16,7 @@ class VRC6Mapper : public Mapper {
 	uint8_t prgRam[0x2000];
 
   public:
-	VRC6Mapper(const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr, bool swap);
+	VRC6Mapper(const Rom& rom, bool swap);
 	~VRC6Mapper() override = default;
 
 	int cpuRead(uint16_t addr, uint8_t& data) override;
@@ -26,6 +26,8 @@ class VRC6Mapper : public Mapper {
 
 	void SaveState(saver& saver) override {}
 	void LoadState(saver& saver) override {}
+
+	void UpdateCpuPages() override;
 };
 
 }
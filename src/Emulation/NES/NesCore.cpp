@@ -3,6 +3,7 @@
 #include <algorithm>
 
 #include "../../Input.h"
+#include "../../audio.h"
 #include "../../logger.h"
 #include "../../fs.h"
 
@@ -14,9 +15,11 @@ namespace Nes {
 Core::Core() : texture(256, 240) {
 	LoadCardDb("./NesCarts (2017-08-21).json");
 
-	emulator.controller1 = std::make_shared<StandardController>(0);
-	emulator.controller2 = std::make_shared<StandardController>(1);
+	emulator.controller1 = std::make_shared<StandardController>();
+	emulator.controller2 = std::make_shared<StandardController>();
 	emulator.ppu.texture = &texture;
+	emulator.apu.SetSampleSink(Audio::Output());
+	texture.SetPalette(ppu2C02::colors, 64);
 
 	tables.ppu = &emulator.ppu;
 	cpuWindow.cpu = &emulator.cpu;
@@ -114,7 +117,16 @@ void Core::DrawMenuBar(bool& menuOpen) {
 			apuWindow.Open();
 		}
 		if(ImGui::MenuItem("Disassembler")) {
-			disassembler.Open(emulator.cartridge->prg);
+			disassembler.Open({ emulator.cartridge->prg.begin(), emulator.cartridge->prg.end() });
+		}
+
+		bool catchUp = emulator.GetPpuSync() == PpuSync::CatchUp;
+		if(ImGui::MenuItem("Catch-up PPU", nullptr, &catchUp)) {
+			emulator.SetPpuSync(catchUp ? PpuSync::CatchUp : PpuSync::Lockstep);
+		}
+		bool instructionCore = emulator.GetCpuCore() == CpuCore::Instruction;
+		if(ImGui::MenuItem("Instruction CPU", nullptr, &instructionCore)) {
+			emulator.SetCpuCore(instructionCore ? CpuCore::Instruction : CpuCore::Cycle);
 		}
 
 		ImGui::EndMenu();
@@ -129,7 +141,7 @@ void Core::LoadState(saver& saver) {
 	emulator.LoadState(saver);
 }
 
-void Core::LoadRom(const std::string& path) {
+void Core::LoadRom(const std::string& path, bool persistSaveRam) {
 	auto ext = fs::path(path).extension().string();
 	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
 
@@ -137,7 +149,7 @@ void Core::LoadRom(const std::string& path) {
 		std::shared_ptr<Mapper> cart;
 
 		try {
-			cart = LoadCart(path);
+			cart = LoadCart(path, persistSaveRam);
 		} catch(std::exception& e) {
 			logger.Log("Failed to load rom: %s\n", e.what());
 			return;
@@ -156,8 +168,8 @@ void Core::LoadRom(const std::string& path) {
 		emulator.InsertCartridge(ptr);
 		emulator.HardReset();
 
-		emulator.controller1 = std::make_shared<StandardController>(0);
-		emulator.controller2 = std::make_shared<StandardController>(1);
+		emulator.controller1 = std::make_shared<StandardController>();
+		emulator.controller2 = std::make_shared<StandardController>();
 
 		emulator.ppu.Control.enableNMI = true;
 
@@ -190,15 +202,31 @@ void Core::Reset() {
 	emulator.Reset();
 }
 
+void Core::SetOutput(bool video, bool audio) {
+	emulator.ppu.render = video;
+	emulator.apu.SetSampleSink(audio ? Audio::Output() : Audio::SampleSink {});
+}
+
 void Core::HardReset() {
 	emulator.HardReset();
 }
 
+static void UpdateController(Controller* controller, int number) {
+	if(auto standard = dynamic_cast<StandardController*>(controller)) {
+		uint8_t val = 0;
+		for(int i = 0; i < 8; ++i) {
+			val |= Input::NES.GetKey(number * 8 + i) << i;
+		}
+		standard->buttons = val;
+	}
+}
+
 void Core::Update() {
+	UpdateController(emulator.controller1.get(), 0);
+	UpdateController(emulator.controller2.get(), 1);
+
 	// 89342 cycles per frame
-	while(!emulator.ppu.frameComplete) {
-		emulator.Clock();
-	}
+	emulator.RunFrame();
 	emulator.ppu.frameComplete = false;
 
 	/*if(runningTas) {
@@ -207,8 +235,7 @@ void Core::Update() {
 	}*/
 
 	// step = false;
-	emulator.apu.lastBufferPos = emulator.apu.bufferPos;
-	emulator.apu.bufferPos = 0;
+	emulator.apu.EndFrame();
 }
 
 }
@@ -39,10 +39,13 @@ class Core : public ICore {
 	void SaveState(saver& saver) override;
 	void LoadState(saver& saver) override;
 
-	void LoadRom(const std::string& path) override;
+	void LoadRom(const std::string& path, bool persistSaveRam) override;
 	void Reset() override;
 	void HardReset() override;
 	void Update() override;
+
+	void SetOutput(bool video, bool audio) override;
+	RenderImage& Screen() override { return texture; }
 };
 
 }
@@ -1,9 +1,10 @@
 #include "RP2A03.h"
 
-#include "../../audio.h"
 #include "Bus.h"
 
 #include <cassert>
+#include <cmath>
+#include <iterator>
 
 namespace Nes {
 
@@ -27,19 +28,24 @@ const uint16_t noiseTable[] = { 4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 5
 const uint16_t dmcTable[]   = { 428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54 };
 // clang-format on
 
-void Pulse::Clock() {
+// cpu cycles per entry of the visualization buffer
+static constexpr int waveClocks = 40;
+
+bool Pulse::Clock() {
 	if(timer == 0) {
 		timer = timerPeriod;
 
+		const auto last = dutyTable[dutyCycle][dutyValue];
 		dutyValue = (dutyValue + 1) % 8;
-	} else {
-		timer--;
+		return dutyTable[dutyCycle][dutyValue] != last;
 	}
+	timer--;
+	return false;
 }
 
-void vrc6Pulse::Clock(uint8_t freqShift) {
+bool vrc6Pulse::Clock(uint8_t freqShift) {
 	if(!enabled) {
-		return;
+		return false;
 	}
 	if(timer == 0) {
 		timer = timerPeriod >> freqShift;
@@ -49,18 +55,20 @@ void vrc6Pulse::Clock(uint8_t freqShift) {
 		} else {
 			dutyValue--;
 		}
-	} else {
-		timer--;
+		// the output only changes when the duty flips
+		return !mode && (dutyValue == 15 || dutyValue == dutyCycle);
 	}
+	timer--;
+	return false;
 }
 
 uint8_t vrc6Pulse::Output() {
 	return enabled && (mode || dutyValue <= dutyCycle) ? Volume : 0;
 }
 
-void vrc6Sawtooth::Clock(uint8_t freqShift) {
+bool vrc6Sawtooth::Clock(uint8_t freqShift) {
 	if(!enabled) {
-		return;
+		return false;
 	}
 	if(timer == 0) {
 		timer = timerPeriod >> freqShift;
@@ -74,31 +82,34 @@ void vrc6Sawtooth::Clock(uint8_t freqShift) {
 			step = 0;
 			accumulator = 0;
 		}
-	} else {
-		timer--;
+		return true;
 	}
+	timer--;
+	return false;
 }
 
 uint8_t vrc6Sawtooth::Output() {
 	return enabled ? accumulator >> 3 : 0;
 }
 
-void Triangle::Clock() {
+bool Triangle::Clock() {
 	if(timerPeriod < 2) {
-		return; // High pass filter cheat
+		return false; // High pass filter cheat
 	}
 	if(timer == 0) {
 		timer = timerPeriod;
 
 		if(linearCounter > 0 && lengthCounter > 0) {
 			dutyValue = (dutyValue + 1) & 0x1F;
+			return true;
 		}
-	} else {
-		timer--;
+		return false;
 	}
+	timer--;
+	return false;
 }
 
-void Noise::Clock() {
+bool Noise::Clock() {
 	if(timer == 0) {
 		timer = timerPeriod;
 
@@ -114,9 +125,18 @@ void Noise::Clock() {
 
 		shiftRegister >>= 1;
 		shiftRegister |= (b1 ^ b2) << 14;
-	} else {
-		timer--;
+		// the output is muted by bit 0
+		return (shiftRegister & 1) != b1;
+	}
+	timer--;
+	return false;
+}
+
+uint8_t Noise::Output() const {
+	if(!enabled || lengthCounter == 0 || (shiftRegister & 1) != 0) {
+		return 0;
 	}
+	return envelopeEnabled ? constantVolume : envelopeVolume;
 }
 
 void SoundBase::ClockLength() {
@@ -226,18 +246,20 @@ uint8_t Pulse::Output() const {
 	}
 }
 
-void DMC::Clock(Bus& bus) {
+bool DMC::Clock(Bus& bus) {
 	if(timer > 0) {
 		timer -= 2;
-		return;
+		return false;
 	}
 	timer = timerPeriod;
 
+	bool changed = false;
 	if(!silence) {
 		int step = (shiftRegister & 1) * 4 - 2;
 
 		if(unsigned(value + step) <= 0x7F) {
 			value += step;
+			changed = true;
 		}
 	}
 
@@ -257,6 +279,7 @@ void DMC::Clock(Bus& bus) {
 			FillBuffer(bus);
 		}
 	}
+	return changed;
 }
 
 void DMC::Reload() {
@@ -287,11 +310,20 @@ void DMC::FillBuffer(Bus& bus) {
 	}
 }
 
-RP2A03::RP2A03(Bus* bus): bus(bus) {
+RP2A03::RP2A03(Bus* bus): bus(bus), blip(clockRate, sampleRate, sampleRate / 10) {
 	pulse1.negative = 1;
 }
 
-void RP2A03::Clock() {
+void RP2A03::SetSampleSink(Audio::SampleSink sink) {
+	const bool reconnect = sink.Connected() && !sampleSink.Connected();
+	sampleSink = sink;
+	// the channels kept changing without being mixed, amplitude is still the level from before
+	if(reconnect) {
+		UpdateOutput();
+	}
+}
+
+void RP2A03::StepFrameCounter() {
 	if(frameCounterMode) {
 		switch(frameCounter) {
 			case 7457:
@@ -326,23 +358,47 @@ void RP2A03::Clock() {
 				break;
 		}
 	}
+}
+
+int RP2A03::CyclesTillFrameStep() const {
+	static const int steps4[] = { 7457, 14913, 22371, 29828, 29829, 29830 };
+	static const int steps5[] = { 7457, 14913, 22371, 37281 };
+
+	if(frameCounterMode) {
+		for(int step : steps5) {
+			if(step >= frameCounter) return step - frameCounter;
+		}
+	} else {
+		for(int step : steps4) {
+			if(step >= frameCounter) return step - frameCounter;
+		}
+	}
 
-	if(frameCounter % 40 == 0)
-		GenerateSample();
+	// frame counter was pushed past the wrap around by a reset
+	return -1;
+}
 
+void RP2A03::Clock() {
+	bool changed = outputDirty;
 	if(frameCounter % 2 == 0) {
-		pulse1.Clock();
-		pulse2.Clock();
-		noise.Clock();
-		dmc.Clock(*bus);
+		changed |= pulse1.Clock();
+		changed |= pulse2.Clock();
+		changed |= noise.Clock();
+		changed |= dmc.Clock(*bus);
 	}
-	triangle.Clock();
+	changed |= triangle.Clock();
 	if(vrc6 && !vrc6Halt) {
-		vrc6Pulse1.Clock(vrc6FreqShift);
-		vrc6Pulse2.Clock(vrc6FreqShift);
-		vrc6Saw.Clock(vrc6FreqShift);
+		changed |= vrc6Pulse1.Clock(vrc6FreqShift);
+		changed |= vrc6Pulse2.Clock(vrc6FreqShift);
+		changed |= vrc6Saw.Clock(vrc6FreqShift);
 	}
 
+	// mixing only happens when a channel changed, silent or steady ones cost nothing
+	if(changed && sampleSink.Connected()) {
+		UpdateOutput();
+	}
+	frameClock++;
+
 	frameCounter++;
 	if(frameCounterMode) {
 		if(frameCounter == 37282) {
@@ -356,6 +412,7 @@ void RP2A03::Clock() {
 }
 
 void RP2A03::Reset() {
+	outputDirty = true;
 	pulse1.enabled = false;
 	pulse2.enabled = false;
 	triangle.enabled = false;
@@ -377,6 +434,8 @@ void RP2A03::Reset() {
 }
 
 void RP2A03::CpuWrite(uint16_t addr, uint8_t data) {
+	outputDirty = true;
+
 	switch(addr) {
 		#pragma region Pulse
 		case 0x4000: pulse1.WriteControl(data); return;
@@ -585,6 +644,7 @@ uint8_t RP2A03::ReadStatus(bool readOnly) {
 }
 
 void RP2A03::ClockEnvelope() {
+	outputDirty = true;
 	pulse1.ClockEnvelope();
 	pulse2.ClockEnvelope();
 
@@ -601,6 +661,7 @@ void RP2A03::ClockEnvelope() {
 }
 
 void RP2A03::ClockLength() {
+	outputDirty = true;
 	pulse1.ClockLength();
 	pulse2.ClockLength();
 	triangle.ClockLength();
@@ -610,18 +671,22 @@ void RP2A03::ClockLength() {
 	pulse2.ClockSweep();
 }
 
-void RP2A03::GenerateSample() {
-	auto& buf = waveBuffer[bufferPos];
-
-	if(noise.enabled && noise.lengthCounter > 0 && (noise.shiftRegister & 1) == 0) {
-		buf.noise = noise.envelopeEnabled ? noise.constantVolume : noise.envelopeVolume;
-	} else {
-		buf.noise = 0;
+void RP2A03::FillWave() {
+	for(; (uint32_t)bufferPos * waveClocks < frameClock && bufferPos < bufferLength; bufferPos++) {
+		waveBuffer[bufferPos] = wave;
 	}
+}
+
+void RP2A03::UpdateOutput() {
+	outputDirty = false;
 
-	buf.dmc = dmc.value;
+	const auto noiseOut = noise.Output();
+	if(noiseOut != wave.noise || dmc.value != wave.dmc) {
+		FillWave();
+		wave = { noiseOut, dmc.value };
+	}
 
-	float tnd_out = 159.79f / (1.0f / (triangleTable[triangle.dutyValue] / 8227.0f + buf.noise / 12241.0f + (dmc.value / 22638.0f)) + 100);
+	float tnd_out = 159.79f / (1.0f / (triangleTable[triangle.dutyValue] / 8227.0f + noiseOut / 12241.0f + (dmc.value / 22638.0f)) + 100);
 	float pulse_out = 95.88f / (8128.0f / (pulse1.Output() + pulse2.Output()) + 100);
 	float output = tnd_out + pulse_out;
 
@@ -629,16 +694,29 @@ void RP2A03::GenerateSample() {
 		output += (vrc6Pulse1.Output() + vrc6Pulse2.Output() + vrc6Saw.Output()) / -100.0f;
 	}
 
-	Audio::PushSample(output);
-	bufferPos++;
-	if(bufferPos >= bufferLength) {
-		// __debugbreak();
-		throw std::runtime_error("Buffer overflow");
+	const auto value = (int32_t)std::lround(output * BlipBuffer::one);
+	if(value != amplitude) {
+		blip.AddDelta(frameClock, value - amplitude);
+		amplitude = value;
 	}
 }
 
-bool RP2A03::GetIrq() {
-	return Irq || dmc.irq;
+void RP2A03::EndFrame() {
+	if(sampleSink.Connected()) {
+		FillWave();
+
+		blip.EndFrame(frameClock);
+		float samples[512];
+		while(size_t count = blip.Read(samples, std::size(samples))) {
+			for(size_t i = 0; i < count; i++) {
+				sampleSink.Push(samples[i]);
+			}
+		}
+	}
+
+	lastBufferPos = bufferPos;
+	bufferPos = 0;
+	frameClock = 0;
 }
 
 void RP2A03::SaveState(saver& saver) {
@@ -649,6 +727,8 @@ void RP2A03::SaveState(saver& saver) {
 void RP2A03::LoadState(saver& saver) {
 	saver >> *reinterpret_cast<RP2A03state*>(this);
 	bufferPos = 0;
+	// the next clock steps from the output before the load to the loaded one
+	outputDirty = true;
 }
 
 }
@@ -1,4 +1,6 @@
 #pragma once
+#include "../../audioSink.h"
+#include "../../blipBuffer.h"
 #include "../../saver.h"
 
 namespace Nes {
@@ -6,10 +8,10 @@ namespace Nes {
 class Bus;
 
 struct SoundBase {
-	bool enabled;
+	bool enabled = false;
 	bool lengthCounterEnabled = true;
-	uint8_t lengthCounterPeriod;
-	uint8_t lengthCounter;
+	uint8_t lengthCounterPeriod = 0;
+	uint8_t lengthCounter = 0;
 
 	uint16_t timer = 0;
 	uint16_t timerPeriod = 0;
@@ -18,56 +20,58 @@ struct SoundBase {
 };
 
 struct Envelope : SoundBase {
-	bool envelopeEnabled;
-	bool envelopeLoop;
-	bool envelopeStart;
-	uint8_t envelopePeriod;
-	uint8_t envelopeValue;
-	uint8_t envelopeVolume;
-	uint8_t constantVolume;
+	bool envelopeEnabled = false;
+	bool envelopeLoop = false;
+	bool envelopeStart = false;
+	uint8_t envelopePeriod = 0;
+	uint8_t envelopeValue = 0;
+	uint8_t envelopeVolume = 0;
+	uint8_t constantVolume = 0;
 
 	void ClockEnvelope();
 };
 
 struct Pulse : Envelope {
-	uint8_t negative;
+	uint8_t negative = 0;
 
-	uint8_t dutyCycle;
-	uint8_t dutyValue;
+	uint8_t dutyCycle = 0;
+	uint8_t dutyValue = 0;
 
-	bool sweepReload;
-	bool sweepEnabled;
-	bool sweepNegate;
-	uint8_t sweepShift;
-	uint8_t sweepPeriod;
-	uint8_t sweepValue;
+	bool sweepReload = false;
+	bool sweepEnabled = false;
+	bool sweepNegate = false;
+	uint8_t sweepShift = 0;
+	uint8_t sweepPeriod = 0;
+	uint8_t sweepValue = 0;
 
 	void WriteControl(uint8_t data);
 	void WriteSweep(uint8_t data);
 	void WriteTimerLow(uint8_t data);
 	void WriteTimerHigh(uint8_t data);
 
-	void Clock();
+	// the channel clocks return true if their output might have changed
+	bool Clock();
 	void ClockSweep();
 
 	uint8_t Output() const;
 };
 
 struct Triangle : SoundBase {
-	uint8_t dutyValue;
+	uint8_t dutyValue = 0;
 
-	uint8_t linearCounterPeriod;
+	uint8_t linearCounterPeriod = 0;
 	uint8_t linearCounter = 0;
-	bool linearCounterReload;
+	bool linearCounterReload = false;
 
-	void Clock();
+	bool Clock();
 };
 
 struct Noise : Envelope {
-	bool mode;
+	bool mode = false;
 	uint16_t shiftRegister = 1;
 
-	void Clock();
+	bool Clock();
+	uint8_t Output() const;
 };
 
 struct vrc6Pulse {
@@ -82,7 +86,7 @@ struct vrc6Pulse {
 	uint16_t timer = 0;
 	uint16_t timerPeriod = 0;
 
-	void Clock(uint8_t freqShift);
+	bool Clock(uint8_t freqShift);
 	uint8_t Output();
 };
 
@@ -96,18 +100,18 @@ struct vrc6Sawtooth {
 	uint16_t timer = 0;
 	uint16_t timerPeriod = 0;
 
-	void Clock(uint8_t freqShift);
+	bool Clock(uint8_t freqShift);
 	uint8_t Output();
 };
 
 struct DMC {
-	bool enabled;
+	bool enabled = false;
 	bool irq = false;
 
-	bool irqEnable;
-	bool loop;
+	bool irqEnable = false;
+	bool loop = false;
 
-	bool silence;
+	bool silence = false;
 
 	uint8_t value = 0;
 	uint16_t sampleAddress = 0;
@@ -125,7 +129,7 @@ struct DMC {
 	uint16_t timer = 0;
 	uint16_t timerPeriod = 0;
 
-	void Clock(Bus& bus);
+	bool Clock(Bus& bus);
 	void Reload();
 	void FillBuffer(Bus& bus);
 };
@@ -160,16 +164,39 @@ class RP2A03 : public RP2A03state {
   private:
 	Bus* bus = nullptr;
 
+	// one entry every waveClocks cpu cycles of the current frame
 	int bufferPos = 0;
 	int lastBufferPos = 0;
-	struct {
+	struct Wave {
 		uint8_t noise, dmc;
 	} waveBuffer[bufferLength];
+	// what the entries after bufferPos are filled with
+	Wave wave {};
+
+	// cpu cycles since the last EndFrame
+	uint32_t frameClock = 0;
+	// a register write or frame counter step might have changed the output
+	bool outputDirty = true;
+	int32_t amplitude = 0;
+	BlipBuffer blip;
+
+	// receives the samples at sampleRate whenever a frame ends
+	Audio::SampleSink sampleSink;
 
   public:
+	static constexpr int clockRate = 1789773;
+	static constexpr int sampleRate = 44100;
+
 	RP2A03(Bus* bus);
 
+	// Nothing is mixed while no sink is connected, connecting one mixes the current levels again
+	void SetSampleSink(Audio::SampleSink sink);
+
 	void Clock();
+	// envelope, length and irq steps of the frame counter, only needed when CyclesTillFrameStep reaches 0
+	void StepFrameCounter();
+	// number of Clock calls until the one on which StepFrameCounter has to run, -1 if there is none
+	int CyclesTillFrameStep() const;
 	void Reset();
 
 	void CpuWrite(uint16_t addr, uint8_t data);
@@ -178,11 +205,20 @@ class RP2A03 : public RP2A03state {
 	void ClockEnvelope();
 	void ClockLength();
 
-	void GenerateSample();
-	bool GetIrq();
+	// Sends the samples of the current frame to sampleSink and starts filling the visualization buffer from the beginning again.
+	// Has to be called at least every 100ms of emulated time
+	void EndFrame();
+	bool GetIrq() const { return Irq || dmc.irq; }
+	// the dmc can read sample bytes over the cpu bus on any Clock
+	bool DmcActive() const { return dmc.currentLength > 0; }
 
 	void SaveState(saver& saver);
 	void LoadState(saver& saver);
+
+  private:
+	// mixes the channels and adds a step to blip if the result changed
+	void UpdateOutput();
+	void FillWave();
 };
 
 }
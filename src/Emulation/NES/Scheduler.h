@@ -0,0 +1,81 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+namespace Nes {
+
+enum class Event {
+	// ppu reaches vblank or the end of the frame (or has to catch up in PpuSync::CatchUp)
+	Ppu,
+	// a pending nmi has to be counted down
+	Nmi,
+	// oam dma in progress
+	Dma,
+	// apu frame counter step
+	ApuFrame,
+	// mapper irq counter
+	Mapper,
+
+	Count
+};
+
+// Master clock tick at which each event source needs attention next.
+// There are only a handful of sources so a table with a cached minimum is cheaper than a heap
+class Scheduler {
+  public:
+	static constexpr uint64_t Never = UINT64_MAX;
+
+  private:
+	const uint64_t& clock;
+
+	uint64_t times[(int)Event::Count];
+	uint64_t next = Never;
+
+	void Update() {
+		next = *std::min_element(std::begin(times), std::end(times));
+	}
+
+  public:
+	Scheduler(const uint64_t& clock) : clock(clock) {
+		Clear();
+	}
+	Scheduler(const Scheduler&) = delete;
+
+	uint64_t Now() const { return clock; }
+	uint64_t Next() const { return next; }
+
+	uint64_t Time(Event event) const { return times[(int)event]; }
+	bool Pending(Event event) const { return times[(int)event] != Never; }
+	bool Due(Event event) const { return times[(int)event] <= clock; }
+
+	void Schedule(Event event, uint64_t time) {
+		times[(int)event] = time;
+		Update();
+	}
+	void Cancel(Event event) {
+		Schedule(event, Never);
+	}
+	void Delay(Event event, uint64_t ticks) {
+		if(Pending(event)) {
+			Schedule(event, times[(int)event] + ticks);
+		}
+	}
+
+	// used when the master clock jumps (reset)
+	void Rebase(uint64_t oldClock, uint64_t newClock) {
+		for(auto& time : times) {
+			if(time != Never) {
+				time = time - oldClock + newClock;
+			}
+		}
+		Update();
+	}
+
+	void Clear() {
+		std::fill(std::begin(times), std::end(times), Never);
+		next = Never;
+	}
+};
+
+}
@@ -5,13 +5,13 @@ namespace Nes {
 
 class StandardController : public Controller {
   private:
-	int number;
-
 	uint8_t ControllerLatch = 0;
 	bool ShiftStrobe = false;
 
   public:
-	StandardController(int number);
+	// one bit per button in the order they are shifted out, A in bit 0. Set by the frontend
+	uint8_t buttons = 0;
+
 	~StandardController() override = default;
 
 	void CpuWrite(uint16_t addr, uint8_t data) override;
@@ -3,13 +3,6 @@
 
 namespace Nes {
 
-static uint8_t FlipByte(uint8_t b) {
-	b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
-	b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
-	b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
-	return b;
-}
-
 PatternTables::PatternTables(std::string title)
 	: Title(std::move(title)), image(256, 160) {
 	// 256x128 pattern tables
@@ -127,13 +120,9 @@ void PatternTables::RenderSprite(int id) {
 			addr |= y1 & 0x7;
 		}
 
-		uint8_t lo = ppu->ppuRead(addr, true);
-		uint8_t hi = ppu->ppuRead(addr + 8, true);
-
-		if(sprite.Attributes.FlipHorizontal) {
-			lo = FlipByte(lo);
-			hi = FlipByte(hi);
-		}
+		const auto planes = ppu->PatternRow(addr).planes[sprite.Attributes.FlipHorizontal];
+		uint8_t lo = planes[0];
+		uint8_t hi = planes[1];
 
 		for(int x1 = 0; x1 < 8; ++x1) {
 			uint8_t p0_pixel = (lo & 0x80) > 0;
@@ -156,21 +145,15 @@ void PatternTables::DrawPatternTable() {
 			uint16_t nOffset = (nTileY * 16 + nTileX) * 16;
 
 			for(uint16_t row = 0; row < 8; row++) {
-				uint8_t tile_lsb1 = ppu->ppuRead(nOffset + row + 0, true);
-				uint8_t tile_msb1 = ppu->ppuRead(nOffset + row + 8, true);
-
-				uint8_t tile_lsb2 = ppu->ppuRead(0x1000 + nOffset + row + 0, true);
-				uint8_t tile_msb2 = ppu->ppuRead(0x1000 + nOffset + row + 8, true);
+				uint16_t tile1 = ppu->PatternRow(nOffset + row).pattern;
+				uint16_t tile2 = ppu->PatternRow(0x1000 + nOffset + row).pattern;
 
 				for(uint16_t col = 0; col < 8; col++) {
-					uint8_t pixel1 = (tile_lsb1 & 1) | ((tile_msb1 & 1) << 1);
-					uint8_t pixel2 = (tile_lsb2 & 1) | ((tile_msb2 & 1) << 1);
-
-					tile_lsb1 >>= 1;
-					tile_msb1 >>= 1;
+					uint8_t pixel1 = tile1 & 3;
+					uint8_t pixel2 = tile2 & 3;
 
-					tile_lsb2 >>= 1;
-					tile_msb2 >>= 1;
+					tile1 >>= 2;
+					tile2 >>= 2;
 
 					auto color1 = ppu->GetPaletteColor(pallet1, pixel1);
 					auto color2 = ppu->GetPaletteColor(pallet2, pixel2);
@@ -1,10 +1,17 @@
 #include "mos6502.h"
 #include "Bus.h"
 
+// the opcode handlers rely on these being folded for a constant instruction
+#ifdef _MSC_VER
+#define CPU_INLINE __forceinline
+#else
+#define CPU_INLINE inline __attribute__((always_inline))
+#endif
+
 namespace Nes {
 
 // address mode of jsr changed
-const Instruction lookup[] = {
+constexpr Instruction lookup[] = {
 	{BRK, IMP}, {ORA, IZX}, {KIL, IMM}, {SLO, IZX}, {NOP, ZP0}, {ORA, ZP0}, {ASL, ZP0}, {SLO, ZP0}, {PHP, IMP}, {ORA, IMM}, {ASL, IMP}, {ANC, IMM}, {NOP, ABS}, {ORA, ABS}, {ASL, ABS}, {SLO, ABS},
 	{BPL, REL}, {ORA, IZY}, {KIL, IMM}, {SLO, IZY}, {NOP, ZPX}, {ORA, ZPX}, {ASL, ZPX}, {SLO, ZPX}, {CLC, IMP}, {ORA, ABY}, {NOP, IMP}, {SLO, ABY}, {NOP, ABX}, {ORA, ABX}, {ASL, ABX}, {SLO, ABX},
 	{JSR, IMP}, {AND, IZX}, {KIL, IMM}, {RLA, IZX}, {BIT, ZP0}, {AND, ZP0}, {ROL, ZP0}, {RLA, ZP0}, {PLP, IMP}, {AND, IMM}, {ROL, IMP}, {ANC, IMM}, {BIT, ABS}, {AND, ABS}, {ROL, ABS}, {RLA, ABS},
@@ -23,7 +30,7 @@ const Instruction lookup[] = {
 	{BEQ, REL}, {SBC, IZY}, {KIL, IMM}, {ISC, IZY}, {NOP, ZPX}, {SBC, ZPX}, {INC, ZPX}, {ISC, ZPX}, {SED, IMP}, {SBC, ABY}, {NOP, IMP}, {ISC, ABY}, {NOP, ABX}, {SBC, ABX}, {INC, ABX}, {ISC, ABX},
 };
 
-static State InstructionType(Instructions instruction) {
+static constexpr State InstructionType(Instructions instruction) {
 	switch(instruction) {
 			// Read
 		case Instructions::LDA:
@@ -70,6 +77,31 @@ static State InstructionType(Instructions instruction) {
 	}
 }
 
+// Indexed reads only do the fixup read if the index crosses a page
+static constexpr bool SkipsFixup(Instructions instruction) {
+	switch(instruction) {
+		case Instructions::LDA:
+		case Instructions::LDX:
+		case Instructions::LDY:
+		case Instructions::EOR:
+		case Instructions::AND:
+		case Instructions::ORA:
+		case Instructions::ADC:
+		case Instructions::SBC:
+		case Instructions::CMP:
+		case Instructions::CPX:
+		case Instructions::CPY:
+		case Instructions::BIT:
+		case Instructions::LAX:
+		case Instructions::LAS:
+		case Instructions::TAS:
+		case Instructions::NOP:
+			return true;
+		default:
+			return false;
+	}
+}
+
 mos6502::mos6502(Bus* bus): bus(bus) {
 	#ifdef printDebug
 	file.open("D:\\Daten\\Desktop\\test.log");
@@ -170,6 +202,7 @@ void mos6502::Clock() {
 			#endif
 
 			fetched = bus->CpuRead(PC);
+			instructionCount++;
 			if(NMI) {
 				instruction.instruction = Instructions::NMI;
 				instruction.addrMode = IMP;
@@ -225,87 +258,9 @@ void mos6502::Clock() {
 							addr_abs = fetched;
 							state = State::StackShit1;
 							break;
-						case Instructions::ASL:
-							Status.C = A & 0x80;
-
-							A <<= 1;
-							Status.Z = A == 0;
-							Status.N = A & 0x80;
-							break;
-						case Instructions::ROL:
-							A = ROL(A);
-							break;
-						case Instructions::LSR:
-							Status.C = A & 1;
-						
-							A >>= 1;
-							Status.Z = A == 0;
-							Status.N = A & 0x80;
-							break;
-						case Instructions::ROR:
-							A = ROR(A);
-							break;
-						case Instructions::TXA:
-							A = X;
-
-							Status.Z = A == 0;
-							Status.N = A & 0x80;
-							break;
-						case Instructions::TYA:
-							A = Y;
-
-							Status.Z = A == 0;
-							Status.N = A & 0x80;
-							break;
-						case Instructions::TXS:
-							SP = X;
-							break;
-						case Instructions::TAY:
-							Y = A;
-
-							Status.Z = Y == 0;
-							Status.N = Y & 0x80;
-							break;
-						case Instructions::TAX:
-							X = A;
-
-							Status.Z = X == 0;
-							Status.N = X & 0x80;
-							break;
-						case Instructions::TSX:
-							X = SP;
-
-							Status.Z = X == 0;
-							Status.N = X & 0x80;
-							break;
-						case Instructions::DEX:
-							X--;
-							Status.Z = X == 0x00;
-							Status.N = X & 0x80;
-							break;
-						case Instructions::DEY:
-							Y--;
-							Status.Z = Y == 0x00;
-							Status.N = Y & 0x80;
-							break;
-						case Instructions::INX:
-							X++;
-							Status.Z = X == 0x00;
-							Status.N = X & 0x80;
-							break;
-						case Instructions::INY:
-							Y++;
-							Status.Z = Y == 0x00;
-							Status.N = Y & 0x80;
+						default:
+							Implied(instruction.instruction);
 							break;
-						case Instructions::SEC: Status.C = true; break;
-						case Instructions::SED: Status.D = true; break;
-						case Instructions::SEI: Status.I = true; break;
-						case Instructions::CLC: Status.C = false; break;
-						case Instructions::CLD: Status.D = false; break;
-						case Instructions::CLI: Status.I = false; break;
-						case Instructions::CLV: Status.V = false; break;
-						default: break;
 					}
 					break;
 				case IMM:
@@ -313,106 +268,7 @@ void mos6502::Clock() {
 					#ifdef printDebug
 					strPos += sprintf_s((instrStr + strPos), 27 - strPos, "#$%02X ", fetched);
 					#endif
-					switch(instruction.instruction) {
-						case Instructions::ORA:
-							A |= fetched;
-							Status.Z = A == 0;
-							Status.N = A & 0x80;
-							break;
-						case Instructions::ANC:
-							A &= fetched;
-
-							Status.Z = A == 0;
-							Status.C = Status.N = A & 0x80;
-							break;
-						case Instructions::AND:
-							A &= fetched;
-
-							Status.Z = A == 0;
-							Status.N = A & 0x80;
-							break;
-						case Instructions::EOR:
-							A ^= fetched;
-
-							Status.Z = A == 0;
-							Status.N = A & 0x80;
-							break;
-						case Instructions::ALR:
-							A &= fetched;
-							Status.C = A & 1;
-
-							// LSR A
-							A >>= 1;
-
-							Status.Z = A == 0;
-							Status.N = A & 0x80;
-							break;
-						case Instructions::ADC:
-							ADC(fetched);
-							break;
-						case Instructions::LDA:
-							A = fetched;
-							Status.Z = A == 0;
-							Status.N = A & 0x80;
-							break;
-						case Instructions::LDX:
-							X = fetched;
-							Status.Z = X == 0;
-							Status.N = X & 0x80;
-							break;
-						case Instructions::LDY:
-							Y = fetched;
-							Status.Z = Y == 0;
-							Status.N = Y & 0x80;
-							break;
-						case Instructions::LAX:
-							X = A = fetched;
-
-							Status.Z = X == 0;
-							Status.N = X & 0x80;
-							break;
-						case Instructions::CMP:
-							Status.C = A >= fetched;
-							Status.Z = A == fetched;
-							Status.N = (A - fetched) & 0x80;
-							break;
-						case Instructions::CPX:
-							Status.C = X >= fetched;
-							Status.Z = X == fetched;
-							Status.N = (X - fetched) & 0x80;
-							break;
-						case Instructions::CPY:
-							Status.C = Y >= fetched;
-							Status.Z = Y == fetched;
-							Status.N = (Y - fetched) & 0x80;
-							break;
-						case Instructions::AXS:
-							Status.C = (A & X) >= fetched;
-							X = (A & X) - fetched;
-							Status.Z = X == 0;
-							Status.N = X & 0x80;
-							break;
-						case Instructions::SBC: SBC(fetched);
-							break;
-						case Instructions::ARR:
-							A &= fetched;
-
-							A = (Status.C << 7) | (A >> 1);
-
-							Status.C = A & 0x40;
-							Status.V = (A & 0x40) ^ ((A & 0x20) << 1);
-
-							Status.Z = A == 0;
-							Status.N = A & 0x80;
-							break;
-						case Instructions::XAA:
-							A = (A | 0xFF) & X & fetched;
-
-							Status.Z = A == 0;
-							Status.N = A & 0x80;
-							break;
-						default: break;
-					}
+					Immediate(instruction.instruction, fetched);
 					state = State::FetchOpcode;
 					break;
 				case ZP0:
@@ -429,20 +285,8 @@ void mos6502::Clock() {
 					break;
 				case REL: {
 					PC++;
-					bool take = false;
-					switch(instruction.instruction) {
-						case Instructions::BPL: take = !Status.N; break;
-						case Instructions::BMI: take =  Status.N; break;
-						case Instructions::BVC: take = !Status.V; break;
-						case Instructions::BVS: take =  Status.V; break;
-						case Instructions::BCC: take = !Status.C; break;
-						case Instructions::BCS: take =  Status.C; break;
-						case Instructions::BNE: take = !Status.Z; break;
-						case Instructions::BEQ: take =  Status.Z; break;
-						default: break;
-					}
 
-					if(take) {
+					if(BranchTaken(instruction.instruction)) {
 						addr_abs = fetched; // use addr_abs as temporary
 						state = State::ReadPC;
 					} else {
@@ -523,64 +367,22 @@ void mos6502::Clock() {
 					PC++;
 					addr_abs |= fetched << 8;
 
-					switch(instruction.instruction) {
-						case Instructions::LDA:
-						case Instructions::LDX:
-						case Instructions::LDY:
-						case Instructions::EOR:
-						case Instructions::AND:
-						case Instructions::ORA:
-						case Instructions::ADC:
-						case Instructions::SBC:
-						case Instructions::CMP:
-						case Instructions::CPX:
-						case Instructions::CPY:
-						case Instructions::BIT:
-						case Instructions::LAX:
-						case Instructions::LAS:
-						case Instructions::TAS:
-						case Instructions::NOP:
-							if(((addr_abs + X) & 0xFF00) == (addr_abs & 0xFF00)) {
-								addr_abs += X;
-								state = InstructionType(instruction.instruction);
-								break;
-							}
-							[[fallthrough]];
-						default:
-							state = State::PageError;
-							break;
+					if(SkipsFixup(instruction.instruction) && ((addr_abs + X) & 0xFF00) == (addr_abs & 0xFF00)) {
+						addr_abs += X;
+						state = InstructionType(instruction.instruction);
+					} else {
+						state = State::PageError;
 					}
 					break;
 				case ABY:
 					PC++;
 					addr_abs |= fetched << 8;
 
-					switch(instruction.instruction) {
-						case Instructions::LDA:
-						case Instructions::LDX:
-						case Instructions::LDY:
-						case Instructions::EOR:
-						case Instructions::AND:
-						case Instructions::ORA:
-						case Instructions::ADC:
-						case Instructions::SBC:
-						case Instructions::CMP:
-						case Instructions::CPX:
-						case Instructions::CPY:
-						case Instructions::BIT:
-						case Instructions::LAX:
-						case Instructions::LAS:
-						case Instructions::TAS:
-						case Instructions::NOP:
-							if(((addr_abs + Y) & 0xFF00) == (addr_abs & 0xFF00)) {
-								addr_abs += Y;
-								state = InstructionType(instruction.instruction);
-								break;
-							}
-							[[fallthrough]];
-						default:
-							state = State::PageError;
-							break;
+					if(SkipsFixup(instruction.instruction) && ((addr_abs + Y) & 0xFF00) == (addr_abs & 0xFF00)) {
+						addr_abs += Y;
+						state = InstructionType(instruction.instruction);
+					} else {
+						state = State::PageError;
 					}
 					break;
 				case IND:
@@ -603,32 +405,11 @@ void mos6502::Clock() {
 					state = InstructionType(instruction.instruction);
 					break;
 				case IZY: {
-					switch(instruction.instruction) {
-						case Instructions::LDA:
-						case Instructions::LDX:
-						case Instructions::LDY:
-						case Instructions::EOR:
-						case Instructions::AND:
-						case Instructions::ORA:
-						case Instructions::ADC:
-						case Instructions::SBC:
-						case Instructions::CMP:
-						case Instructions::CPX:
-						case Instructions::CPY:
-						case Instructions::BIT:
-						case Instructions::LAX:
-						case Instructions::LAS:
-						case Instructions::TAS:
-						case Instructions::NOP:
-							if(((addr_abs + Y) & 0xFF00) == (addr_abs & 0xFF00)) {
-								addr_abs += Y;
-								state = InstructionType(instruction.instruction);
-								break;
-							}
-							[[fallthrough]];
-						default:
-							state = State::PageError;
-							break;
+					if(SkipsFixup(instruction.instruction) && ((addr_abs + Y) & 0xFF00) == (addr_abs & 0xFF00)) {
+						addr_abs += Y;
+						state = InstructionType(instruction.instruction);
+					} else {
+						state = State::PageError;
 					}
 					break;
 				}
@@ -672,106 +453,7 @@ void mos6502::Clock() {
 			}
 			#endif
 
-			switch(instruction.instruction) {
-				case Instructions::LDA:
-					A = fetched;
-					Status.Z = A == 0;
-					Status.N = A & 0x80;
-					state = State::FetchOpcode;
-					break;
-				case Instructions::LDX:
-					X = fetched;
-					Status.Z = X == 0;
-					Status.N = X & 0x80;
-					state = State::FetchOpcode;
-					break;
-				case Instructions::LDY:
-					Y = fetched;
-					Status.Z = Y == 0;
-					Status.N = Y & 0x80;
-					state = State::FetchOpcode;
-					break;
-				case Instructions::EOR:
-					A ^= fetched;
-
-					Status.Z = A == 0;
-					Status.N = A & 0x80;
-					state = State::FetchOpcode;
-					break;
-				case Instructions::AND:
-					A &= fetched;
-
-					Status.Z = A == 0;
-					Status.N = A & 0x80;
-					state = State::FetchOpcode;
-					break;
-				case Instructions::ORA:
-					A |= fetched;
-					Status.Z = A == 0;
-					Status.N = A & 0x80;
-					state = State::FetchOpcode;
-					break;
-				case Instructions::ADC:
-					ADC(fetched);
-					state = State::FetchOpcode;
-					break;
-				case Instructions::SBC:
-					SBC(fetched);
-					state = State::FetchOpcode;
-					break;
-				case Instructions::CMP:
-					Status.C = A >= fetched;
-					Status.Z = A == fetched;
-					Status.N = (A - fetched) & 0x80;
-					state = State::FetchOpcode;
-					break;
-				case Instructions::CPX:
-					Status.C = X >= fetched;
-					Status.Z = X == fetched;
-					Status.N = (X - fetched) & 0x80;
-					state = State::FetchOpcode;
-					break;
-				case Instructions::CPY:
-					Status.C = Y >= fetched;
-					Status.Z = Y == fetched;
-					Status.N = (Y - fetched) & 0x80;
-					state = State::FetchOpcode;
-					break;
-				case Instructions::BIT:
-					Status.Z = (A & fetched) == 0;
-					Status.N = fetched & (1 << 7);
-					Status.V = fetched & (1 << 6);
-					state = State::FetchOpcode;
-					break;
-				case Instructions::LAX:
-					X = A = fetched;
-
-					Status.Z = X == 0;
-					Status.N = X & 0x80;
-					state = State::FetchOpcode;
-					break;
-				case Instructions::NOP:
-					state = State::FetchOpcode;
-					break;
-				case Instructions::ASL:
-				case Instructions::LSR:
-				case Instructions::ROL:
-				case Instructions::ROR:
-				case Instructions::INC:
-				case Instructions::DEC:
-				case Instructions::SLO:
-				case Instructions::SRE:
-				case Instructions::RLA:
-				case Instructions::RRA:
-				case Instructions::ISC:
-				case Instructions::DCP:
-					ptr = fetched; // use ptr as temporary
-					state = State::DummyWrite;
-					break;
-				default:
-					// printf("%s not implemented\n", instruction.name.c_str());
-					break;
-			}
+			state = ExecuteRead(instruction.instruction, fetched);
 
 			break;
 		case State::DummyWrite:
@@ -779,153 +461,9 @@ void mos6502::Clock() {
 			state = State::WriteInstr;
 			break;
 		case State::WriteInstr: {
-			uint8_t toWrite;
 			uint16_t writeAddr = addr_abs;
+			uint8_t toWrite = ExecuteWrite(instruction.instruction, writeAddr);
 
-			switch(instruction.instruction) {
-				case Instructions::STA:
-					toWrite = A;
-					break;
-				case Instructions::STX:
-					toWrite = X;
-					break;
-				case Instructions::STY:
-					toWrite = Y;
-					break;
-				case Instructions::SAX:
-					toWrite = A & X;
-					break;
-				case Instructions::ASL:
-					Status.C = ptr & 0x80;
-
-					toWrite = ptr << 1;
-					Status.Z = toWrite == 0;
-					Status.N = toWrite & 0x80;
-					break;
-				case Instructions::LSR:
-					Status.C = ptr & 1;
-					toWrite = ptr >> 1;
-
-					Status.Z = toWrite == 0;
-					Status.N = toWrite & 0x80;
-					break;
-				case Instructions::ROL:
-					toWrite = ROL(ptr);
-					break;
-				case Instructions::ROR:
-					toWrite = ROR(ptr);
-					break;
-				case Instructions::INC:
-					ptr++;
-
-					toWrite = ptr;
-					Status.Z = (ptr & 0xFF) == 0;
-					Status.N = ptr & 0x80;
-					break;
-				case Instructions::DEC:
-					ptr--;
-					toWrite = ptr;
-					Status.Z = ptr == 0;
-					Status.N = ptr & 0x80;
-					break;
-				case Instructions::SLO:
-					ptr <<= 1;
-					Status.C = ptr & 0xFF00;
-					toWrite = ptr;
-
-					A |= ptr;
-					Status.Z = A == 0;
-					Status.N = A & 0x80;
-					break;
-				case Instructions::SRE:
-					Status.C = ptr & 1;
-					ptr >>= 1;
-					toWrite = ptr;
-
-					A ^= ptr;
-					Status.Z = A == 0;
-					Status.N = A & 0x80;
-					break;
-				case Instructions::RLA:
-					ptr = (ptr << 1) | Status.C;
-					Status.C = ptr & 0xFF00;
-					toWrite = ptr;
-
-					A &= ptr;
-					Status.Z = A == 0;
-					Status.N = A & 0x80;
-					break;
-				case Instructions::RRA:
-					fetched = (Status.C << 7) | (ptr >> 1);
-					Status.C = ptr & 1;
-					toWrite = fetched;
-
-					ptr = A + fetched + Status.C;
-
-					Status.C = ptr > 255;
-					Status.V = (~(A ^ fetched) & (A ^ ptr)) & 0x0080;
-
-					A = ptr;
-
-					Status.Z = A == 0;
-					Status.N = A & 0x80;
-					break;
-				case Instructions::ISC:
-					ptr++;
-					toWrite = ptr;
-
-					fetched = ptr ^ 0xFF;
-					ptr = A + fetched + Status.C;
-
-					Status.C = ptr > 255;
-					Status.V = (ptr ^ A) & (ptr ^ fetched) & 0x0080;
-
-					A = ptr;
-
-					Status.Z = A == 0;
-					Status.N = A & 0x80;
-					break;
-				case Instructions::DCP:
-					ptr--;
-					toWrite = ptr;
-
-					Status.C = A >= (ptr & 0xFF);
-					ptr = A - ptr;
-					Status.Z = (ptr & 0x00FF) == 0;
-					Status.N = ptr & 0x80;
-					break;
-				case Instructions::SHX:
-					ptr = ((addr_abs - Y) & 0xFF00) | (addr_abs & 0xFF);
-
-					if(ptr >> 8 != addr_abs >> 8) {
-						ptr &= X << 8;
-					}
-					writeAddr = ptr;
-					toWrite = X & ((ptr >> 8) + 1);
-					break;
-				case Instructions::SHY:
-					ptr = ((addr_abs - X) & 0xFF00) | (addr_abs & 0xFF);
-
-					if(ptr >> 8 != addr_abs >> 8) {
-						ptr &= Y << 8;
-					}
-					writeAddr = ptr;
-					toWrite = Y & ((ptr >> 8) + 1);
-					break;
-				case Instructions::TAS:
-					SP = A & X; // IDK
-					[[fallthrough]];
-				case Instructions::AHX:
-					ptr = ((addr_abs - Y) & 0xFF00) | (addr_abs & 0xFF);
-
-					if(ptr >> 8 != addr_abs >> 8) {
-						ptr &= (X & A) << 8;
-					}
-					writeAddr = ptr;
-					toWrite = X & A & ((ptr >> 8) + 1);
-					break;
-				default: throw std::logic_error("Not reachable");
-			}
 			#ifdef printDebug
 			switch(instruction.addrMode) {
 				case ZP0:
@@ -1098,6 +636,755 @@ void mos6502::Clock() {
 	// cycles++;
 }
 
+// Bus accesses of the instruction core. The bus runs the rest of the system up to the access and past it,
+// or defers that if the access goes through the page table
+uint8_t mos6502::StepRead(uint16_t addr) {
+	const uint8_t* page = bus->cpuPages.read[addr >> 8];
+	if(bus->DeferCpuCycle(page)) {
+		bus->cpuOpenBus = page[addr & 0xFF];
+		return bus->cpuOpenBus;
+	}
+
+	bus->BeginCpuCycle();
+	uint8_t data = bus->CpuRead(addr);
+	bus->EndCpuCycle();
+	return data;
+}
+
+void mos6502::StepWrite(uint16_t addr, uint8_t val) {
+	uint8_t* page = bus->cpuPages.write[addr >> 8];
+	if(bus->DeferCpuCycle(page)) {
+		page[addr & 0xFF] = val;
+		return;
+	}
+
+	bus->BeginCpuCycle();
+	bus->CpuWrite(addr, val);
+	bus->EndCpuCycle();
+}
+
+void mos6502::StepPush(uint8_t val) {
+	StepWrite(0x0100 + SP, val);
+	SP--;
+}
+
+uint8_t mos6502::StepPop() {
+	SP++;
+	return StepRead(0x0100 + SP);
+}
+
+// Fixup read of an indexed address. Returns the cycles it took
+CPU_INLINE int mos6502::StepIndex(Instructions op, uint8_t index) {
+	if(SkipsFixup(op) && ((addr_abs + index) & 0xFF00) == (addr_abs & 0xFF00)) {
+		addr_abs += index;
+		return 0;
+	}
+
+	StepRead((addr_abs & 0xFF00) | ((addr_abs + index) & 0xFF));
+	addr_abs += index;
+	return 1;
+}
+
+// Reads the pointer at ptr. The high byte doesn't leave the page
+uint16_t mos6502::StepPointer() {
+	uint16_t lo = StepRead(ptr);
+	return lo | (StepRead((ptr & 0xFF00) | ((ptr + 1) & 0xFF)) << 8);
+}
+
+static constexpr bool IsStackInstruction(Instructions instruction) {
+	switch(instruction) {
+		case Instructions::JSR:
+		case Instructions::BRK:
+		case Instructions::PHP:
+		case Instructions::PLP:
+		case Instructions::RTI:
+		case Instructions::RTS:
+		case Instructions::PHA:
+		case Instructions::PLA:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// Does the same bus accesses in the same order as Clock but runs the whole instruction at once.
+// Interrupts are polled at the same points so both cores can be switched between on instruction boundaries
+int mos6502::Step() {
+	uint8_t opcode;
+	const uint8_t* page = bus->cpuPages.read[PC >> 8];
+	bool deferred = bus->DeferCpuCycle(page);
+	if(deferred) {
+		opcode = bus->cpuOpenBus = page[PC & 0xFF];
+	} else {
+		bus->BeginCpuCycle();
+		opcode = bus->CpuRead(PC);
+	}
+	instructionCount++;
+
+	bool interrupt = true;
+	if(NMI) {
+		instruction.instruction = Instructions::NMI;
+		instruction.addrMode = IMP;
+	} else if(IRQ && !Status.I) {
+		instruction.instruction = Instructions::IRQ;
+		instruction.addrMode = IMP;
+	} else {
+		instruction = lookup[opcode];
+		PC++;
+		interrupt = false;
+	}
+	if(!deferred) {
+		bus->EndCpuCycle();
+	}
+
+	int cycles = 1;
+	if(interrupt) {
+		// the operand fetch is a dummy read
+		addr_abs = StepRead(PC);
+		cycles += 1 + StepStack(instruction.instruction);
+	} else {
+		cycles += (this->*opcodeHandlers[opcode])();
+	}
+
+	// interrupts are polled on the next opcode fetch so the irq line has to be up to date
+	bus->FlushCpuCycles();
+	return cycles;
+}
+
+// Everything after the opcode fetch, specialized for one opcode. Returns the cycles it took
+template<uint8_t Opcode>
+int mos6502::Execute() {
+	constexpr Instructions op = lookup[Opcode].instruction;
+	constexpr AddressingModes mode = lookup[Opcode].addrMode;
+
+	uint8_t fetched = StepRead(PC);
+	int cycles = 1;
+
+	if constexpr(mode == IMP) {
+		if constexpr(op == Instructions::JSR || op == Instructions::BRK) {
+			PC++;
+		}
+		if constexpr(IsStackInstruction(op)) {
+			addr_abs = fetched;
+			return cycles + StepStack(op);
+		} else {
+			Implied(op);
+			return cycles;
+		}
+	} else if constexpr(mode == IMM) {
+		PC++;
+		Immediate(op, fetched);
+		return cycles;
+	} else if constexpr(mode == REL) {
+		PC++;
+		if(!BranchTaken(op)) {
+			return cycles;
+		}
+
+		StepRead(PC);
+		cycles++;
+
+		addr_abs = (int8_t)fetched;
+		if(((PC + addr_abs) & 0xFF00) != (PC & 0xFF00)) {
+			StepRead((PC & 0xFF00) | ((PC + addr_abs) & 0xFF));
+			cycles++;
+		}
+		PC += addr_abs;
+		return cycles;
+	} else if constexpr(mode == IND) {
+		PC++;
+		ptr = fetched | (StepRead(PC) << 8);
+		PC = StepPointer();
+		return cycles + 3;
+	} else if constexpr(mode == ABS && op == Instructions::JMP) {
+		PC++;
+		addr_abs = fetched | (StepRead(PC) << 8);
+		PC = addr_abs;
+		return cycles + 1;
+	} else {
+		if constexpr(mode == ZP0) {
+			PC++;
+			addr_abs = fetched;
+		} else if constexpr(mode == ZPX || mode == ZPY) {
+			PC++;
+			StepRead(fetched);
+			addr_abs = (fetched + (mode == ZPX ? X : Y)) & 0xFF;
+			cycles++;
+		} else if constexpr(mode == IZX) {
+			PC++;
+			StepRead(fetched);
+			ptr = (fetched + X) & 0xFF;
+			addr_abs = StepPointer();
+			cycles += 3;
+		} else if constexpr(mode == IZY) {
+			PC++;
+			ptr = fetched;
+			addr_abs = StepPointer();
+			cycles += 2 + StepIndex(op, Y);
+		} else {
+			PC++;
+			addr_abs = fetched | (StepRead(PC) << 8);
+			PC++;
+			cycles++;
+
+			if constexpr(mode == ABX) {
+				cycles += StepIndex(op, X);
+			} else if constexpr(mode == ABY) {
+				cycles += StepIndex(op, Y);
+			}
+		}
+
+		if constexpr(InstructionType(op) == State::ReadInstr) {
+			fetched = StepRead(addr_abs);
+			cycles++;
+
+			state = ExecuteRead(op, fetched);
+			if(state != State::DummyWrite) {
+				// done or stuck on the read, Clock takes over in that case
+				return cycles;
+			}
+
+			StepWrite(addr_abs, ptr);
+			cycles++;
+			state = State::FetchOpcode;
+		}
+
+		uint16_t writeAddr = addr_abs;
+		uint8_t toWrite = ExecuteWrite(op, writeAddr);
+		StepWrite(writeAddr, toWrite);
+		return cycles + 1;
+	}
+}
+
+template<size_t... Opcodes>
+constexpr std::array<mos6502::OpcodeHandler, 256> mos6502::MakeHandlers(std::index_sequence<Opcodes...>) {
+	return { &mos6502::Execute<Opcodes>... };
+}
+
+const std::array<mos6502::OpcodeHandler, 256> mos6502::opcodeHandlers = MakeHandlers(std::make_index_sequence<256>());
+
+// Stack instructions and interrupts after the operand fetch
+CPU_INLINE int mos6502::StepStack(Instructions op) {
+	switch(op) {
+		case Instructions::PHA:
+			StepPush(A);
+			return 1;
+		case Instructions::PHP:
+			Status.B = true;
+			StepPush(Status.reg);
+			Status.B = false;
+			return 1;
+		case Instructions::PLA:
+			StepRead(0x0100 + SP);
+			A = StepPop();
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			return 2;
+		case Instructions::PLP:
+			StepRead(0x0100 + SP);
+			Status.reg = StepPop();
+			Status.B = false;
+			Status.U = true;
+			return 2;
+		case Instructions::RTI:
+			StepRead(0x0100 + SP);
+			Status.reg = StepPop();
+			Status.B = false;
+			Status.U = true;
+			PC = StepPop();
+			PC |= StepPop() << 8;
+			return 4;
+		case Instructions::RTS:
+			StepRead(0x0100 + SP);
+			PC = StepPop();
+			PC |= StepPop() << 8;
+			StepRead(PC);
+			PC++;
+			return 4;
+		case Instructions::JSR:
+			StepRead(0x0100 + SP);
+			StepPush(PC >> 8);
+			StepPush(PC);
+			PC = addr_abs | (StepRead(PC) << 8);
+			return 4;
+		case Instructions::BRK:
+		case Instructions::IRQ:
+		case Instructions::NMI:
+			StepPush(PC >> 8);
+			StepPush(PC);
+
+			// a nmi that arrives until the status push hijacks the vector
+			bus->FlushCpuCycles();
+			bus->BeginCpuCycle();
+			if(op == Instructions::BRK) {
+				Status.B = true;
+			}
+			if(op != Instructions::NMI && !NMI) {
+				addr_abs = 0xFFFE;
+				Status.U = true;
+				PushStack(Status.reg);
+				Status.I = true;
+			} else {
+				NMI = false;
+				addr_abs = 0xFFFA;
+				PushStack(Status.reg);
+			}
+			bus->EndCpuCycle();
+
+			PC = StepRead(addr_abs);
+			PC |= StepRead(addr_abs + 1) << 8;
+			return 5;
+		default: return 0;
+	}
+}
+
+// Register only instructions, done on the operand fetch
+CPU_INLINE void mos6502::Implied(Instructions op) {
+	switch(op) {
+		case Instructions::ASL:
+			Status.C = A & 0x80;
+
+			A <<= 1;
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::ROL:
+			A = ROL(A);
+			break;
+		case Instructions::LSR:
+			Status.C = A & 1;
+		
+			A >>= 1;
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::ROR:
+			A = ROR(A);
+			break;
+		case Instructions::TXA:
+			A = X;
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::TYA:
+			A = Y;
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::TXS:
+			SP = X;
+			break;
+		case Instructions::TAY:
+			Y = A;
+
+			Status.Z = Y == 0;
+			Status.N = Y & 0x80;
+			break;
+		case Instructions::TAX:
+			X = A;
+
+			Status.Z = X == 0;
+			Status.N = X & 0x80;
+			break;
+		case Instructions::TSX:
+			X = SP;
+
+			Status.Z = X == 0;
+			Status.N = X & 0x80;
+			break;
+		case Instructions::DEX:
+			X--;
+			Status.Z = X == 0x00;
+			Status.N = X & 0x80;
+			break;
+		case Instructions::DEY:
+			Y--;
+			Status.Z = Y == 0x00;
+			Status.N = Y & 0x80;
+			break;
+		case Instructions::INX:
+			X++;
+			Status.Z = X == 0x00;
+			Status.N = X & 0x80;
+			break;
+		case Instructions::INY:
+			Y++;
+			Status.Z = Y == 0x00;
+			Status.N = Y & 0x80;
+			break;
+		case Instructions::SEC: Status.C = true; break;
+		case Instructions::SED: Status.D = true; break;
+		case Instructions::SEI: Status.I = true; break;
+		case Instructions::CLC: Status.C = false; break;
+		case Instructions::CLD: Status.D = false; break;
+		case Instructions::CLI: Status.I = false; break;
+		case Instructions::CLV: Status.V = false; break;
+		default: break;
+	}
+}
+
+CPU_INLINE void mos6502::Immediate(Instructions op, uint8_t fetched) {
+	switch(op) {
+		case Instructions::ORA:
+			A |= fetched;
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::ANC:
+			A &= fetched;
+
+			Status.Z = A == 0;
+			Status.C = Status.N = A & 0x80;
+			break;
+		case Instructions::AND:
+			A &= fetched;
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::EOR:
+			A ^= fetched;
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::ALR:
+			A &= fetched;
+			Status.C = A & 1;
+
+			// LSR A
+			A >>= 1;
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::ADC:
+			ADC(fetched);
+			break;
+		case Instructions::LDA:
+			A = fetched;
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::LDX:
+			X = fetched;
+			Status.Z = X == 0;
+			Status.N = X & 0x80;
+			break;
+		case Instructions::LDY:
+			Y = fetched;
+			Status.Z = Y == 0;
+			Status.N = Y & 0x80;
+			break;
+		case Instructions::LAX:
+			X = A = fetched;
+
+			Status.Z = X == 0;
+			Status.N = X & 0x80;
+			break;
+		case Instructions::CMP:
+			Status.C = A >= fetched;
+			Status.Z = A == fetched;
+			Status.N = (A - fetched) & 0x80;
+			break;
+		case Instructions::CPX:
+			Status.C = X >= fetched;
+			Status.Z = X == fetched;
+			Status.N = (X - fetched) & 0x80;
+			break;
+		case Instructions::CPY:
+			Status.C = Y >= fetched;
+			Status.Z = Y == fetched;
+			Status.N = (Y - fetched) & 0x80;
+			break;
+		case Instructions::AXS:
+			Status.C = (A & X) >= fetched;
+			X = (A & X) - fetched;
+			Status.Z = X == 0;
+			Status.N = X & 0x80;
+			break;
+		case Instructions::SBC: SBC(fetched);
+			break;
+		case Instructions::ARR:
+			A &= fetched;
+
+			A = (Status.C << 7) | (A >> 1);
+
+			Status.C = A & 0x40;
+			Status.V = (A & 0x40) ^ ((A & 0x20) << 1);
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::XAA:
+			A = (A | 0xFF) & X & fetched;
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		default: break;
+	}
+}
+
+CPU_INLINE bool mos6502::BranchTaken(Instructions op) const {
+	switch(op) {
+		case Instructions::BPL: return !Status.N;
+		case Instructions::BMI: return  Status.N;
+		case Instructions::BVC: return !Status.V;
+		case Instructions::BVS: return  Status.V;
+		case Instructions::BCC: return !Status.C;
+		case Instructions::BCS: return  Status.C;
+		case Instructions::BNE: return !Status.Z;
+		case Instructions::BEQ: return  Status.Z;
+		default: return false;
+	}
+}
+
+// Returns the state after the read. Read-modify-write instructions continue with the dummy write
+CPU_INLINE State mos6502::ExecuteRead(Instructions op, uint8_t fetched) {
+	switch(op) {
+		case Instructions::LDA:
+			A = fetched;
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			return State::FetchOpcode;
+		case Instructions::LDX:
+			X = fetched;
+			Status.Z = X == 0;
+			Status.N = X & 0x80;
+			return State::FetchOpcode;
+		case Instructions::LDY:
+			Y = fetched;
+			Status.Z = Y == 0;
+			Status.N = Y & 0x80;
+			return State::FetchOpcode;
+		case Instructions::EOR:
+			A ^= fetched;
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			return State::FetchOpcode;
+		case Instructions::AND:
+			A &= fetched;
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			return State::FetchOpcode;
+		case Instructions::ORA:
+			A |= fetched;
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			return State::FetchOpcode;
+		case Instructions::ADC:
+			ADC(fetched);
+			return State::FetchOpcode;
+		case Instructions::SBC:
+			SBC(fetched);
+			return State::FetchOpcode;
+		case Instructions::CMP:
+			Status.C = A >= fetched;
+			Status.Z = A == fetched;
+			Status.N = (A - fetched) & 0x80;
+			return State::FetchOpcode;
+		case Instructions::CPX:
+			Status.C = X >= fetched;
+			Status.Z = X == fetched;
+			Status.N = (X - fetched) & 0x80;
+			return State::FetchOpcode;
+		case Instructions::CPY:
+			Status.C = Y >= fetched;
+			Status.Z = Y == fetched;
+			Status.N = (Y - fetched) & 0x80;
+			return State::FetchOpcode;
+		case Instructions::BIT:
+			Status.Z = (A & fetched) == 0;
+			Status.N = fetched & (1 << 7);
+			Status.V = fetched & (1 << 6);
+			return State::FetchOpcode;
+		case Instructions::LAX:
+			X = A = fetched;
+
+			Status.Z = X == 0;
+			Status.N = X & 0x80;
+			return State::FetchOpcode;
+		case Instructions::NOP:
+			return State::FetchOpcode;
+		case Instructions::ASL:
+		case Instructions::LSR:
+		case Instructions::ROL:
+		case Instructions::ROR:
+		case Instructions::INC:
+		case Instructions::DEC:
+		case Instructions::SLO:
+		case Instructions::SRE:
+		case Instructions::RLA:
+		case Instructions::RRA:
+		case Instructions::ISC:
+		case Instructions::DCP:
+			ptr = fetched; // use ptr as temporary
+			return State::DummyWrite;
+		default:
+			// printf("%s not implemented\n", instruction.name.c_str());
+			return State::ReadInstr;
+	}
+}
+
+// Value a store or read-modify-write instruction writes. The unstable stores also change the address
+CPU_INLINE uint8_t mos6502::ExecuteWrite(Instructions op, uint16_t& writeAddr) {
+	uint8_t toWrite;
+	uint8_t fetched;
+
+	switch(op) {
+		case Instructions::STA:
+			toWrite = A;
+			break;
+		case Instructions::STX:
+			toWrite = X;
+			break;
+		case Instructions::STY:
+			toWrite = Y;
+			break;
+		case Instructions::SAX:
+			toWrite = A & X;
+			break;
+		case Instructions::ASL:
+			Status.C = ptr & 0x80;
+
+			toWrite = ptr << 1;
+			Status.Z = toWrite == 0;
+			Status.N = toWrite & 0x80;
+			break;
+		case Instructions::LSR:
+			Status.C = ptr & 1;
+			toWrite = ptr >> 1;
+
+			Status.Z = toWrite == 0;
+			Status.N = toWrite & 0x80;
+			break;
+		case Instructions::ROL:
+			toWrite = ROL(ptr);
+			break;
+		case Instructions::ROR:
+			toWrite = ROR(ptr);
+			break;
+		case Instructions::INC:
+			ptr++;
+
+			toWrite = ptr;
+			Status.Z = (ptr & 0xFF) == 0;
+			Status.N = ptr & 0x80;
+			break;
+		case Instructions::DEC:
+			ptr--;
+			toWrite = ptr;
+			Status.Z = ptr == 0;
+			Status.N = ptr & 0x80;
+			break;
+		case Instructions::SLO:
+			ptr <<= 1;
+			Status.C = ptr & 0xFF00;
+			toWrite = ptr;
+
+			A |= ptr;
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::SRE:
+			Status.C = ptr & 1;
+			ptr >>= 1;
+			toWrite = ptr;
+
+			A ^= ptr;
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::RLA:
+			ptr = (ptr << 1) | Status.C;
+			Status.C = ptr & 0xFF00;
+			toWrite = ptr;
+
+			A &= ptr;
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::RRA:
+			fetched = (Status.C << 7) | (ptr >> 1);
+			Status.C = ptr & 1;
+			toWrite = fetched;
+
+			ptr = A + fetched + Status.C;
+
+			Status.C = ptr > 255;
+			Status.V = (~(A ^ fetched) & (A ^ ptr)) & 0x0080;
+
+			A = ptr;
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::ISC:
+			ptr++;
+			toWrite = ptr;
+
+			fetched = ptr ^ 0xFF;
+			ptr = A + fetched + Status.C;
+
+			Status.C = ptr > 255;
+			Status.V = (ptr ^ A) & (ptr ^ fetched) & 0x0080;
+
+			A = ptr;
+
+			Status.Z = A == 0;
+			Status.N = A & 0x80;
+			break;
+		case Instructions::DCP:
+			ptr--;
+			toWrite = ptr;
+
+			Status.C = A >= (ptr & 0xFF);
+			ptr = A - ptr;
+			Status.Z = (ptr & 0x00FF) == 0;
+			Status.N = ptr & 0x80;
+			break;
+		case Instructions::SHX:
+			ptr = ((addr_abs - Y) & 0xFF00) | (addr_abs & 0xFF);
+
+			if(ptr >> 8 != addr_abs >> 8) {
+				ptr &= X << 8;
+			}
+			writeAddr = ptr;
+			toWrite = X & ((ptr >> 8) + 1);
+			break;
+		case Instructions::SHY:
+			ptr = ((addr_abs - X) & 0xFF00) | (addr_abs & 0xFF);
+
+			if(ptr >> 8 != addr_abs >> 8) {
+				ptr &= Y << 8;
+			}
+			writeAddr = ptr;
+			toWrite = Y & ((ptr >> 8) + 1);
+			break;
+		case Instructions::TAS:
+			SP = A & X; // IDK
+			[[fallthrough]];
+		case Instructions::AHX:
+			ptr = ((addr_abs - Y) & 0xFF00) | (addr_abs & 0xFF);
+
+			if(ptr >> 8 != addr_abs >> 8) {
+				ptr &= (X & A) << 8;
+			}
+			writeAddr = ptr;
+			toWrite = X & A & ((ptr >> 8) + 1);
+			break;
+		default: throw std::logic_error("Not reachable");
+	}
+
+	return toWrite;
+}
+
 void mos6502::PushStack(uint8_t val) {
 	bus->CpuWrite(0x0100 + SP, val);
 	SP--;
@@ -1,7 +1,9 @@
 #pragma once
 #include "../../saver.h"
 
+#include <array>
 #include <fstream>
+#include <utility>
 
 // #define printDebug 1
 
@@ -235,6 +237,8 @@ class mos6502 {
 
   public:
 	bool IRQ;
+	// instructions and interrupts started since power on, not part of save states
+	uint64_t instructionCount = 0;
 
   private:
 	bool NMI;
@@ -279,6 +283,9 @@ class mos6502 {
 	void HardReset();
 	void Reset();
 	void Clock();
+	// execute a whole instruction and return the cycles it took. Only valid on an instruction boundary
+	int Step();
+	bool InstructionStart() const { return state == State::FetchOpcode; }
 
 	void Nmi();
 
@@ -294,6 +301,29 @@ class mos6502 {
 
 	uint8_t ROL(uint8_t val);
 	uint8_t ROR(uint8_t val);
+
+	void Implied(Instructions op);
+	void Immediate(Instructions op, uint8_t fetched);
+	bool BranchTaken(Instructions op) const;
+	State ExecuteRead(Instructions op, uint8_t fetched);
+	uint8_t ExecuteWrite(Instructions op, uint16_t& writeAddr);
+
+	uint8_t StepRead(uint16_t addr);
+	void StepWrite(uint16_t addr, uint8_t val);
+	void StepPush(uint8_t val);
+	uint8_t StepPop();
+	int StepIndex(Instructions op, uint8_t index);
+	uint16_t StepPointer();
+	int StepStack(Instructions op);
+
+	// one handler per opcode generated from lookup, used by Step
+	using OpcodeHandler = int (mos6502::*)();
+	static const std::array<OpcodeHandler, 256> opcodeHandlers;
+
+	template<uint8_t Opcode>
+	int Execute();
+	template<size_t... Opcodes>
+	static constexpr std::array<OpcodeHandler, 256> MakeHandlers(std::index_sequence<Opcodes...>);
 };
 
 }
@@ -1,9 +1,16 @@
 #include "ppu2C02.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <iostream>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
 #include "../../math.h"
 #include "Bus.h"
 
@@ -11,7 +18,7 @@ namespace Nes {
 
 static const uint32_t ioBusCountDown = 4288392;
 
-static const Color colors[] = {
+const Color ppu2C02::colors[64] = {
 	{84, 84, 84},
 	{0, 30, 116},
 	{8, 16, 144},
@@ -78,6 +85,79 @@ static const Color colors[] = {
 	{0, 0, 0}
 };
 
+// Resolve background and sprite priority. bg is pixel | palette << 2, fg additionally has front << 4.
+// Returns the palette index of the color, sprites use the upper 4 palettes
+static inline uint8_t MuxPixel(uint8_t bg, uint8_t fg) {
+	if((fg & 3) && (!(bg & 3) || (fg & 0x10))) {
+		return (fg & 0x0F) | 0x10;
+	}
+	return (bg & 3) ? bg : 0;
+}
+
+// MuxPixel for count pixels, a multiple of 32. Returns whether an opaque sprite zero pixel (fg bit 5) is on top of an opaque background pixel
+static bool MuxPixels(const uint8_t* bg, const uint8_t* fg, uint8_t* out, int count) {
+#if defined(__AVX2__)
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i pixelMask = _mm256_set1_epi8(0x03);
+	const __m256i colorMask = _mm256_set1_epi8(0x0F);
+	const __m256i front = _mm256_set1_epi8(0x10);
+	const __m256i spriteZero = _mm256_set1_epi8(0x20);
+	__m256i hit = zero;
+
+	for(int i = 0; i < count; i += 32) {
+		const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bg + i));
+		const __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(fg + i));
+
+		const __m256i bgClear = _mm256_cmpeq_epi8(_mm256_and_si256(b, pixelMask), zero);
+		const __m256i fgClear = _mm256_cmpeq_epi8(_mm256_and_si256(f, pixelMask), zero);
+		const __m256i fgFront = _mm256_cmpeq_epi8(_mm256_and_si256(f, front), front);
+		const __m256i useFg = _mm256_andnot_si256(fgClear, _mm256_or_si256(bgClear, fgFront));
+
+		const __m256i fgColor = _mm256_or_si256(_mm256_and_si256(f, colorMask), front);
+		const __m256i bgColor = _mm256_andnot_si256(bgClear, b);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_blendv_epi8(bgColor, fgColor, useFg));
+
+		hit = _mm256_or_si256(hit, _mm256_andnot_si256(_mm256_or_si256(bgClear, fgClear), _mm256_and_si256(f, spriteZero)));
+	}
+
+	return !_mm256_testz_si256(hit, hit);
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i pixelMask = _mm_set1_epi8(0x03);
+	const __m128i colorMask = _mm_set1_epi8(0x0F);
+	const __m128i front = _mm_set1_epi8(0x10);
+	const __m128i spriteZero = _mm_set1_epi8(0x20);
+	__m128i hit = zero;
+
+	for(int i = 0; i < count; i += 16) {
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bg + i));
+		const __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fg + i));
+
+		const __m128i bgClear = _mm_cmpeq_epi8(_mm_and_si128(b, pixelMask), zero);
+		const __m128i fgClear = _mm_cmpeq_epi8(_mm_and_si128(f, pixelMask), zero);
+		const __m128i fgFront = _mm_cmpeq_epi8(_mm_and_si128(f, front), front);
+		const __m128i useFg = _mm_andnot_si128(fgClear, _mm_or_si128(bgClear, fgFront));
+
+		const __m128i fgColor = _mm_or_si128(_mm_and_si128(f, colorMask), front);
+		const __m128i bgColor = _mm_andnot_si128(bgClear, b);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(_mm_and_si128(useFg, fgColor), _mm_andnot_si128(useFg, bgColor)));
+
+		hit = _mm_or_si128(hit, _mm_andnot_si128(_mm_or_si128(bgClear, fgClear), _mm_and_si128(f, spriteZero)));
+	}
+
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(hit, zero)) != 0xFFFF;
+#else
+	bool hit = false;
+
+	for(int i = 0; i < count; i++) {
+		out[i] = MuxPixel(bg[i], fg[i]);
+		hit |= (bg[i] & 3) && (fg[i] & 3) && (fg[i] & 0x20);
+	}
+
+	return hit;
+#endif
+}
+
 void ppu2C02::Reset() {
 	Control.reg = 0;
 	Mask.reg = 0;
@@ -116,32 +196,81 @@ void ppu2C02::HardReset() {
 
 	scanlineX = 0;
 	scanlineY = 241;
-}
 
-void ppu2C02::Clock() {
-	last2002Read++;
+	DecodeChrRam();
+}
 
+void ppu2C02::DecayIoBus(uint32_t dots) {
 	if(reset1 > 0) {
-		reset1--;
-
-		if(reset1 == 0) {
+		if(reset1 <= dots) {
+			reset1 = 0;
 			ioBus = ioBus & 0xE0; // DDD- ----
+		} else {
+			reset1 -= dots;
 		}
 	}
 	if(reset2 > 0) {
-		reset2--;
-
-		if(reset2 == 0) {
+		if(reset2 <= dots) {
+			reset2 = 0;
 			ioBus = ioBus & 0xDF; // DD-D DDDD
+		} else {
+			reset2 -= dots;
 		}
 	}
 	if(reset3 > 0) {
-		reset3--;
-
-		if(reset3 == 0) {
+		if(reset3 <= dots) {
+			reset3 = 0;
 			ioBus = ioBus & 0x3F; // --DD DDDD
+		} else {
+			reset3 -= dots;
+		}
+	}
+}
+
+void ppu2C02::FetchTileAttrib() {
+	bgNextTileAttrib = ppuRead(0x23C0 |
+		(vramAddr.nametableY << 11) |
+		(vramAddr.nametableX << 10) |
+		((vramAddr.coarseY >> 2) << 3) |
+		(vramAddr.coarseX >> 2)
+	);
+
+	if(vramAddr.coarseY & 2)
+		bgNextTileAttrib >>= 4;
+	if(vramAddr.coarseX & 2)
+		bgNextTileAttrib >>= 2;
+	bgNextTileAttrib &= 0x03;
+}
+
+void ppu2C02::IncrementScrollX() {
+	if(vramAddr.coarseX == 31) {
+		vramAddr.coarseX = 0;
+		vramAddr.nametableX = ~vramAddr.nametableX;
+	} else {
+		vramAddr.coarseX++;
+	}
+}
+
+void ppu2C02::IncrementScrollY() {
+	if(vramAddr.fineY < 7) {
+		vramAddr.fineY++;
+	} else {
+		vramAddr.fineY = 0;
+		if(vramAddr.coarseY == 29) {
+			vramAddr.coarseY = 0;
+			vramAddr.nametableY = ~vramAddr.nametableY;
+		} else if(vramAddr.coarseY == 31) {
+			vramAddr.coarseY = 0;
+		} else {
+			vramAddr.coarseY++;
 		}
 	}
+}
+
+void ppu2C02::Clock() {
+	last2002Read++;
+
+	DecayIoBus(1);
 
 	if(scanlineY == 0 && scanlineX == 0 && oddFrame && Mask.renderBackground) {
 		// "Odd Frame" cycle skip
@@ -181,33 +310,17 @@ void ppu2C02::Clock() {
 					bgNextTileId = ppuRead(0x2000 | (vramAddr.reg & 0x0FFF));
 					break;
 				case 2:
-					bgNextTileAttrib = ppuRead(0x23C0 |
-						(vramAddr.nametableY << 11) |
-						(vramAddr.nametableX << 10) |
-						((vramAddr.coarseY >> 2) << 3) |
-						(vramAddr.coarseX >> 2)
-					);
-
-					if(vramAddr.coarseY & 2)
-						bgNextTileAttrib >>= 4;
-					if(vramAddr.coarseX & 2)
-						bgNextTileAttrib >>= 2;
-					bgNextTileAttrib &= 0x03;
+					FetchTileAttrib();
 					break;
 				case 4:
-					bgNextTile = ppuRead((Control.patternBackground << 12) + (bgNextTileId << 4) + vramAddr.fineY);
+					bgNextTile = FetchBackgroundPlane((Control.patternBackground << 12) + (bgNextTileId << 4) + vramAddr.fineY);
 					break;
 				case 6:
-					bgNextTile = math::interleave(bgNextTile, (uint16_t)ppuRead((Control.patternBackground << 12) + (bgNextTileId << 4) + vramAddr.fineY + 8));
+					bgNextTile |= FetchBackgroundPlane((Control.patternBackground << 12) + (bgNextTileId << 4) + vramAddr.fineY + 8);
 					break;
 				case 7:
 					if(Mask.renderBackground || Mask.renderSprites) {
-						if(vramAddr.coarseX == 31) {
-							vramAddr.coarseX = 0;
-							vramAddr.nametableX = ~vramAddr.nametableX;
-						} else {
-							vramAddr.coarseX++;
-						}
+						IncrementScrollX();
 					}
 					break;
 			}
@@ -216,19 +329,7 @@ void ppu2C02::Clock() {
 		switch(scanlineX) {
 			case 256:
 				if(Mask.renderBackground || Mask.renderSprites) {
-					if(vramAddr.fineY < 7) {
-						vramAddr.fineY++;
-					} else {
-						vramAddr.fineY = 0;
-						if(vramAddr.coarseY == 29) {
-							vramAddr.coarseY = 0;
-							vramAddr.nametableY = ~vramAddr.nametableY;
-						} else if(vramAddr.coarseY == 31) {
-							vramAddr.coarseY = 0;
-						} else {
-							vramAddr.coarseY++;
-						}
-					}
+					IncrementScrollY();
 				}
 				break;
 			case 257:
@@ -306,7 +407,6 @@ void ppu2C02::Clock() {
 		if(scanlineX >= 257 && scanlineX <= 320) {
 			int i = (scanlineX - 257) / 8;
 			const auto sprite = oam2[i];
-			uint8_t bits;
 			uint16_t addr;
 
 			if(!Control.spriteSize) {
@@ -335,22 +435,10 @@ void ppu2C02::Clock() {
 					// TODO: Garbage fetch?
 					break;
 				case 4:
-					bits = ppuRead(addr);
-
-					if(sprite.Attributes.FlipHorizontal) {
-						bits = math::reverse(bits);
-					}
-
-					spriteShifterLo[i] = bits;
+					spriteShifterLo[i] = FetchSpritePlane(addr, sprite.Attributes.FlipHorizontal);
 					break;
 				case 6:
-					bits = ppuRead(addr + 8);
-
-					if(sprite.Attributes.FlipHorizontal) {
-						bits = math::reverse(bits);
-					}
-
-					spriteShifterHi[i] = bits;
+					spriteShifterHi[i] = FetchSpritePlane(addr + 8, sprite.Attributes.FlipHorizontal);
 					break;
 			}
 		}
@@ -363,8 +451,8 @@ void ppu2C02::Clock() {
 		}
 	}
 
-	uint8_t bgPixel = 0;
-	uint8_t bgPalette = 0;
+	// pixel | palette << 2
+	uint8_t bg = 0;
 
 	if(Mask.renderBackground) {
 		// Handle Pixel Selection by selecting the relevant bit
@@ -375,15 +463,14 @@ void ppu2C02::Clock() {
 
 		// Select Plane pixels by extracting from the shifter
 		// at the required location.
-		bgPixel = (bgShifterPattern >> shift) & 3;
+		bg = (bgShifterPattern >> shift) & 3;
 
 		// Get palette
-		bgPalette = (bgShifterAttrib >> shift) & 3;
+		bg |= ((bgShifterAttrib >> shift) & 3) << 2;
 	}
 
-	uint8_t fgPixel = 0;
-	uint8_t fgPalette = 0;
-	uint8_t fgPriority = 0;
+	// pixel | palette << 2 | front << 4 | sprite zero << 5
+	uint8_t fg = 0;
 
 	if(Mask.renderSprites) {
 		spriteZeroBeingRendered = false;
@@ -395,12 +482,10 @@ void ppu2C02::Clock() {
 				uint8_t p1_pixel = (spriteShifterHi[i] & 0x80) > 0;
 
 				// Combine to form pixel index
-				fgPixel = (p1_pixel << 1) | p0_pixel;
-
-				fgPalette = sprite.Attributes.Palette + 4;
-				fgPriority = !sprite.Attributes.Priority;
+				uint8_t fgPixel = (p1_pixel << 1) | p0_pixel;
 
 				if(fgPixel != 0) {
+					fg = fgPixel | (sprite.Attributes.Palette << 2) | (!sprite.Attributes.Priority << 4) | ((i == 0) << 5);
 					if(i == 0) {
 						spriteZeroBeingRendered = true;
 					}
@@ -410,37 +495,19 @@ void ppu2C02::Clock() {
 		}
 	}
 
-	uint8_t pixel = 0;
-	uint8_t palette = 0;
-
-	if(bgPixel == 0) {
-		if(fgPixel != 0) {
-			pixel = fgPixel;
-			palette = fgPalette;
-		}
-	} else if(fgPixel == 0) {
-		pixel = bgPixel;
-		palette = bgPalette;
-	} else {
-		if(fgPriority) {
-			pixel = fgPixel;
-			palette = fgPalette;
-		} else {
-			pixel = bgPixel;
-			palette = bgPalette;
-		}
-
-		if(spriteZeroPossible && spriteZeroBeingRendered &&
-		   Mask.renderBackground && Mask.renderSprites &&
-		   (((Mask.backgroundLeft && Mask.spriteLeft) || scanlineX >= 9) && scanlineX < 256)) {
-			// ScanlineX >= 2
-			Status.sprite0Hit = true;
-		}
+	if((bg & 3) && (fg & 3) &&
+	   spriteZeroPossible && spriteZeroBeingRendered &&
+	   Mask.renderBackground && Mask.renderSprites &&
+	   (((Mask.backgroundLeft && Mask.spriteLeft) || scanlineX >= 9) && scanlineX < 256)) {
+		// ScanlineX >= 2
+		Status.sprite0Hit = true;
 	}
 
-	if(scanlineX > 0 && scanlineX <= 256 &&
-	   scanlineY >= 0 && scanlineY < 240) 
-	   texture->SetPixel(scanlineX - 1, scanlineY, GetPaletteColor(palette, pixel));
+	if(render && scanlineX > 0 && scanlineX <= 256 &&
+	   scanlineY >= 0 && scanlineY < 240) {
+		const uint8_t color = MuxPixel(bg, fg);
+		texture->SetIndex(scanlineX - 1, scanlineY, GetPaletteIndex(color >> 2, color & 3));
+	}
 
 	scanlineX++;
 	if(scanlineX >= 341) {
@@ -456,14 +523,191 @@ void ppu2C02::Clock() {
 	}
 }
 
+void ppu2C02::Run(int dots) {
+	while(dots > 0) {
+		if(scanlineY == 0 && scanlineX == 0 && oddFrame && Mask.renderBackground) {
+			// "Odd Frame" cycle skip, done here so the line after it can be batched as well
+			scanlineX = 1;
+		}
+
+		if(scanlineX == 1 && scanlineY >= 0 && scanlineY < 240 && dots >= 256) {
+			RenderScanline();
+			dots -= 256;
+		} else {
+			Clock();
+			dots--;
+
+			// After the visible lines nothing but the io bus decay changes until vblank starts or the frame ends,
+			// the pixel logic gives the same result on every dot as long as it can't make sprite zero hit
+			if(scanlineY >= 240 && scanlineY <= 260 && dots > 0 &&
+			   (Status.sprite0Hit || !spriteZeroPossible || !Mask.renderBackground || !Mask.renderSprites)) {
+				int pos = scanlineY * 341 + scanlineX;
+				// dot 1 of line 241 and the last dot of line 260 are left to Clock
+				const int end = pos <= 241 * 341 + 1 ? 241 * 341 + 1 : 260 * 341 + 340;
+				const int skip = std::min(dots, end - pos);
+
+				last2002Read += skip;
+				DecayIoBus(skip);
+				pos += skip;
+				scanlineY = pos / 341;
+				scanlineX = pos % 341;
+				dots -= skip;
+			}
+		}
+	}
+}
+
+// Dots 1 - 256 of a visible scanline at once. Nothing outside the ppu can change its state in between
+// so this has to end up exactly where 256 calls to Clock would, including the order of all ppu bus reads
+void ppu2C02::RenderScanline() {
+	last2002Read += 256;
+	DecayIoBus(256);
+
+	const bool rendering = Mask.renderBackground || Mask.renderSprites;
+
+	// The background as a stream of 8 pixel tiles with 2 bits per pixel.
+	// What's left in the shifters, the tile loaded on dot 1 and the 32 tiles fetched on this line
+	uint16_t patterns[34];
+	uint16_t attribs[34];
+	patterns[0] = (uint16_t)(bgShifterPattern >> 14);
+	attribs[0] = (uint16_t)(bgShifterAttrib >> 14);
+	patterns[1] = bgNextTile;
+	attribs[1] = (bgNextTileAttrib & 3) * 0x5555;
+
+	for(int i = 2; i < 34; i++) {
+		bgNextTileId = ppuRead(0x2000 | (vramAddr.reg & 0x0FFF));
+		FetchTileAttrib();
+		bgNextTile = FetchBackgroundPlane((Control.patternBackground << 12) + (bgNextTileId << 4) + vramAddr.fineY);
+		bgNextTile |= FetchBackgroundPlane((Control.patternBackground << 12) + (bgNextTileId << 4) + vramAddr.fineY + 8);
+
+		if(rendering) {
+			IncrementScrollX();
+		}
+
+		patterns[i] = bgNextTile;
+		attribs[i] = (bgNextTileAttrib & 3) * 0x5555;
+	}
+
+	if(rendering) {
+		IncrementScrollY();
+	}
+
+	// The tile fetched last only gets loaded on dot 257
+	if(Mask.renderBackground) {
+		bgShifterPattern = (((uint32_t)patterns[31] << 16) | patterns[32]) << 14;
+		bgShifterAttrib = (((uint32_t)attribs[31] << 16) | attribs[32]) << 14;
+	} else {
+		bgShifterPattern = (bgShifterPattern & 0xFFFF0000) | patterns[32];
+		bgShifterAttrib = (bgShifterAttrib & 0xFFFF0000) | attribs[32];
+	}
+
+	// Sprite pixels of the line. pixel | palette << 2 | front << 4 | sprite zero << 5
+	// The first sprite with a non transparent pixel wins so they are drawn back to front
+	uint8_t fgLine[256] {};
+
+	if(Mask.renderSprites) {
+		for(int i = spriteCount - 1; i >= 0; i--) {
+			const auto sprite = oam2[i];
+
+			for(int j = 0; j < 8 && sprite.x + j < 256; j++) {
+				uint8_t pixel = (((spriteShifterHi[i] << j) & 0x80) >> 6) | (((spriteShifterLo[i] << j) & 0x80) >> 7);
+
+				if(pixel != 0) {
+					fgLine[sprite.x + j] = pixel | (sprite.Attributes.Palette << 2) | (!sprite.Attributes.Priority << 4) | ((i == 0) << 5);
+				}
+			}
+		}
+	}
+
+	if(Mask.renderSprites) {
+		spriteZeroBeingRendered = fgLine[255] & 0x20;
+	}
+
+	// without pixels the lines are only needed to find a sprite zero hit
+	const bool hitPossible = spriteZeroPossible && Mask.renderBackground && Mask.renderSprites;
+	if(render || (hitPossible && !Status.sprite0Hit)) {
+		uint8_t bgLine[256] {};
+
+		if(Mask.renderBackground) {
+			for(int x = 0; x < 256; x++) {
+				const int pos = fineX + x;
+				const int shift = 14 - ((pos & 7) << 1);
+
+				bgLine[x] = ((patterns[pos >> 3] >> shift) & 3) | (((attribs[pos >> 3] >> shift) & 3) << 2);
+			}
+		}
+
+		// sprite zero can't hit on the last column or the first 8 if either of them is clipped
+		fgLine[255] &= ~0x20;
+		if(!Mask.backgroundLeft || !Mask.spriteLeft) {
+			for(int x = 0; x < 8; x++) {
+				fgLine[x] &= ~0x20;
+			}
+		}
+
+		uint8_t line[256];
+		if(MuxPixels(bgLine, fgLine, line, 256) && hitPossible) {
+			Status.sprite0Hit = true;
+		}
+
+		if(render) {
+			uint8_t indices[32];
+			for(int i = 0; i < 32; i++) {
+				indices[i] = GetPaletteIndex(i >> 2, i & 3);
+			}
+
+			uint8_t* out = texture->IndexLine(scanlineY);
+			for(int x = 0; x < 256; x++) {
+				out[x] = indices[line[x]];
+			}
+		}
+	}
+
+	// Clock counts the sprites down from dot 2 on and shifts them out once they are reached
+	if(Mask.renderSprites) {
+		for(int i = 0; i < spriteCount; i++) {
+			const int shifts = 255 - std::min<int>(oam2[i].x, 255);
+
+			oam2[i].x -= 255 - shifts;
+			if(shifts >= 8) {
+				spriteShifterLo[i] = 0;
+				spriteShifterHi[i] = 0;
+			} else {
+				spriteShifterLo[i] <<= shifts;
+				spriteShifterHi[i] <<= shifts;
+			}
+		}
+	}
+
+	scanlineX = 257;
+}
+
+int ppu2C02::DotsTillEvent() const {
+	const int frameLength = 262 * 341;
+	const int pos = (scanlineY + 1) * 341 + scanlineX;
+
+	int vblank = (241 + 1) * 341 + 1 - pos;
+	int frameEnd = (260 + 1) * 341 + 340 - pos;
+	if(vblank < 0) vblank += frameLength;
+	if(frameEnd < 0) frameEnd += frameLength;
+
+	// one less in case the odd frame skip happens in between
+	return std::max(std::min(vblank, frameEnd) - 1, 0);
+}
+
 void ppu2C02::SaveState(saver& saver) {
 	saver << Control.reg;
 	saver << *reinterpret_cast<PpuState*>(this);
 }
 
 void ppu2C02::LoadState(saver& saver) {
+	uint8_t previous[sizeof(chrRAM)];
+	std::memcpy(previous, chrRAM, sizeof(chrRAM));
+
 	saver >> Control.reg;
 	saver >> *reinterpret_cast<PpuState*>(this);
+	// states are mostly loaded close to the current one so most tiles are still decoded
+	DecodeChrRam(previous);
 }
 
 uint8_t ppu2C02::cpuRead(uint16_t addr, bool readOnly) {
@@ -583,6 +827,48 @@ void ppu2C02::ppuWrite(uint16_t addr, uint8_t data) {
 		// 0x000 - 0x1FFF
 	} else {
 		getRef(addr) = data;
+
+		if(addr < 0x2000) {
+			chrRamRows[ChrRow::Index(addr)] = ChrRow::Decode(chrRAM[addr & ~8], chrRAM[addr | 8]);
+		}
+	}
+}
+
+ChrRow ppu2C02::PatternRow(uint16_t addr) {
+	addr &= 0x1FFF;
+	if(const auto page = chrPages.rows[addr >> 10]) {
+		return page[ChrRow::Index(addr & 0x3FF)];
+	}
+
+	return ChrRow::Decode(ppuRead(addr & ~8, true), ppuRead(addr | 8, true));
+}
+
+// One bit plane of a pattern row, already spread out to the 2 bit per pixel layout of the background shifters
+uint16_t ppu2C02::FetchBackgroundPlane(uint16_t addr) {
+	if(const auto page = chrPages.rows[addr >> 10]) {
+		return page[ChrRow::Index(addr & 0x3FF)].pattern & (addr & 8 ? 0xAAAA : 0x5555);
+	}
+
+	const uint8_t data = ppuRead(addr);
+	return addr & 8 ? math::interleave((uint8_t)0, data) : math::interleave(data, (uint8_t)0);
+}
+
+uint8_t ppu2C02::FetchSpritePlane(uint16_t addr, bool flip) {
+	if(const auto page = chrPages.rows[addr >> 10]) {
+		return page[ChrRow::Index(addr & 0x3FF)].planes[flip][(addr >> 3) & 1];
+	}
+
+	const uint8_t data = ppuRead(addr);
+	return flip ? math::reverse(data) : data;
+}
+
+void ppu2C02::DecodeChrRam(const uint8_t* previous) {
+	for(uint16_t addr = 0; addr < sizeof(chrRAM); addr += 16) {
+		if(previous && std::memcmp(previous + addr, chrRAM + addr, 16) == 0) continue;
+
+		for(uint16_t i = 0; i < 8; i++) {
+			chrRamRows[ChrRow::Index(addr + i)] = ChrRow::Decode(chrRAM[addr + i], chrRAM[addr + i + 8]);
+		}
 	}
 }
 
@@ -648,6 +934,10 @@ uint8_t& ppu2C02::getRef(uint16_t addr) {
 }
 
 Color ppu2C02::GetPaletteColor(uint8_t palette, uint8_t pixel) const {
+	return colors[GetPaletteIndex(palette, pixel)];
+}
+
+uint8_t ppu2C02::GetPaletteIndex(uint8_t palette, uint8_t pixel) const {
 	uint8_t addr = ((palette << 2) + pixel) & 0x1F;
 
 	switch(addr) {
@@ -665,7 +955,7 @@ Color ppu2C02::GetPaletteColor(uint8_t palette, uint8_t pixel) const {
 			break;
 	}
 
-	return colors[palettes[addr] & 0x3F];
+	return palettes[addr] & 0x3F;
 }
 
 }
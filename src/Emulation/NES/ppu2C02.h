@@ -2,7 +2,7 @@
 #include <cstdint>
 
 #include "Cartridge.h"
-#include "../../RenderImage.h"
+#include "../../Framebuffer.h"
 #include "../../saver.h"
 
 namespace Nes {
@@ -35,17 +35,17 @@ struct PpuState {
 
 	uint8_t writeState = 0;
 	uint8_t readBuffer = 0;
-	// Color palettes
-	uint8_t palettes[32];
+	// Color palettes. The memories start out zeroed so every run from power on is the same
+	uint8_t palettes[32] {};
 	// Nametables
-	uint8_t vram[0x1000];
+	uint8_t vram[0x1000] {};
 	// For cartridges without ChrRom
-	uint8_t chrRAM[0x2000];
+	uint8_t chrRAM[0x2000] {};
 
-	Sprite oam[64], oam2[8];
-	uint8_t spriteCount;
-	uint8_t spriteShifterLo[8], spriteShifterHi[8];
-	bool spriteZeroPossible, spriteZeroBeingRendered;
+	Sprite oam[64] {}, oam2[8] {};
+	uint8_t spriteCount = 0;
+	uint8_t spriteShifterLo[8] {}, spriteShifterHi[8] {};
+	bool spriteZeroPossible = false, spriteZeroBeingRendered = false;
 
 	int scanlineX = 0, scanlineY = 241;
 
@@ -129,12 +129,26 @@ class ppu2C02 : public PpuState {
 
 	std::shared_ptr<Mapper> cartridge;
 
+  private:
+	// chrRAM decoded, kept up to date by ppuWrite
+	ChrRow chrRamRows[sizeof(chrRAM) / 2] {};
+	// published by the cartridge, see Mapper::UpdateChrPages
+	ChrPageTable chrPages { {}, chrRamRows };
+
   public:
-	RenderImage* texture = nullptr;
+	// written as indices into colors
+	Framebuffer* texture = nullptr;
+	// pixels are only written while set, everything else like sprite 0 hits still happens
+	bool render = true;
+	static const Color colors[64];
 
 	void Reset();
 	void HardReset();
 	void Clock();
+	// Same as calling Clock dots times, visible scanlines that fit completely are rendered in one go
+	void Run(int dots);
+	// Number of dots that can be clocked without setting vblank or completing the frame
+	int DotsTillEvent() const;
 
 	void SaveState(saver& saver);
 	void LoadState(saver& saver);
@@ -146,10 +160,22 @@ class ppu2C02 : public PpuState {
 	// ppu bus
 	uint8_t ppuRead(uint16_t addr, bool readOnly = false);
 	void ppuWrite(uint16_t addr, uint8_t data);
+	// pattern row containing addr, without side effects
+	ChrRow PatternRow(uint16_t addr);
 
   private:
 	Color GetPaletteColor(uint8_t palette, uint8_t pixel) const;
+	uint8_t GetPaletteIndex(uint8_t palette, uint8_t pixel) const;
 	void LoadBackgroundShifters();
+	uint16_t FetchBackgroundPlane(uint16_t addr);
+	uint8_t FetchSpritePlane(uint16_t addr, bool flip);
+	// decodes every tile of chrRAM, or only the ones that differ from previous
+	void DecodeChrRam(const uint8_t* previous = nullptr);
+	void FetchTileAttrib();
+	void IncrementScrollX();
+	void IncrementScrollY();
+	void DecayIoBus(uint32_t dots);
+	void RenderScanline();
 	uint8_t& getRef(uint16_t addr);
 };
 
@@ -0,0 +1,112 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Color {
+	uint8_t R, G, B;
+};
+
+// Image the cores draw into. Pixels are either written as colors directly or as palette indices,
+// which are only converted to colors when the image is actually read
+class Framebuffer {
+  private:
+	int Width, Height;
+	// RGBA
+	mutable std::vector<uint32_t> imgData;
+
+	std::vector<uint8_t> indexData;
+	uint32_t palette[256] {};
+	// indexData was written since it was last converted to imgData
+	mutable bool indexDirty = false;
+	// imgData changed since TakeModified was last called
+	mutable bool modified = true;
+
+	static uint32_t Pack(Color col) {
+		return col.R | (col.G << 8) | (col.B << 16) | 0xFF000000;
+	}
+
+	void Resolve() const {
+		if(!indexDirty) return;
+
+		const uint8_t* src = indexData.data();
+		uint32_t* dst = imgData.data();
+		for(size_t i = 0; i < imgData.size(); i++) {
+			dst[i] = palette[src[i]];
+		}
+		indexDirty = false;
+		modified = true;
+	}
+
+  public:
+	Framebuffer(int width, int height) : Width(width), Height(height) {
+		imgData.resize(width * height);
+		indexData.resize(width * height);
+	}
+
+	int GetWidth() const { return Width; }
+	int GetHeight() const { return Height; }
+
+	// Colors of the palette indices, up to 256
+	void SetPalette(const Color* colors, size_t count) {
+		assert(count <= 256);
+		for(size_t i = 0; i < count; i++) {
+			palette[i] = Pack(colors[i]);
+		}
+	}
+
+	// Copies pixels and palette of an image with the same size
+	void CopyPixels(const Framebuffer& other) {
+		assert(Width == other.Width && Height == other.Height);
+		imgData = other.imgData;
+		indexData = other.indexData;
+		std::copy_n(other.palette, 256, palette);
+		indexDirty = other.indexDirty;
+		modified = true;
+	}
+
+	void Clear(Color col) {
+		indexDirty = false;
+		modified = true;
+		std::fill(imgData.begin(), imgData.end(), Pack(col));
+	}
+	void SetPixel(int x, int y, Color col) {
+		assert(x >= 0 && x < Width && y >= 0 && y < Height);
+		Resolve();
+		modified = true;
+		imgData[x + y * Width] = Pack(col);
+	}
+	Color GetPixel(int x, int y) const {
+		assert(x >= 0 && x < Width && y >= 0 && y < Height);
+		Resolve();
+		const auto col = imgData[x + y * Width];
+		return { (uint8_t)col, (uint8_t)(col >> 8), (uint8_t)(col >> 16) };
+	}
+
+	void SetIndex(int x, int y, uint8_t index) {
+		assert(x >= 0 && x < Width && y >= 0 && y < Height);
+		indexData[x + y * Width] = index;
+		indexDirty = true;
+	}
+	// Palette indices of row y, for writing a whole line at once
+	uint8_t* IndexLine(int y) {
+		assert(y >= 0 && y < Height);
+		indexDirty = true;
+		return &indexData[y * Width];
+	}
+
+	// Width * Height RGBA pixels, row by row
+	const uint32_t* Data() const {
+		Resolve();
+		return imgData.data();
+	}
+	// Whether the pixels changed since the last call, so unchanged frames aren't uploaded again
+	bool TakeModified() const {
+		Resolve();
+		const auto res = modified;
+		modified = false;
+		return res;
+	}
+};
@@ -31,7 +31,8 @@ InputMapper hotkeys {{
 	{ "LoadState",		 6, { GLFW_KEY_L,           0 } },
 	{ "SelectNextState", 7, { GLFW_KEY_KP_ADD,      0 } },
 	{ "SelectLastState", 8, { GLFW_KEY_KP_SUBTRACT, 0 } },
-	{ "Maximise",		 9, { GLFW_KEY_F11,         0 } } 
+	{ "Maximise",		 9, { GLFW_KEY_F11,         0 } },
+	{ "Rewind",			10, { GLFW_KEY_BACKSPACE,   0 } }
 }};
 InputMapper Chip8 = {{
 	{"0", 0,  { GLFW_KEY_1, 0 } },
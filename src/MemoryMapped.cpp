@@ -20,7 +20,7 @@ static std::string getWinErrorString() {
 	return message;
 }
 
-MemoryMapped::MemoryMapped(const std::string& filePath, size_t size) {
+MemoryMapped::MemoryMapped(const std::string& filePath, size_t size) : size(size) {
 	fs::create_directories(fs::path(filePath).parent_path());
 
 	file = CreateFileA(filePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_FLAG_RANDOM_ACCESS, nullptr);
@@ -43,8 +43,31 @@ MemoryMapped::MemoryMapped(const std::string& filePath, size_t size) {
 	}
 }
 
+MemoryMapped::MemoryMapped(const std::string& filePath) {
+	file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Error opening the file: " + getWinErrorString());
+	}
+
+	LARGE_INTEGER large;
+	GetFileSizeEx(file, &large);
+	size = large.QuadPart;
+
+	// empty files can't be mapped
+	if(size == 0) return;
+
+	mappedFile = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	map = (uint8_t*)MapViewOfFile(mappedFile, FILE_MAP_READ, 0, 0, size);
+	if(map == nullptr) {
+		CloseHandle(mappedFile);
+		CloseHandle(file);
+		throw std::runtime_error("Error mmapping the file");
+	}
+}
+
 MemoryMapped::~MemoryMapped() {
-	UnmapViewOfFile(map);
+	if(map) UnmapViewOfFile(map);
 
 	if(mappedFile) {
 		CloseHandle(mappedFile);
@@ -60,9 +83,10 @@ MemoryMapped::~MemoryMapped() {
 
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
-MemoryMapped::MemoryMapped(const std::string& filePath, size_t size) {
+MemoryMapped::MemoryMapped(const std::string& filePath, size_t size) : size(size) {
 	fs::create_directories(fs::path(filePath).parent_path());
 
 	if(!fs::exists(filePath)) {
@@ -90,8 +114,35 @@ MemoryMapped::MemoryMapped(const std::string& filePath, size_t size) {
 	}
 }
 
+MemoryMapped::MemoryMapped(const std::string& filePath) {
+	auto file = open(filePath.c_str(), O_RDONLY);
+	if(file == -1) {
+		throw std::runtime_error("Error opening the file");
+	}
+
+	struct stat info;
+	if(fstat(file, &info) == -1) {
+		close(file);
+		throw std::runtime_error("Error opening the file");
+	}
+	size = info.st_size;
+
+	// empty files can't be mapped
+	if(size == 0) {
+		close(file);
+		return;
+	}
+
+	map = (uint8_t*)mmap(0, size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if(map == MAP_FAILED) {
+		map = nullptr;
+		throw std::runtime_error("Error memory mapping the file");
+	}
+}
+
 MemoryMapped::~MemoryMapped() {
-	munmap(map, size);
+	if(map) munmap(map, size);
 	map = nullptr;
 }
 
@@ -14,7 +14,10 @@ class MemoryMapped {
 #endif
 
   public:
+	// Maps file writable, creating it with the given size if it doesn't exist
 	MemoryMapped(const std::string& file, size_t size);
+	// Maps an existing file read only. Pages are only loaded once they are accessed
+	explicit MemoryMapped(const std::string& file);
 	MemoryMapped(const MemoryMapped&) = delete;
 	~MemoryMapped();
 
@@ -23,6 +26,10 @@ class MemoryMapped {
 	uint8_t& operator[](size_t pos);
 	const uint8_t& operator[](size_t pos) const;
 
+	const uint8_t* data() const { return map; }
+
 	uint8_t* begin() { return map; }
 	uint8_t* end() { return map + size; }
+	const uint8_t* begin() const { return map; }
+	const uint8_t* end() const { return map + size; }
 };
@@ -1,31 +1,19 @@
 #pragma once
-#include <cassert>
-// #include <cmath>
-#include <cstdint>
-#include <vector>
-
 #include <GLFW/glfw3.h>
 
-struct Color {
-	uint8_t R, G, B;
-};
+#include "Framebuffer.h"
 
-class RenderImage {
+// Framebuffer that can be drawn with ImGui::Image
+class RenderImage : public Framebuffer {
   private:
 	GLuint textureID;
-	int Width, Height;
-	std::vector<Color> imgData;
 
   public:
-	RenderImage(int width, int height) {
+	RenderImage(int width, int height) : Framebuffer(width, height) {
 		glGenTextures(1, &textureID);
-		Width = width;
-		Height = height;
-
-		imgData.resize(width * height);
 
 		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Width, Height, 0, GL_RGB, GL_UNSIGNED_BYTE, imgData.data());
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, Data());
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -37,21 +25,6 @@ class RenderImage {
 	RenderImage(const RenderImage&) = delete;
 	RenderImage& operator=(const RenderImage&) = delete;
 
-	int GetWidth() const { return Width; }
-	int GetHeight() const { return Height; }
-
-	void Clear(Color col) {
-		std::fill(imgData.begin(), imgData.end(), col);
-	}
-	void SetPixel(int x, int y, Color col) {
-		assert(x >= 0 && x < Width && y >= 0 && y < Height);
-		imgData[x + y * Width] = col;
-	}
-	Color GetPixel(int x, int y) const {
-		assert(x >= 0 && x < Width && y >= 0 && y < Height);
-		return imgData[x + y * Width];
-	}
-
 #if false
 	void Line(int x0, int y0, int x1, int y1, Color col) {
 		const int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
@@ -79,7 +52,8 @@ class RenderImage {
 
 	GLuint GetTextureId() const { return textureID; };
 	void BufferImage() const {
+		if(!TakeModified()) return;
 		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Width, Height, GL_RGB, GL_UNSIGNED_BYTE, imgData.data());
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GetWidth(), GetHeight(), GL_RGBA, GL_UNSIGNED_BYTE, Data());
 	}
 };
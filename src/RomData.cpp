@@ -0,0 +1,34 @@
+#include "RomData.h"
+
+#include <stdexcept>
+
+#include "MemoryMapped.h"
+
+RomData::RomData(std::vector<uint8_t> bytes) {
+	auto buffer = std::make_shared<const std::vector<uint8_t>>(std::move(bytes));
+	ptr = buffer->data();
+	length = buffer->size();
+	storage = std::move(buffer);
+}
+
+RomData RomData::Load(const std::string& path) {
+	auto file = std::make_shared<const MemoryMapped>(path);
+
+	RomData rom;
+	rom.ptr = file->data();
+	rom.length = file->Size();
+	rom.storage = std::move(file);
+	return rom;
+}
+
+RomData RomData::Slice(size_t offset, size_t size) const {
+	if(offset > length || size > length - offset) {
+		throw std::out_of_range("Slice out of range");
+	}
+
+	RomData slice;
+	slice.storage = storage;
+	slice.ptr = ptr + offset;
+	slice.length = size;
+	return slice;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Read only rom bytes. Copies and slices share the same storage,
+// so every emulator instance running a rom uses the same memory for it
+class RomData {
+  private:
+	std::shared_ptr<const void> storage;
+	const uint8_t* ptr = nullptr;
+	size_t length = 0;
+
+  public:
+	RomData() = default;
+	RomData(std::vector<uint8_t> bytes);
+
+	// maps the file read only, pages are loaded once they are first accessed
+	static RomData Load(const std::string& path);
+
+	// bytes [offset, offset + size) sharing the storage of this
+	RomData Slice(size_t offset, size_t size) const;
+
+	const uint8_t* data() const { return ptr; }
+	size_t size() const { return length; }
+	bool empty() const { return length == 0; }
+
+	const uint8_t& operator[](size_t pos) const { return ptr[pos]; }
+
+	const uint8_t* begin() const { return ptr; }
+	const uint8_t* end() const { return ptr + length; }
+};
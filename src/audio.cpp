@@ -1,6 +1,8 @@
 #include "audio.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
 #include <memory>
@@ -8,6 +10,7 @@
 #include <RtAudio.h>
 
 #include "logger.h"
+#include "spscRing.h"
 
 struct sample {
 	float left;
@@ -31,18 +34,22 @@ struct sample {
 // normal audio quality 44100hz
 constexpr uint32_t sampleRate = 44100;
 
-// 8 frames worth of buffer
-constexpr int bufferSize = 8 * 735;
+// samples the output plays per emulated frame
+constexpr size_t frameSamples = sampleRate / 60;
+constexpr int maxBufferFrames = 16;
 
-// read position of output
-static size_t readPos = 0;
-// write position of input
-static size_t writePos = 0;
-// sample buffer
-static std::array<sample, bufferSize> buffer;
+// samples from Resample to the audio callback, which runs on its own thread
+static SpscRing<sample> ring(maxBufferFrames * frameSamples);
+// samples the ring is filled up to at most. Only used by the main thread
+static size_t depth = 8 * frameSamples;
 
-// used to prevent popping
+static std::atomic<uint64_t> underruns { 0 };
+static std::atomic<uint64_t> overruns { 0 };
+static std::atomic<uint64_t> driverUnderflows { 0 };
+
+// used to prevent popping, only touched by the callback
 static sample lastSample { 0, 0 };
+static bool starving = false;
 
 // used to prevent unnecessary resize of inBuffer
 static size_t pushPos;
@@ -55,31 +62,52 @@ static bool audioRunning = false;
 static int AudioCallback(void* outputBuffer, void* inputBuffer, unsigned int nBufferFrames, double streamTime, RtAudioStreamStatus status, void* userData) {
 	const auto outBuffer = static_cast<sample*>(outputBuffer);
 
-	if(readPos < writePos) {
-		lastSample = buffer[(writePos - 1) % bufferSize];
-	}
-
-	size_t i = 0;
-	// output number of requested samples
-	for(; i < nBufferFrames && readPos < writePos; i++) {
-		// copy buffer to left and right channel
-		outBuffer[i] = buffer[readPos % bufferSize];
-		readPos++;
+	size_t i = ring.Pop(outBuffer, nBufferFrames);
+	if(i > 0) {
+		lastSample = outBuffer[i - 1];
 	}
 
 	// if we didn't have enough samples in the buffer
 	if(i < nBufferFrames) {
+		// only count the start of a gap, without a game running the ring stays empty
+		if(!starving) underruns.fetch_add(1, std::memory_order_relaxed);
+		starving = true;
+
 		// Repeat last sample to prevent popping and fade out over time
 		// so single frame drops don't pop and there's no noise over time
 		for(; i < nBufferFrames; i++) {
 			outBuffer[i] = lastSample;
 			lastSample *= 0.9999;
 		}
+	} else {
+		starving = false;
+	}
+	// the driver missed the callback, separate from the ring running dry which is counted above
+	if(status & RTAUDIO_OUTPUT_UNDERFLOW) {
+		driverUnderflows.fetch_add(1, std::memory_order_relaxed);
 	}
 
 	return 0;
 }
 
+void Audio::PushSample(float value) {
+	PushSample(value, value);
+}
+
+void Audio::PushSample(float left, float right) {
+	// reduce buffer allocation by overwriting old values
+	if(pushPos < inBuffer.size()) {
+		inBuffer[pushPos] = { left, right };
+	} else {
+		inBuffer.push_back({ left, right });
+	}
+	pushPos++;
+}
+
+Audio::SampleSink Audio::Output() {
+	return { [](void*, float left, float right) { PushSample(left, right); }, nullptr };
+}
+
 bool Audio::Init() {
 	try {
 		dac = std::make_unique<RtAudio>();
@@ -94,7 +122,7 @@ bool Audio::Init() {
 			options.streamName = "MultiEmu";
 			// options.flags = RTAUDIO_MINIMIZE_LATENCY; // breaks mac TODO: test non fixed sample request
 
-			uint32_t bufferFrames = sampleRate / 60;
+			uint32_t bufferFrames = frameSamples;
 
 			dac->openStream(&parameters, nullptr, RTAUDIO_FLOAT32, sampleRate, &bufferFrames, &AudioCallback, nullptr, &options);
 			dac->startStream();
@@ -132,28 +160,34 @@ void Audio::Resample() {
 		return;
 	}
 
-	// TODO: prevent aliasing?
-	for(size_t i = 0; i < 735; i++) {
-		auto pos = i / 734.0 * (pushPos - 1);
+	// the cores synthesize band-limited samples at close to sampleRate, this only makes up the difference
+	std::array<sample, frameSamples> frame;
+	for(size_t i = 0; i < frameSamples; i++) {
+		auto pos = i / (frameSamples - 1.0) * (pushPos - 1);
 		float f = std::fmod(pos, 1);
 
-		buffer[writePos % bufferSize] = (1 - f) * inBuffer[floor(pos)] + f * inBuffer[ceil(pos)];
-		writePos++;
+		frame[i] = (1 - f) * inBuffer[floor(pos)] + f * inBuffer[ceil(pos)];
 	}
-
 	pushPos = 0;
+
+	// the output plays slower than the emulation makes samples, drop what would add latency
+	const auto buffered = ring.Size();
+	const auto space = buffered < depth ? depth - buffered : 0;
+	if(ring.Push(frame.data(), std::min(space, frame.size())) < frame.size()) {
+		overruns.fetch_add(1, std::memory_order_relaxed);
+	}
 }
 
-void Audio::PushSample(float value) {
-	PushSample(value, value);
+void Audio::SetBufferFrames(int frames) {
+	depth = std::clamp(frames, 2, maxBufferFrames) * frameSamples;
 }
 
-void Audio::PushSample(float left, float right) {
-	// reduce buffer allocation by overwriting old values
-	if(pushPos < inBuffer.size()) {
-		inBuffer[pushPos] = { left, right };
-	} else {
-		inBuffer.push_back({ left, right });
-	}
-	pushPos++;
+Audio::Stats Audio::GetStats() {
+	return {
+		underruns.load(std::memory_order_relaxed),
+		overruns.load(std::memory_order_relaxed),
+		driverUnderflows.load(std::memory_order_relaxed),
+		ring.Size(),
+		depth,
+	};
 }
@@ -1,4 +1,8 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "audioSink.h"
 
 namespace Audio {
 
@@ -7,13 +11,30 @@ bool Init();
 // called at end
 void Dispose();
 
+// push samples onto buffer. should be close to 735 samples/frame to reduce computation. buffer gets resampled to 735 samples
+void PushSample(float value);
+void PushSample(float left, float right);
+// sink for the cores that pushes onto the same buffer
+SampleSink Output();
+
 // Called once per frame and generates 44100/60 = 735 samples
 void Resample();
 
-// push samples onto buffer. should be close to 735 samples/frame to reduce computation. buffer gets resampled to 735 samples
-void PushSample(float value);
+// Samples buffered for the output at most, in frames of 735 samples (2 - 16).
+// More frames add latency but survive longer hitches without popping
+void SetBufferFrames(int frames);
 
-// push samples onto buffer. should be close to 735 samples/frame to reduce computation. buffer gets resampled to 735 samples
-void PushSample(float left, float right);
+struct Stats {
+	// times the buffer ran out of samples
+	uint64_t underruns;
+	// frames that didn't fit into the buffer and were cut off
+	uint64_t overruns;
+	// times the audio driver reported that it ran out, for example because the callback was late
+	uint64_t driverUnderflows;
+	// samples waiting to be played and the most there can be
+	size_t buffered;
+	size_t depth;
+};
+Stats GetStats();
 
 }
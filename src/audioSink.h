@@ -0,0 +1,21 @@
+#pragma once
+
+namespace Audio {
+
+// Receives every sample a sound chip produces. Every emulator instance owns its sink
+// so several of them can run at the same time, user is passed back to push unchanged
+struct SampleSink {
+	void (*push)(void* user, float left, float right) = nullptr;
+	void* user = nullptr;
+
+	// samples are dropped until push is set
+	void Push(float left, float right) const {
+		if(push) push(user, left, right);
+	}
+	void Push(float value) const { Push(value, value); }
+
+	// chips skip mixing their samples while nothing listens
+	bool Connected() const { return push != nullptr; }
+};
+
+}
@@ -0,0 +1,97 @@
+#include "blipBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+static constexpr int phases = 1 << BlipBuffer::phaseBits;
+// a whole step adds up to this over all taps
+static constexpr int32_t kernelUnit = 1 << 15;
+// of the output nyquist frequency, leaves room for the kernel to roll off
+static constexpr double cutoff = 0.9;
+
+struct Kernel {
+	int32_t taps[phases][BlipBuffer::width];
+
+	Kernel() {
+		const double pi = 3.14159265358979323846;
+		const int half = BlipBuffer::width / 2;
+
+		for(int phase = 0; phase < phases; phase++) {
+			// distance of every tap to the step, which is phase / phases after tap half - 1
+			double kernel[BlipBuffer::width];
+			double total = 0;
+			for(int i = 0; i < BlipBuffer::width; i++) {
+				const double x = i - (half - 1) - phase / (double)phases;
+
+				const double sinc = x == 0 ? 1 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+				// blackman window
+				const double window = 0.42 + 0.5 * std::cos(pi * x / half) + 0.08 * std::cos(2 * pi * x / half);
+
+				kernel[i] = sinc * window;
+				total += kernel[i];
+			}
+
+			// rounded so every phase sums to exactly kernelUnit, otherwise the running sum would drift
+			int32_t rounded = 0;
+			for(int i = 0; i < BlipBuffer::width; i++) {
+				taps[phase][i] = (int32_t)std::lround(kernel[i] / total * kernelUnit);
+				rounded += taps[phase][i];
+			}
+			taps[phase][half - 1] += kernelUnit - rounded;
+		}
+	}
+};
+
+static const Kernel kernel;
+
+BlipBuffer::BlipBuffer(double clockRate, int sampleRate, size_t capacity) : buffer(capacity + width) {
+	factor = (uint64_t)std::llround(sampleRate / clockRate * 4294967296.0);
+}
+
+void BlipBuffer::AddDelta(uint32_t time, int32_t delta) {
+	const uint64_t pos = offset + time * factor;
+	const size_t index = pos >> 32;
+	const auto& taps = kernel.taps[(pos >> (32 - phaseBits)) & (phases - 1)];
+
+	if(index + width > buffer.size()) {
+		throw std::runtime_error("Blip buffer overflow");
+	}
+
+	auto out = &buffer[index];
+	for(int i = 0; i < width; i++) {
+		out[i] += (int64_t)delta * taps[i];
+	}
+}
+
+void BlipBuffer::EndFrame(uint32_t time) {
+	offset += time * factor;
+
+	if(Available() + width > buffer.size()) {
+		throw std::runtime_error("Blip buffer overflow");
+	}
+}
+
+size_t BlipBuffer::Read(float* out, size_t count) {
+	count = std::min(count, Available());
+
+	const float scale = 1.0f / ((float)kernelUnit * one);
+	for(size_t i = 0; i < count; i++) {
+		sum += buffer[i];
+		out[i] = sum * scale;
+	}
+
+	// the kernels of the last steps reach past the available samples
+	const size_t remaining = Available() - count + width;
+	std::move(buffer.begin() + count, buffer.begin() + count + remaining, buffer.begin());
+	std::fill(buffer.begin() + remaining, buffer.begin() + count + remaining, 0);
+
+	offset -= (uint64_t)count << 32;
+	return count;
+}
+
+void BlipBuffer::Clear() {
+	std::fill(buffer.begin(), buffer.end(), 0);
+	offset = 0;
+	sum = 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Band-limited synthesis of a signal that only changes in steps.
+// Instead of sampling the output every few clocks a sound chip adds the difference whenever its output changes.
+// Every step is spread over the neighbouring output samples with a windowed sinc kernel,
+// so the result has no aliasing and a channel that doesn't change costs nothing
+class BlipBuffer {
+  public:
+	// amplitude of an output of 1.0
+	static constexpr int32_t one = 1 << 16;
+
+	// taps of the kernel, the output lags the input by half of them
+	static constexpr int width = 16;
+	static constexpr int phaseBits = 6;
+
+  private:
+	// 32.32 fixed point output samples per clock
+	uint64_t factor;
+	// output position of the start of the current frame
+	uint64_t offset = 0;
+
+	// steps convolved with the kernel, the output is the running sum
+	std::vector<int64_t> buffer;
+	int64_t sum = 0;
+
+  public:
+	// capacity is the most output samples that can be waiting to be read
+	BlipBuffer(double clockRate, int sampleRate, size_t capacity);
+
+	// Adds a step of delta at clock time of the current frame
+	void AddDelta(uint32_t time, int32_t delta);
+	// Ends the current frame after time clocks and makes its samples available to Read
+	void EndFrame(uint32_t time);
+
+	// output samples of all finished frames
+	size_t Available() const { return offset >> 32; }
+	// Removes up to count samples and returns how many that were
+	size_t Read(float* out, size_t count);
+	void Clear();
+};
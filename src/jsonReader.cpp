@@ -0,0 +1,290 @@
+#include "jsonReader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+JsonReader::JsonReader(std::string_view text) : pos(text.data()), begin(text.data()), end(text.data() + text.size()) {
+	// utf-8 byte order mark
+	if(text.size() >= 3 && text.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+		pos += 3;
+	}
+}
+
+void JsonReader::SkipSpace() {
+	while(pos < end && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) {
+		pos++;
+	}
+}
+
+void JsonReader::Error(const std::string& message) const {
+	int line = 1;
+	int row = 1;
+	for(auto c = begin; c < pos; c++) {
+		if(*c == '\n') {
+			line++;
+			row = 1;
+		} else {
+			row++;
+		}
+	}
+	throw std::runtime_error(message + " at (" + std::to_string(line) + "," + std::to_string(row) + ")");
+}
+
+JsonToken JsonReader::Next() {
+	while(true) {
+		SkipSpace();
+
+		switch(expect) {
+			case Expect::Done:
+				if(pos != end) Error("Unexpected symbol after the document");
+				return JsonToken::End;
+
+			case Expect::CommaOrEnd: {
+				if(pos == end) Error("Unexpected end");
+
+				const char close = stack.back() == '{' ? '}' : ']';
+				if(*pos == ',') {
+					pos++;
+					expect = stack.back() == '{' ? Expect::Key : Expect::Value;
+					continue;
+				}
+				if(*pos != close) Error("Unexpected symbol '"s + *pos + "' expected ',' or '" + close + "'");
+
+				pos++;
+				stack.pop_back();
+				AfterValue();
+				return close == '}' ? JsonToken::ObjectEnd : JsonToken::ArrayEnd;
+			}
+
+			case Expect::KeyOrEnd:
+				if(pos < end && *pos == '}') {
+					pos++;
+					stack.pop_back();
+					AfterValue();
+					return JsonToken::ObjectEnd;
+				}
+				[[fallthrough]];
+			case Expect::Key:
+				if(pos == end || *pos != '"') Error("Expected key");
+				ReadString();
+
+				SkipSpace();
+				if(pos == end || *pos != ':') Error("Expected ':'");
+				pos++;
+
+				expect = Expect::Value;
+				return JsonToken::Key;
+
+			case Expect::ValueOrEnd:
+				if(pos < end && *pos == ']') {
+					pos++;
+					stack.pop_back();
+					AfterValue();
+					return JsonToken::ArrayEnd;
+				}
+				[[fallthrough]];
+			case Expect::Value:
+				return ReadValue();
+		}
+	}
+}
+
+void JsonReader::Skip() {
+	const auto depth = stack.size();
+	const auto token = Next();
+
+	if(token == JsonToken::ObjectBegin || token == JsonToken::ArrayBegin) {
+		while(stack.size() > depth) {
+			Next();
+		}
+	} else if(token == JsonToken::Key) {
+		Skip();
+	}
+}
+
+void JsonReader::AfterValue() {
+	expect = stack.empty() ? Expect::Done : Expect::CommaOrEnd;
+}
+
+JsonToken JsonReader::ReadValue() {
+	if(pos == end) Error("Unexpected end");
+
+	switch(*pos) {
+		case '{':
+			pos++;
+			stack.push_back('{');
+			expect = Expect::KeyOrEnd;
+			return JsonToken::ObjectBegin;
+		case '[':
+			pos++;
+			stack.push_back('[');
+			expect = Expect::ValueOrEnd;
+			return JsonToken::ArrayBegin;
+		case '"':
+			ReadString();
+			AfterValue();
+			return JsonToken::String;
+		case 't':
+			ReadLiteral("true");
+			boolean = true;
+			AfterValue();
+			return JsonToken::Bool;
+		case 'f':
+			ReadLiteral("false");
+			boolean = false;
+			AfterValue();
+			return JsonToken::Bool;
+		case 'n':
+			ReadLiteral("null");
+			AfterValue();
+			return JsonToken::Null;
+		case '-':
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			ReadNumber();
+			AfterValue();
+			return JsonToken::Number;
+		default:
+			Error("Unexpected symbol '"s + *pos + "'");
+	}
+}
+
+void JsonReader::ReadLiteral(std::string_view literal) {
+	if((size_t)(end - pos) < literal.size() || std::string_view(pos, literal.size()) != literal) {
+		Error("Expected "s + literal.data());
+	}
+	pos += literal.size();
+}
+
+static int HexDigit(char c) {
+	if(c >= '0' && c <= '9') return c - '0';
+	if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+static void AppendUtf8(std::string& str, uint32_t cp) {
+	if(cp < 0x80) {
+		str += (char)cp;
+	} else if(cp < 0x800) {
+		str += (char)(0xC0 | (cp >> 6));
+		str += (char)(0x80 | (cp & 0x3F));
+	} else if(cp < 0x10000) {
+		str += (char)(0xE0 | (cp >> 12));
+		str += (char)(0x80 | ((cp >> 6) & 0x3F));
+		str += (char)(0x80 | (cp & 0x3F));
+	} else {
+		str += (char)(0xF0 | (cp >> 18));
+		str += (char)(0x80 | ((cp >> 12) & 0x3F));
+		str += (char)(0x80 | ((cp >> 6) & 0x3F));
+		str += (char)(0x80 | (cp & 0x3F));
+	}
+}
+
+void JsonReader::ReadString() {
+	// opening quote
+	pos++;
+	const auto start = pos;
+
+	// most strings have no escapes and are returned as a view
+	while(pos < end && *pos != '"' && *pos != '\\' && (uint8_t)*pos >= 0x20) {
+		pos++;
+	}
+	if(pos < end && *pos == '"') {
+		string = std::string_view(start, pos - start);
+		pos++;
+		return;
+	}
+
+	unescaped.assign(start, pos);
+	while(true) {
+		if(pos == end) Error("Unterminated string");
+
+		const char c = *pos;
+		if(c == '"') {
+			pos++;
+			break;
+		}
+		if((uint8_t)c < 0x20) Error("Control character in string");
+
+		if(c != '\\') {
+			unescaped += c;
+			pos++;
+			continue;
+		}
+
+		if(end - pos < 2) Error("Unterminated string");
+		pos++;
+		switch(*pos++) {
+			case '"': unescaped += '"'; break;
+			case '\\': unescaped += '\\'; break;
+			case '/': unescaped += '/'; break;
+			case 'n': unescaped += '\n'; break;
+			case 'r': unescaped += '\r'; break;
+			case 't': unescaped += '\t'; break;
+			case 'b': unescaped += '\b'; break;
+			case 'f': unescaped += '\f'; break;
+			case 'u': {
+				auto readHex = [&]() {
+					if(end - pos < 4) Error("Invalid unicode escape");
+					uint32_t val = 0;
+					for(int i = 0; i < 4; i++) {
+						const auto digit = HexDigit(*pos++);
+						if(digit < 0) Error("Invalid unicode escape");
+						val = (val << 4) | digit;
+					}
+					return val;
+				};
+
+				uint32_t cp = readHex();
+				// characters outside the basic plane are written as utf-16 surrogate pairs
+				if(cp >= 0xD800 && cp < 0xDC00) {
+					if(end - pos < 2 || pos[0] != '\\' || pos[1] != 'u') Error("Unpaired surrogate");
+					pos += 2;
+					const auto low = readHex();
+					if(low < 0xDC00 || low >= 0xE000) Error("Unpaired surrogate");
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+				}
+				AppendUtf8(unescaped, cp);
+				break;
+			}
+			default:
+				pos--;
+				Error("Unknown escape character");
+		}
+	}
+	string = unescaped;
+}
+
+void JsonReader::ReadNumber() {
+	const auto start = pos;
+	auto digits = [&]() {
+		const auto first = pos;
+		while(pos < end && *pos >= '0' && *pos <= '9') pos++;
+		if(pos == first) Error("Expected digit");
+	};
+
+	if(*pos == '-') pos++;
+	if(pos < end && *pos == '0') {
+		pos++;
+	} else {
+		digits();
+	}
+	if(pos < end && *pos == '.') {
+		pos++;
+		digits();
+	}
+	if(pos < end && (*pos == 'e' || *pos == 'E')) {
+		pos++;
+		if(pos < end && (*pos == '+' || *pos == '-')) pos++;
+		digits();
+	}
+
+	const auto res = std::from_chars(start, pos, number);
+	if(res.ec == std::errc::result_out_of_range) {
+		Error("Number out of range");
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class JsonToken {
+	ObjectBegin,
+	ObjectEnd,
+	ArrayBegin,
+	ArrayEnd,
+	// name of the next object member, its value follows
+	Key,
+	String,
+	Number,
+	Bool,
+	Null,
+	// the whole document was read
+	End
+};
+
+// Pull parser that walks a document token by token without building a tree.
+// Strings are views into the text, only ones containing escapes are decoded into a buffer.
+// The text (for example a MemoryMapped file) has to outlive the reader
+class JsonReader {
+  private:
+	enum class Expect : uint8_t {
+		Value,
+		// first value of an array or its end
+		ValueOrEnd,
+		Key,
+		// first key of an object or its end
+		KeyOrEnd,
+		CommaOrEnd,
+		Done
+	};
+
+	const char* pos;
+	const char* begin;
+	const char* end;
+
+	Expect expect = Expect::Value;
+	// '{' or '[' of every open container
+	std::vector<char> stack;
+
+	std::string_view string;
+	std::string unescaped;
+	double number = 0;
+	bool boolean = false;
+
+  public:
+	explicit JsonReader(std::string_view text);
+	JsonReader(const uint8_t* data, size_t size) : JsonReader(std::string_view(reinterpret_cast<const char*>(data), size)) {}
+
+	// Reads the next token, throws std::runtime_error on invalid json
+	JsonToken Next();
+	// Skips the value that starts at the next token including everything in it
+	void Skip();
+
+	// Key or String, valid until the next call to Next
+	std::string_view String() const { return string; }
+	double Number() const { return number; }
+	bool Bool() const { return boolean; }
+
+	// number of open objects and arrays
+	size_t Depth() const { return stack.size(); }
+
+  private:
+	JsonToken ReadValue();
+	void ReadString();
+	void ReadNumber();
+	void ReadLiteral(std::string_view literal);
+	void AfterValue();
+	void SkipSpace();
+
+	[[noreturn]] void Error(const std::string& message) const;
+};
@@ -0,0 +1,32 @@
+#include "logSink.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <vector>
+
+static void PrintMessage(const char* message) {
+	fputs(message, stdout);
+}
+
+static std::atomic<Log::Sink> logSink { PrintMessage };
+
+void Log::SetSink(Sink sink) {
+	logSink = sink ? sink : PrintMessage;
+}
+
+void Log::Write(const char* fmt, ...) {
+	va_list args;
+
+	va_start(args, fmt);
+	const auto size = vsnprintf(nullptr, 0, fmt, args) + 1;
+	va_end(args);
+
+	std::vector<char> buf(size);
+
+	va_start(args, fmt);
+	vsnprintf(buf.data(), size, fmt, args);
+	va_end(args);
+
+	logSink.load()(buf.data());
+}
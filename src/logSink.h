@@ -0,0 +1,17 @@
+#pragma once
+
+namespace Log {
+
+// receives every formatted message. Write can be called from several emulator threads at once so the sink has to be thread safe
+using Sink = void (*)(const char* message);
+
+// messages are printed to stdout until a sink is set
+void SetSink(Sink sink);
+
+void Write(const char* fmt, ...)
+#ifdef __GNUC__
+	__attribute__((format(printf, 1, 2)))
+#endif
+	;
+
+}
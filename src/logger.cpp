@@ -1,11 +1,15 @@
 #include "logger.h"
 #include <imgui_internal.h>
 
+#include "logSink.h"
+
 Logger logger {};
 
 Logger::Logger() {
 	AutoScroll = true;
 	Clear();
+
+	Log::SetSink([](const char* message) { logger.Log("%s", message); });
 }
 
 void Logger::Clear() {
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <array>
 #include <deque>
+#include <functional>
 #include <thread>
 
 #include <GLFW/glfw3.h>
@@ -23,6 +24,7 @@
 #include "audio.h"
 #include "fs.h"
 #include "logger.h"
+#include "rewind.h"
 #include "settings.h"
 
 #include "Emulation/CHIP-8/core.h"
@@ -30,7 +32,7 @@
 #include "Emulation/NES/NesCore.h"
 
 enum class Action {
-	Speedup,   // Toggle speedup x5
+	Speedup,   // Toggle fast-forward
 	Step,	   // Start step & advance frame
 	ResumeRun, // Resume running normally
 
@@ -42,7 +44,9 @@ enum class Action {
 	SelectNextState, // Select next savestate
 	SelectLastState, // Select previous savestate
 
-	Maximise
+	Maximise,
+
+	Rewind // Hold to step backwards
 };
 
 GLFWwindow* window;
@@ -52,12 +56,26 @@ std::unique_ptr<ICore> emulationCore;
 int selectedSaveState = 0;
 std::array<std::unique_ptr<saver>, 10> saveStates;
 
+RewindBuffer rewindBuffer;
+saver rewindState;
+
+// creates another core with the current rom, for run-ahead with a second instance.
+// Its save ram is its own memory, LoadState copies the primary's into it and the speculative frames never reach the save file
+std::function<std::unique_ptr<ICore>()> createCore;
+std::unique_ptr<ICore> runAheadCore;
+saver runAheadState;
+// ms run-ahead adds to each shown frame, smoothed
+double runAheadOverhead = 0;
+double emulationTime = 0;
+// emulated frames per shown frame while fast-forwarding, smoothed
+double fastForwardSpeed = 0;
+
 MemoryEditor memEdit { "Memory Editor" };
 
 bool settingsWindow = false;
 bool metricsWindow = false;
 
-bool speedUp = false;
+bool fastForward = false;
 bool running = false;
 bool step = false;
 
@@ -82,11 +100,19 @@ static void LoadCore(const std::string& path) {
 		glfwSetWindowSize(window, s.x, s.y);
 	}
 	try {
-		emulationCore->LoadRom(path);
+		emulationCore->LoadRom(path, true);
 
 		Settings::AddRecent(path);
 
 		memEdit.SetCore(emulationCore.get());
+		rewindBuffer.Clear();
+
+		createCore = [path]() -> std::unique_ptr<ICore> {
+			auto core = std::make_unique<T>();
+			core->LoadRom(path, false);
+			return core;
+		};
+		runAheadCore = nullptr;
 
 		running = true;
 	} catch(std::exception& e) {
@@ -190,16 +216,113 @@ static void LoadState(int number) {
 
 	const auto& state = saveStates[number];
 	if(state != nullptr) {
-		state->beginRead();
-		emulationCore->LoadState(*state);
-		state->endRead();
-
-		logger.LogScreen("Loaded state %i", number);
+		try {
+			state->beginRead();
+			emulationCore->LoadState(*state);
+			state->endRead();
+
+			logger.LogScreen("Loaded state %i", number);
+		} catch(std::exception& e) {
+			logger.LogScreen("Error loading: %s", e.what());
+		}
 	} else {
 		logger.LogScreen("Save state %i empty", number);
 	}
 }
 
+// Runs the frame with only its audio, then shows the frame Settings::RunAheadFrames later.
+// Either the state is restored afterwards or a second instance runs ahead from a copy of it
+static void RunAhead() {
+	const auto frames = Settings::RunAheadFrames;
+
+	emulationCore->SetOutput(false, true);
+	emulationCore->Update();
+
+	const auto start = glfwGetTime();
+	runAheadState.clear();
+	emulationCore->SaveState(runAheadState);
+
+	if(Settings::RunAheadSecondInstance) {
+		if(runAheadCore == nullptr) {
+			runAheadCore = createCore();
+		}
+		runAheadState.beginRead();
+		runAheadCore->LoadState(runAheadState);
+		runAheadState.endRead();
+
+		for(int i = 1; i <= frames; i++) {
+			runAheadCore->SetOutput(i == frames, false);
+			runAheadCore->Update();
+		}
+		emulationCore->Screen().CopyPixels(runAheadCore->Screen());
+	} else {
+		for(int i = 1; i <= frames; i++) {
+			emulationCore->SetOutput(i == frames, false);
+			emulationCore->Update();
+		}
+		runAheadState.beginRead();
+		emulationCore->LoadState(runAheadState);
+		runAheadState.endRead();
+	}
+	emulationCore->SetOutput(true, true);
+
+	runAheadOverhead = runAheadOverhead * 0.95 + (glfwGetTime() - start) * 1000 * 0.05;
+}
+
+static void PushRewindState() {
+	if(Settings::EnableRewind) {
+		rewindState.clear();
+		emulationCore->SaveState(rewindState);
+		rewindBuffer.Push(rewindState);
+	}
+}
+
+// Runs one frame and keeps the state before it for rewinding
+static void RunFrame() {
+	PushRewindState();
+
+	if(Settings::RunAheadFrames > 0) {
+		RunAhead();
+	} else {
+		emulationCore->Update();
+	}
+}
+
+// Runs frames without pixels or audio until most of the frame time is used up.
+// Only every Settings::FastForwardCadence-th frame is drawn and kept for rewinding
+static void FastForward() {
+	const auto cadence = std::max(Settings::FastForwardCadence, 1);
+	// leave some of the frame for the gui
+	const auto end = glfwGetTime() + 0.75 / 60.0;
+	int frames = 0;
+
+	do {
+		PushRewindState();
+		for(int i = 1; i <= cadence; i++) {
+			emulationCore->SetOutput(i == cadence, false);
+			emulationCore->Update();
+		}
+		frames += cadence;
+	} while(glfwGetTime() < end);
+	emulationCore->SetOutput(true, true);
+
+	fastForwardSpeed = fastForwardSpeed * 0.95 + frames * 0.05;
+}
+
+static void RewindFrame() {
+	if(!rewindBuffer.Pop(rewindState)) {
+		return;
+	}
+	rewindState.beginRead();
+	emulationCore->LoadState(rewindState);
+	rewindState.endRead();
+
+	// run the restored frame again to show it, its audio was already played when it ran forwards
+	emulationCore->SetOutput(true, false);
+	emulationCore->Update();
+	emulationCore->SetOutput(true, true);
+}
+
 static void HelpMarker(const char* desc) {
 	// ImGui::TextDisabled("(?)");
 	if(ImGui::IsItemHovered()) {
@@ -221,7 +344,7 @@ static void onKey(GLFWwindow* window, int key, int scancode, int action, int mod
 static void handleGuiInput() {
 	auto& hotkeys = Input::hotkeys;
 
-	if(hotkeys.GetKeyDown((int)Action::Speedup)) speedUp = !speedUp;
+	if(hotkeys.GetKeyDown((int)Action::Speedup)) fastForward = !fastForward;
 
 	if(hotkeys.GetKeyDown((int)Action::Step)) {
 		step = true;
@@ -295,6 +418,37 @@ static void drawSettings() {
 					Settings::Save();
 				}
 
+				if(ImGui::Checkbox("Rewind", &Settings::EnableRewind)) {
+					if(!Settings::EnableRewind) rewindBuffer.Clear();
+					Settings::Save();
+				}
+				if(ImGui::SliderInt("Rewind buffer (MiB)", &Settings::RewindBufferSize, 16, 2048)) {
+					rewindBuffer.SetBudget((size_t)Settings::RewindBufferSize * 1024 * 1024);
+					Settings::Save();
+				}
+				ImGui::Text("%zu frames stored in %.1f MiB", rewindBuffer.Frames(), rewindBuffer.UsedBytes() / (1024.0 * 1024.0));
+
+				if(ImGui::SliderInt("Run-ahead frames", &Settings::RunAheadFrames, 0, 4)) {
+					if(Settings::RunAheadFrames == 0) runAheadCore = nullptr;
+					Settings::Save();
+				}
+				if(ImGui::Checkbox("Run-ahead in second instance", &Settings::RunAheadSecondInstance)) {
+					if(!Settings::RunAheadSecondInstance) runAheadCore = nullptr;
+					Settings::Save();
+				}
+				HelpMarker("Runs ahead in a copy of the emulator instead of restoring the state every frame");
+
+				if(ImGui::SliderInt("Fast-forward cadence", &Settings::FastForwardCadence, 1, 60)) {
+					Settings::Save();
+				}
+				HelpMarker("While fast-forwarding only one in this many frames is drawn");
+
+				if(ImGui::SliderInt("Audio buffer (frames)", &Settings::AudioBufferFrames, 2, 16)) {
+					Audio::SetBufferFrames(Settings::AudioBufferFrames);
+					Settings::Save();
+				}
+				HelpMarker("More frames add latency but prevent pops when the emulation hitches");
+
 				int val = Settings::windowScale - 1;
 				static const char* drawModeNames[] = { "x1", "x2", "x3", "x4" };
 				if(ImGui::Combo("DrawMode", &val, drawModeNames, 4)) {
@@ -464,6 +618,23 @@ static void drawGui() {
 
 	if(metricsWindow) {
 		ImGui::ShowMetricsWindow(&metricsWindow);
+
+		if(ImGui::Begin("Emulation Metrics", &metricsWindow)) {
+			ImGui::Text("Emulation: %.3f ms/frame", emulationTime);
+			if(Settings::RunAheadFrames > 0) {
+				ImGui::Text("Run-ahead %i frames%s: %.3f ms/frame", Settings::RunAheadFrames,
+							Settings::RunAheadSecondInstance ? " (second instance)" : "", runAheadOverhead);
+			}
+			if(fastForward) {
+				ImGui::Text("Fast-forward: x%.1f", fastForwardSpeed);
+			}
+
+			const auto audio = Audio::GetStats();
+			ImGui::Text("Audio buffer: %zu / %zu samples", audio.buffered, audio.depth);
+			ImGui::Text("Audio underruns: %llu overruns: %llu", (unsigned long long)audio.underruns, (unsigned long long)audio.overruns);
+			ImGui::Text("Audio driver underflows: %llu", (unsigned long long)audio.driverUnderflows);
+		}
+		ImGui::End();
 	}
 	drawSettings();
 	emulatorPicker.Draw();
@@ -472,6 +643,8 @@ static void drawGui() {
 int main(int argc, char* argv[]) {
 	Settings::Load();
 	Audio::Init();
+	Audio::SetBufferFrames(Settings::AudioBufferFrames);
+	rewindBuffer.SetBudget((size_t)Settings::RewindBufferSize * 1024 * 1024);
 
 	#pragma region glfw Init
 	glfwSetErrorCallback(onGlfwError);
@@ -567,13 +740,18 @@ int main(int argc, char* argv[]) {
 		ImGui::NewFrame();
 
 		if(running && emulationCore != nullptr) {
-			emulationCore->Update();
-			if(speedUp) {
-				for(size_t i = 1; i < 5; i++) {
-					emulationCore->Update();
-				}
+			const auto start = glfwGetTime();
+
+			if(Settings::EnableRewind && Input::hotkeys.GetKey((int)Action::Rewind)) {
+				RewindFrame();
+			} else if(fastForward) {
+				FastForward();
+			} else {
+				RunFrame();
 			}
 			Audio::Resample();
+
+			emulationTime = emulationTime * 0.95 + (glfwGetTime() - start) * 1000 * 0.05;
 		}
 		handleGuiInput();
 		drawGui();
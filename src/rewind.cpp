@@ -0,0 +1,246 @@
+#include "rewind.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Encoding of state ^ base as pairs of runs: [zero run length][literal length][literal bytes]
+// with both lengths as 7 bit varints. Neighbouring frames mostly differ in a few bytes
+// so nearly everything ends up in zero runs
+static void WriteVarint(std::vector<uint8_t>& out, size_t val) {
+	while(val >= 0x80) {
+		out.push_back((val & 0x7F) | 0x80);
+		val >>= 7;
+	}
+	out.push_back(val);
+}
+
+static size_t ReadVarint(const uint8_t*& ptr) {
+	size_t val = 0;
+	int shift = 0;
+	while(*ptr & 0x80) {
+		val |= (size_t)(*ptr++ & 0x7F) << shift;
+		shift += 7;
+	}
+	val |= (size_t)(*ptr++) << shift;
+	return val;
+}
+
+// base == nullptr encodes the state itself
+static void Encode(const uint8_t* state, const uint8_t* base, size_t size, std::vector<uint8_t>& out) {
+	// zeros needed to end a literal run, shorter runs cost more than copying them
+	constexpr size_t minZeroRun = 4;
+
+	auto diff = [&](size_t i) -> uint8_t { return base ? state[i] ^ base[i] : state[i]; };
+
+	out.clear();
+	size_t pos = 0;
+	while(pos < size) {
+		auto zeroStart = pos;
+		while(pos < size && diff(pos) == 0) pos++;
+
+		auto literalStart = pos;
+		size_t zeros = 0;
+		while(pos < size && zeros < minZeroRun) {
+			zeros = diff(pos) == 0 ? zeros + 1 : 0;
+			pos++;
+		}
+		// give the trailing zeros to the next zero run
+		if(zeros == minZeroRun) pos -= zeros;
+
+		WriteVarint(out, literalStart - zeroStart);
+		WriteVarint(out, pos - literalStart);
+		for(auto i = literalStart; i < pos; i++) {
+			out.push_back(diff(i));
+		}
+	}
+}
+
+// xors the encoded bytes onto target
+static void Apply(const std::vector<uint8_t>& encoded, uint8_t* target) {
+	auto ptr = encoded.data();
+	const auto end = ptr + encoded.size();
+
+	size_t pos = 0;
+	while(ptr < end) {
+		pos += ReadVarint(ptr);
+		auto length = ReadVarint(ptr);
+		for(size_t i = 0; i < length; i++) {
+			target[pos + i] ^= ptr[i];
+		}
+		ptr += length;
+		pos += length;
+	}
+}
+
+RewindBuffer::RewindBuffer(size_t budget, size_t keyframeInterval) : budget(budget), keyframeInterval(keyframeInterval) {
+	worker = std::thread(&RewindBuffer::Work, this);
+}
+
+RewindBuffer::~RewindBuffer() {
+	{
+		std::lock_guard lock(mutex);
+		stop = true;
+	}
+	cv.notify_all();
+	worker.join();
+}
+
+void RewindBuffer::SetBudget(size_t bytes) {
+	std::lock_guard lock(mutex);
+	budget = bytes;
+	Trim();
+}
+
+void RewindBuffer::Push(const saver& state) {
+	{
+		std::unique_lock lock(mutex);
+		cv.wait(lock, [&]() { return pending.size() < maxPending; });
+
+		std::vector<uint8_t> buffer;
+		if(!spare.empty()) {
+			buffer = std::move(spare.back());
+			spare.pop_back();
+		}
+		buffer.assign(state.bytes(), state.bytes() + state.size());
+
+		pending.push_back(std::move(buffer));
+		frames++;
+	}
+	cv.notify_all();
+}
+
+bool RewindBuffer::Pop(saver& state) {
+	std::unique_lock lock(mutex);
+	// the state the worker is encoding is newer than anything in groups
+	cv.wait(lock, [&]() { return !busy; });
+
+	if(!pending.empty()) {
+		const auto& raw = pending.back();
+		state.clear();
+		state.write(raw.data(), raw.size());
+
+		Recycle(std::move(pending.back()));
+		pending.pop_back();
+		frames--;
+		return true;
+	}
+	if(groups.empty()) {
+		return false;
+	}
+
+	auto& group = groups.back();
+	if(restoreGroup != group.id) {
+		restoreBase.assign(group.stateSize, 0);
+		Apply(group.keyframe, restoreBase.data());
+		restoreGroup = group.id;
+	}
+
+	state.clear();
+	if(group.deltas.empty()) {
+		state.write(restoreBase.data(), restoreBase.size());
+
+		usedBytes -= group.bytes;
+		groups.pop_back();
+		// the worker only has the keyframe of the group that was just removed
+		needKeyframe = true;
+	} else {
+		restoreState = restoreBase;
+		Apply(group.deltas.back(), restoreState.data());
+		state.write(restoreState.data(), restoreState.size());
+
+		const auto size = group.deltas.back().size();
+		group.bytes -= size;
+		usedBytes -= size;
+		group.deltas.pop_back();
+	}
+	frames--;
+
+	return true;
+}
+
+void RewindBuffer::Clear() {
+	std::unique_lock lock(mutex);
+	cv.wait(lock, [&]() { return !busy; });
+
+	while(!pending.empty()) {
+		Recycle(std::move(pending.back()));
+		pending.pop_back();
+	}
+	groups.clear();
+	usedBytes = 0;
+	frames = 0;
+	needKeyframe = true;
+	restoreGroup = 0;
+}
+
+size_t RewindBuffer::Frames() {
+	std::lock_guard lock(mutex);
+	return frames;
+}
+
+size_t RewindBuffer::UsedBytes() {
+	std::lock_guard lock(mutex);
+	return usedBytes;
+}
+
+void RewindBuffer::Work() {
+	std::unique_lock lock(mutex);
+
+	while(true) {
+		cv.wait(lock, [&]() { return stop || !pending.empty(); });
+		if(stop) return;
+
+		auto state = std::move(pending.front());
+		pending.pop_front();
+
+		const bool keyframe = needKeyframe || groups.empty() || groups.back().stateSize != state.size() ||
+							  groups.back().deltas.size() + 1 >= keyframeInterval;
+		needKeyframe = false;
+		busy = true;
+		lock.unlock();
+
+		Encode(state.data(), keyframe ? nullptr : lastKeyframe.data(), state.size(), encoded);
+		// exact size, the budget is counted in encoded bytes
+		std::vector<uint8_t> entry(encoded.begin(), encoded.end());
+		const auto size = entry.size();
+
+		if(keyframe) {
+			std::swap(lastKeyframe, state);
+		}
+
+		lock.lock();
+		if(keyframe) {
+			Group group;
+			group.id = nextGroupId++;
+			group.stateSize = lastKeyframe.size();
+			group.bytes = size;
+			group.keyframe = std::move(entry);
+			groups.push_back(std::move(group));
+		} else {
+			groups.back().bytes += size;
+			groups.back().deltas.push_back(std::move(entry));
+		}
+		usedBytes += size;
+
+		Recycle(std::move(state));
+		Trim();
+
+		busy = false;
+		cv.notify_all();
+	}
+}
+
+void RewindBuffer::Trim() {
+	// deltas need their keyframe so whole groups are dropped. The newest one always stays
+	while(usedBytes > budget && groups.size() > 1) {
+		usedBytes -= groups.front().bytes;
+		frames -= 1 + groups.front().deltas.size();
+		groups.pop_front();
+	}
+}
+
+void RewindBuffer::Recycle(std::vector<uint8_t>&& buffer) {
+	if(spare.size() < 8) {
+		spare.push_back(std::move(buffer));
+	}
+}
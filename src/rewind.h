@@ -0,0 +1,79 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "saver.h"
+
+// Ring of per frame save states for rewinding.
+// Every state is stored as xor delta against the keyframe of its group and run length encoded,
+// so a restore only has to apply one delta. Encoding happens on a worker thread
+class RewindBuffer {
+  private:
+	struct Group {
+		uint64_t id = 0;
+		std::vector<uint8_t> keyframe;
+		std::vector<std::vector<uint8_t>> deltas;
+		size_t stateSize = 0;
+		size_t bytes = 0;
+	};
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::thread worker;
+	bool stop = false;
+	bool busy = false;
+
+	size_t budget;
+	size_t keyframeInterval;
+
+	// raw states waiting for the worker, newest at the back.
+	// Push waits once there are maxPending so a worker that can't keep up doesn't pile up memory
+	static constexpr size_t maxPending = 8;
+	std::deque<std::vector<uint8_t>> pending;
+	// raw state buffers to reuse so pushing doesn't allocate
+	std::vector<std::vector<uint8_t>> spare;
+
+	std::deque<Group> groups;
+	uint64_t nextGroupId = 1;
+	size_t usedBytes = 0;
+	size_t frames = 0;
+	// the worker lost the raw keyframe of the newest group
+	bool needKeyframe = true;
+	// raw keyframe of the newest group and the encoding buffer, only touched by the worker
+	std::vector<uint8_t> lastKeyframe;
+	std::vector<uint8_t> encoded;
+
+	// decoded keyframe of the group restored from last
+	std::vector<uint8_t> restoreBase;
+	std::vector<uint8_t> restoreState;
+	uint64_t restoreGroup = 0;
+
+  public:
+	// budget in bytes for the encoded states
+	RewindBuffer(size_t budget = 256 * 1024 * 1024, size_t keyframeInterval = 60);
+	RewindBuffer(const RewindBuffer&) = delete;
+	~RewindBuffer();
+
+	void SetBudget(size_t bytes);
+
+	// Stores a copy of the state, the encoding happens later on the worker.
+	// Blocks while maxPending states are still waiting for it
+	void Push(const saver& state);
+	// Removes the newest state and writes it into state. Returns false if there is none
+	bool Pop(saver& state);
+
+	void Clear();
+
+	size_t Frames();
+	size_t UsedBytes();
+
+  private:
+	void Work();
+	void Trim();
+	void Recycle(std::vector<uint8_t>&& buffer);
+};
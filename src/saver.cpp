@@ -1,6 +1,8 @@
 #include "saver.h"
 
+#include <algorithm>
 #include <fstream>
+#include <stdexcept>
 
 #include "fs.h"
 
@@ -12,13 +14,32 @@ saver::saver(const std::string& path) {
 		throw std::runtime_error("Save file too big"); // Prevent loading files > 64 Mb
 	}
 	data.resize(size);
+	length = size;
 	stream.read(reinterpret_cast<char*>(data.data()), size);
 }
 
 void saver::Save(const std::string& path) {
 	std::ofstream stream(path, std::ios::binary);
 
-	stream.write(reinterpret_cast<char*>(data.data()), data.size());
+	stream.write(reinterpret_cast<char*>(data.data()), length);
 
 	stream.close();
 }
+
+void saver::readVersion(uint32_t version) {
+	uint32_t stateVersion = 0;
+	if(readPos + sizeof(stateVersion) <= length) {
+		*this >> stateVersion;
+	}
+	if(stateVersion != version) {
+		throw std::runtime_error("Save state was made by a different version of the emulator");
+	}
+}
+
+void saver::TooShort() {
+	throw std::runtime_error("Save state is cut short");
+}
+
+void saver::Grow(size_t size) {
+	data.resize(std::max(size, data.size() * 2));
+}
@@ -1,17 +1,23 @@
 #pragma once
-#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include <vector>
-#include <iterator>
 
 class saver {
   private:
+	// Arena the state is written into. It only ever grows so after the first state
+	// clear() and writing the next one doesn't allocate anything
 	std::vector<uint8_t> data;
-	uint32_t readPos = 0;
+	size_t length = 0;
+	size_t readPos = 0;
 	bool reading = false;
 
+	void Grow(size_t size);
+	[[noreturn]] static void TooShort();
+
   public:
 	saver() = default;
 	saver(const std::string& path);
@@ -20,44 +26,63 @@ class saver {
 
 	void write(const uint8_t* ptr, size_t size) {
 		assert(!reading);
-		data.reserve(data.size() + size);
-		std::copy_n(ptr, size, std::back_inserter(data));
+		if(length + size > data.size()) {
+			Grow(length + size);
+		}
+		std::memcpy(data.data() + length, ptr, size);
+		length += size;
 	}
+	// throws std::runtime_error if the state ends before size bytes
 	void read(uint8_t* ptr, size_t size) {
 		assert(reading);
-		assert(readPos + size <= data.size());
-		std::copy_n(this->data.begin() + readPos, size, ptr);
+		if(size > length - readPos) TooShort();
+		std::memcpy(ptr, data.data() + readPos, size);
 		readPos += size;
 	}
 
 	template<typename T>
 	saver& operator<<(const T& value) {
-		assert(!reading);
-		// todo: make more efficient?
-		data.reserve(data.size() + sizeof(T));
-		std::copy_n((uint8_t*)&value, sizeof(T), std::back_inserter(data));
+		static_assert(std::is_trivially_copyable_v<T>);
+		write(reinterpret_cast<const uint8_t*>(&value), sizeof(T));
 		return *this;
 	}
 
 	template<typename T>
 	saver& operator>>(T& value) {
-		assert(reading);
-		assert(readPos + sizeof(T) <= data.size());
-		std::copy_n(this->data.begin() + readPos, sizeof(T), (uint8_t*)&value);
-		readPos += sizeof(T);
+		static_assert(std::is_trivially_copyable_v<T>);
+		read(reinterpret_cast<uint8_t*>(&value), sizeof(T));
 		return *this;
 	}
 
+	// A state starts with the version of its layout, each system bumps its own whenever SaveState writes something else
+	void writeVersion(uint32_t version) { *this << version; }
+	// Throws if the state was written with another layout, before anything of it is read
+	void readVersion(uint32_t version);
+	// Throws if fewer than size bytes are left, so a state that is cut short can be rejected before any of it is loaded
+	void require(size_t size) const {
+		if(size > length - readPos) TooShort();
+	}
+
 	void beginRead() {
 		readPos = 0;
 		reading = true;
 	}
 	void endRead() {
-		assert(readPos == data.size());
+		assert(readPos == length);
 		reading = false;
 	}
 
+	// Preallocates the arena, for example with the size of a previous state
+	void reserve(size_t size) {
+		if(size > data.size()) Grow(size);
+	}
+	size_t size() const { return length; }
+	const uint8_t* bytes() const { return data.data(); }
+
+	// Keeps the arena so the next state can be written without allocating, even after a read that threw
 	void clear() {
-		data.clear();
+		length = 0;
+		readPos = 0;
+		reading = false;
 	}
 };
@@ -25,6 +25,12 @@ void Load() {
 		j["enableVsync"].tryGet(EnableVsync);
 		j["autoHideMenu"].tryGet(AutoHideMenu);
 		j["windowScale"].tryGet(windowScale);
+		j["enableRewind"].tryGet(EnableRewind);
+		j["rewindBufferSize"].tryGet(RewindBufferSize);
+		j["runAheadFrames"].tryGet(RunAheadFrames);
+		j["runAheadSecondInstance"].tryGet(RunAheadSecondInstance);
+		j["fastForwardCadence"].tryGet(FastForwardCadence);
+		j["audioBufferFrames"].tryGet(AudioBufferFrames);
 
 		std::vector<std::string> files;
 		j["recent"].tryGet(files);
@@ -39,6 +45,12 @@ void Save() {
 		{ "enableVsync", EnableVsync },
 		{ "autoHideMenu", AutoHideMenu },
 		{ "windowScale", windowScale },
+		{ "enableRewind", EnableRewind },
+		{ "rewindBufferSize", RewindBufferSize },
+		{ "runAheadFrames", RunAheadFrames },
+		{ "runAheadSecondInstance", RunAheadSecondInstance },
+		{ "fastForwardCadence", FastForwardCadence },
+		{ "audioBufferFrames", AudioBufferFrames },
 		{ "recent", RecentFiles },
 	};
 	Input::Save(j);
@@ -8,6 +8,16 @@ namespace Settings {
 inline bool EnableVsync = false;
 inline bool AutoHideMenu = true;
 inline int windowScale = 2;
+inline bool EnableRewind = true;
+// memory for the rewind buffer in MiB
+inline int RewindBufferSize = 256;
+// frames emulated ahead of the shown one to hide input lag, 0 turns it off
+inline int RunAheadFrames = 0;
+inline bool RunAheadSecondInstance = false;
+// while fast-forwarding only one in this many frames is drawn
+inline int FastForwardCadence = 10;
+// most frames of audio buffered for the output, see Audio::SetBufferFrames
+inline int AudioBufferFrames = 8;
 inline std::deque<std::string> RecentFiles;
 
 void Load();
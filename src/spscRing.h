@@ -0,0 +1,77 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Lock free ring buffer between exactly one producer and one consumer thread.
+// Each position is only written by its own side and sits on its own cache line,
+// the other side's position is cached so it's only reloaded once the ring looks full or empty
+template<typename T>
+class SpscRing {
+  private:
+	// std::hardware_destructive_interference_size isn't available everywhere yet
+	static constexpr size_t cacheLine = 64;
+
+	std::vector<T> buffer;
+	size_t mask;
+
+	// elements pushed in total
+	alignas(cacheLine) std::atomic<size_t> writePos { 0 };
+	// producer's copy of readPos
+	size_t cachedRead = 0;
+
+	// elements popped in total
+	alignas(cacheLine) std::atomic<size_t> readPos { 0 };
+	// consumer's copy of writePos
+	size_t cachedWrite = 0;
+
+  public:
+	// capacity gets rounded up to a power of two
+	explicit SpscRing(size_t capacity) {
+		size_t size = 1;
+		while(size < capacity) size <<= 1;
+
+		buffer.resize(size);
+		mask = size - 1;
+	}
+	SpscRing(const SpscRing&) = delete;
+
+	size_t Capacity() const { return buffer.size(); }
+	// elements in the ring, only exact when called from one of the two threads
+	size_t Size() const {
+		return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);
+	}
+
+	// Producer: copies as many of the elements as fit and returns how many that were
+	size_t Push(const T* data, size_t count) {
+		const auto write = writePos.load(std::memory_order_relaxed);
+		if(write - cachedRead + count > buffer.size()) {
+			cachedRead = readPos.load(std::memory_order_acquire);
+		}
+
+		count = std::min(count, buffer.size() - (write - cachedRead));
+		for(size_t i = 0; i < count; i++) {
+			buffer[(write + i) & mask] = data[i];
+		}
+
+		writePos.store(write + count, std::memory_order_release);
+		return count;
+	}
+
+	// Consumer: copies up to count elements to out and returns how many that were
+	size_t Pop(T* out, size_t count) {
+		const auto read = readPos.load(std::memory_order_relaxed);
+		if(cachedWrite - read < count) {
+			cachedWrite = writePos.load(std::memory_order_acquire);
+		}
+
+		count = std::min(count, cachedWrite - read);
+		for(size_t i = 0; i < count; i++) {
+			out[i] = buffer[(read + i) & mask];
+		}
+
+		readPos.store(read + count, std::memory_order_release);
+		return count;
+	}
+};
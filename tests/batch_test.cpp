@@ -0,0 +1,148 @@
+// Battery backed carts run by several instances at once the way emu-batch --instances does.
+// Every instance has to get its own zeroed save ram, otherwise the runs change each other and the user's save files
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Emulation/NES/Cartridge.h"
+#include "fs.h"
+#include "md5.h"
+#include "saver.h"
+
+#include "synthetic.h"
+#include "systems.h"
+
+#include "check.h"
+
+// the labels are the addresses the program runs at
+static const uint8_t nesProgram[] = {
+	// reset: $8000
+	0x78,             // SEI
+	0xD8,             // CLD
+	0xA2, 0xFF,       // LDX #$FF
+	0x9A,             // TXS
+	// vw1: $8005
+	0x2C, 0x02, 0x20, // BIT $2002
+	0x10, 0xFB,       // BPL vw1
+	// vw2: $800A
+	0x2C, 0x02, 0x20, // BIT $2002
+	0x10, 0xFB,       // BPL vw2
+	0xA9, 0x80,       // LDA #$80
+	0x8D, 0x00, 0x20, // STA $2000
+	0xA9, 0x08,       // LDA #$08
+	0x8D, 0x01, 0x20, // STA $2001
+	// loop: $8019
+	0x4C, 0x19, 0x80, // JMP loop
+	// nmi: $801C, counts the frames in the save ram and shows the count as the backdrop
+	0xEE, 0x00, 0x60, // INC $6000
+	0xA9, 0x3F,       // LDA #$3F
+	0x8D, 0x06, 0x20, // STA $2006
+	0xA9, 0x00,       // LDA #$00
+	0x8D, 0x06, 0x20, // STA $2006
+	0xAD, 0x00, 0x60, // LDA $6000
+	0x29, 0x3F,       // AND #$3F
+	0x8D, 0x07, 0x20, // STA $2007
+	0xA9, 0x00,       // LDA #$00
+	0x8D, 0x06, 0x20, // STA $2006
+	0x8D, 0x06, 0x20, // STA $2006
+	0x40,             // RTI
+	// irq: $803A
+	0x40,             // RTI
+};
+
+// entry point jumps here
+static const uint8_t gbProgram[] = {
+	// $0150
+	0x3E, 0x0A,       // LD A,$0A
+	0xEA, 0x00, 0x00, // LD ($0000),A
+	// loop: $0155, keeps counting in the save ram and shows the count in the palette
+	0x21, 0x00, 0xA0, // LD HL,$A000
+	0x34,             // INC (HL)
+	0x7E,             // LD A,(HL)
+	0xE0, 0x47,       // LDH (BGP),A
+	0x18, 0xF7,       // JR loop
+};
+
+static SystemRom NesBatteryRom() {
+	auto cart = std::make_shared<Nes::CartImage>();
+	// mmc1 starts out with the last bank at $C000, so the layout is the same as nrom
+	cart->rom = Synthetic::NesRom({ std::begin(nesProgram), std::end(nesProgram) }, 0x801C, 0x803A);
+	cart->mapper = 1;
+	cart->hasSram = true;
+	return { "nes", {}, cart };
+}
+
+static SystemRom GameboyBatteryRom() {
+	auto rom = Synthetic::GameboyRom();
+	// MBC1+RAM+BATTERY with 8KB of ram
+	rom[0x147] = 0x03;
+	rom[0x149] = 0x02;
+
+	uint8_t checksum = 0;
+	for(int i = 0x134; i <= 0x14C; i++) {
+		checksum = checksum - rom[i] - 1;
+	}
+	rom[0x14D] = checksum;
+
+	std::copy(std::begin(gbProgram), std::end(gbProgram), rom.begin() + 0x150);
+	return { "gb", rom, nullptr };
+}
+
+struct Output {
+	std::string screen;
+	std::vector<uint8_t> state;
+};
+
+static Output Run(const SystemRom& rom, int frames) {
+	auto system = CreateSystem(rom);
+	for(int i = 0; i < frames; i++) {
+		system->RunFrame();
+	}
+
+	Output output;
+	const auto& screen = system->Screen();
+	output.screen = md5((const char*)screen.Data(), screen.GetWidth() * screen.GetHeight() * sizeof(uint32_t)).ToString();
+
+	saver state;
+	system->SaveState(state);
+	output.state.assign(state.bytes(), state.bytes() + state.size());
+	return output;
+}
+
+static void TestInstances(const SystemRom& rom) {
+	const int frames = 120;
+
+	// alone first, whatever it leaves in the save ram would show up in the runs after it
+	const auto reference = Run(rom, frames);
+
+	std::vector<Output> outputs(4);
+	std::vector<std::thread> threads;
+	for(auto& output : outputs) {
+		threads.emplace_back([&]() { output = Run(rom, frames); });
+	}
+	for(auto& thread : threads) {
+		thread.join();
+	}
+
+	for(const auto& output : outputs) {
+		CHECK(output.screen == reference.screen);
+		CHECK(output.state == reference.state);
+	}
+}
+
+int main() {
+	// a save file would be created relative to the working directory, start with an empty one
+	const auto dir = fs::current_path() / "batch-test-run";
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	fs::current_path(dir);
+
+	TestInstances(NesBatteryRom());
+	TestInstances(GameboyBatteryRom());
+
+	CHECK(!fs::exists("saves"));
+
+	return Check::Failures();
+}
@@ -0,0 +1,136 @@
+// The compiled nes cart db has to be rebuilt whenever the binary is older than the json or isn't a valid db
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Emulation/NES/CartDb.h"
+#include "fs.h"
+#include "logSink.h"
+
+#include "check.h"
+
+static const char* hashA = "56FE858D1035DCE4B68520F457A0858BAE7BB16D";
+static const char* hashB = "0123456789ABCDEF0123456789ABCDEF01234567";
+static const char* hashC = "FEDCBA9876543210FEDCBA9876543210FEDCBA98";
+
+static void WriteFile(const fs::path& path, const std::string& content) {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file << content;
+}
+
+// the shapes the xml conversion produces: single elements as objects, repeated ones as arrays
+static std::string Db(int mapperA, bool withC) {
+	std::string json = R"({"database":{"@version":"1.0","game":[)";
+	json += R"({"@name":"A","cartridge":{"board":{"@mapper":")" + std::to_string(mapperA) + R"(","prg":{"@sha1":")" + hashA + R"("}}}},)";
+	json += R"({"cartridge":[{"board":{"@mapper":4,"prg":[{"@size":"128k","@sha1":")" + std::string(hashB) + R"("}]}}],"@name":"B"})";
+	if(withC) {
+		json += R"(,{"@name":"C","cartridge":{"board":[{"@mapper":"7","prg":{"@sha1":")" + std::string(hashC) + R"("}}]}})";
+	}
+	return json + "]}}";
+}
+
+static bool Has(const Nes::CartDb& db, const char* hash, int mapper, const std::string& name) {
+	Nes::CartDb::Entry entry;
+	return db.Find(sha1::FromString(hash), entry) && entry.mapper == mapper && entry.name == name;
+}
+
+static bool NoTempFiles(const fs::path& dir) {
+	for(auto& file : fs::directory_iterator(dir)) {
+		if(file.path().extension() == ".tmp") return false;
+	}
+	return true;
+}
+
+// moves the modification time of path away from the one of the other file
+static void Touch(const fs::path& path, const fs::path& other, int seconds) {
+	fs::last_write_time(path, fs::last_write_time(other) + std::chrono::seconds(seconds));
+}
+
+int main() {
+	Log::SetSink([](const char*) {});
+
+	const auto dir = fs::current_path() / "cartdb-test-run";
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	const auto json = dir / "db.json";
+	const auto bin = dir / "db.bin";
+
+	// compiled on first use
+	WriteFile(json, Db(1, false));
+	{
+		Nes::CartDb db(json.string());
+		CHECK(fs::exists(bin));
+		CHECK(db.Size() == 2);
+		CHECK(Has(db, hashA, 1, "A"));
+		CHECK(Has(db, hashB, 4, "B"));
+		CHECK(!Has(db, hashC, 7, "C"));
+	}
+	CHECK(NoTempFiles(dir));
+
+	// binary older than the json, recompiled while another db still maps the old one
+	{
+		Nes::CartDb old(json.string());
+
+		WriteFile(json, Db(2, true));
+		Touch(json, bin, 10);
+
+		Nes::CartDb db(json.string());
+		CHECK(db.Size() == 3);
+		CHECK(Has(db, hashA, 2, "A"));
+		CHECK(Has(db, hashC, 7, "C"));
+
+		CHECK(Has(old, hashA, 1, "A"));
+	}
+	CHECK(NoTempFiles(dir));
+
+	// up to date but not a valid db, each is recompiled from the json
+	const std::string corrupt[] = {
+		"",
+		"NCDB",
+		std::string("NCDB\x02\0\0\0\0\0\0\0\0\0\0\0", 16),
+		std::string("NCDB\x01\0\0\0\x05\0\0\0\0\0\0\0", 16),
+		std::string("XXXX\x01\0\0\0\0\0\0\0\0\0\0\0", 16),
+	};
+	for(const auto& content : corrupt) {
+		WriteFile(bin, content);
+		Touch(bin, json, 10);
+
+		Nes::CartDb db(json.string());
+		CHECK(db.Size() == 3);
+		CHECK(Has(db, hashA, 2, "A"));
+		CHECK(Has(db, hashB, 4, "B"));
+	}
+	CHECK(NoTempFiles(dir));
+
+	// compiled by several processes at once, each writes its own temporary file
+	{
+		std::vector<std::thread> threads;
+		for(int i = 0; i < 4; i++) {
+			threads.emplace_back([&]() {
+				for(int j = 0; j < 10; j++) {
+					Nes::CartDb::Compile(json.string(), bin.string());
+				}
+			});
+		}
+		for(auto& thread : threads) {
+			thread.join();
+		}
+
+		Nes::CartDb db(json.string());
+		CHECK(db.Size() == 3);
+	}
+	CHECK(NoTempFiles(dir));
+
+	// the binary is enough without the json, unless it is corrupt as well
+	fs::remove(json);
+	{
+		Nes::CartDb db(json.string());
+		CHECK(Has(db, hashC, 7, "C"));
+	}
+	WriteFile(bin, "NCDB");
+	CHECK_THROWS(Nes::CartDb(json.string()));
+
+	return Check::Failures();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdio>
+#include <stdexcept>
+
+// Just enough for the test executables: a failed check is printed and the test keeps going,
+// main returns Failures() so ctest sees the result
+namespace Check {
+
+inline int failures = 0;
+
+inline void Fail(const char* file, int line, const char* expr) {
+	fprintf(stderr, "%s:%i: check failed: %s\n", file, line, expr);
+	failures++;
+}
+
+inline int Failures() {
+	if(failures) {
+		fprintf(stderr, "%i checks failed\n", failures);
+	}
+	return failures ? 1 : 0;
+}
+
+}
+
+#define CHECK(expr) \
+	do { \
+		if(!(expr)) Check::Fail(__FILE__, __LINE__, #expr); \
+	} while(false)
+
+// expr has to throw an exception derived from std::exception
+#define CHECK_THROWS(expr) \
+	do { \
+		bool thrown = false; \
+		try { \
+			(void)(expr); \
+		} catch(std::exception&) { \
+			thrown = true; \
+		} \
+		if(!thrown) Check::Fail(__FILE__, __LINE__, #expr " throws"); \
+	} while(false)
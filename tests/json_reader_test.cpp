@@ -0,0 +1,165 @@
+// The pull parser against the parts of json the cart db doesn't happen to use much:
+// escapes, nesting, every form of number and documents that are cut off or broken
+#include <string>
+#include <string_view>
+
+#include "jsonReader.h"
+
+#include "check.h"
+
+// all tokens of text, separated by spaces: { } [ ] k:key s:string n:number true false null
+static std::string Tokens(std::string_view text) {
+	JsonReader reader(text);
+	std::string result;
+
+	while(true) {
+		const auto token = reader.Next();
+		if(token == JsonToken::End) break;
+
+		if(!result.empty()) result += ' ';
+		switch(token) {
+			case JsonToken::ObjectBegin: result += '{'; break;
+			case JsonToken::ObjectEnd: result += '}'; break;
+			case JsonToken::ArrayBegin: result += '['; break;
+			case JsonToken::ArrayEnd: result += ']'; break;
+			case JsonToken::Key: result += "k:" + std::string(reader.String()); break;
+			case JsonToken::String: result += "s:" + std::string(reader.String()); break;
+			case JsonToken::Number: result += "n:" + std::to_string(reader.Number()); break;
+			case JsonToken::Bool: result += reader.Bool() ? "true" : "false"; break;
+			case JsonToken::Null: result += "null"; break;
+			case JsonToken::End: break;
+		}
+	}
+	return result;
+}
+
+static std::string String(std::string_view text) {
+	JsonReader reader(text);
+	CHECK(reader.Next() == JsonToken::String);
+	return std::string(reader.String());
+}
+
+static double Number(std::string_view text) {
+	JsonReader reader(text);
+	CHECK(reader.Next() == JsonToken::Number);
+	const auto number = reader.Number();
+	CHECK(reader.Next() == JsonToken::End);
+	return number;
+}
+
+static void TestStrings() {
+	CHECK(String(R"("plain")") == "plain");
+	CHECK(String(R"("")") == "");
+	CHECK(String(R"("\"\\\/\n\r\t\b\f")") == "\"\\/\n\r\t\b\f");
+	CHECK(String(R"("before \n after")") == "before \n after");
+
+	CHECK(String(R"("\u0041")") == "A");
+	CHECK(String(R"("\u00e9")") == "\xC3\xA9");
+	CHECK(String(R"("\u20AC")") == "\xE2\x82\xAC");
+	// U+1F600 as a surrogate pair
+	CHECK(String(R"("\uD83D\uDE00")") == "\xF0\x9F\x98\x80");
+	CHECK(String(R"("a\ud834\udd1eb")") == "a\xF0\x9D\x84\x9E" "b");
+	// utf-8 is passed through unchanged
+	CHECK(String("\"\xC3\xA9\"") == "\xC3\xA9");
+
+	// an escaped key is decoded as well
+	CHECK(Tokens(R"({"a\tb":1})") == "{ k:a\tb n:1.000000 }");
+
+	CHECK_THROWS(Tokens(R"("\x")"));
+	CHECK_THROWS(Tokens(R"("\u12")"));
+	CHECK_THROWS(Tokens(R"("\u12G4")"));
+	CHECK_THROWS(Tokens(R"("\uD83D")"));
+	CHECK_THROWS(Tokens(R"("\uD83Dx")"));
+	CHECK_THROWS(Tokens(R"("\uD83DA")"));
+	CHECK_THROWS(Tokens("\"tab\tin string\""));
+}
+
+static void TestNesting() {
+	CHECK(Tokens("[]") == "[ ]");
+	CHECK(Tokens("{}") == "{ }");
+	CHECK(Tokens(" [ [ ] , { } ] ") == "[ [ ] { } ]");
+	CHECK(Tokens(R"({"a":[1,{"b":[true,false,null]}],"c":{"d":{}}})") ==
+		  "{ k:a [ n:1.000000 { k:b [ true false null ] } ] k:c { k:d { } } }");
+	CHECK(Tokens("[[[[[[[[[[1]]]]]]]]]]") == "[ [ [ [ [ [ [ [ [ [ n:1.000000 ] ] ] ] ] ] ] ] ] ]");
+	// byte order mark
+	CHECK(Tokens("\xEF\xBB\xBF[1]") == "[ n:1.000000 ]");
+
+	// Depth follows the open containers and Skip jumps over a whole value
+	JsonReader reader(R"({"skip":{"a":[1,2,{"b":3}]},"keep":[4]})");
+	CHECK(reader.Next() == JsonToken::ObjectBegin);
+	CHECK(reader.Depth() == 1);
+	CHECK(reader.Next() == JsonToken::Key);
+	reader.Skip();
+	CHECK(reader.Depth() == 1);
+	CHECK(reader.Next() == JsonToken::Key && reader.String() == "keep");
+	CHECK(reader.Next() == JsonToken::ArrayBegin);
+	CHECK(reader.Depth() == 2);
+	CHECK(reader.Next() == JsonToken::Number && reader.Number() == 4);
+	CHECK(reader.Next() == JsonToken::ArrayEnd);
+	CHECK(reader.Next() == JsonToken::ObjectEnd);
+	CHECK(reader.Depth() == 0);
+	CHECK(reader.Next() == JsonToken::End);
+}
+
+static void TestNumbers() {
+	CHECK(Number("0") == 0);
+	CHECK(Number("-0") == 0);
+	CHECK(Number("42") == 42);
+	CHECK(Number("-17") == -17);
+	CHECK(Number("3.25") == 3.25);
+	CHECK(Number("-0.5") == -0.5);
+	CHECK(Number("1e3") == 1000);
+	CHECK(Number("1E3") == 1000);
+	CHECK(Number("2e+2") == 200);
+	CHECK(Number("25e-2") == 0.25);
+	CHECK(Number("-1.5e1") == -15);
+	CHECK(Number("9007199254740993") == 9007199254740992.0);
+
+	CHECK_THROWS(Tokens("-"));
+	CHECK_THROWS(Tokens("1."));
+	CHECK_THROWS(Tokens(".5"));
+	CHECK_THROWS(Tokens("1e"));
+	CHECK_THROWS(Tokens("1e+"));
+	CHECK_THROWS(Tokens("+1"));
+	CHECK_THROWS(Tokens("01"));
+	CHECK_THROWS(Tokens("1e999"));
+	CHECK_THROWS(Tokens("[1 2]"));
+}
+
+static void TestInvalid() {
+	// cut off anywhere
+	const std::string document = R"({"a":[1,-2.5e3,"x\u00e9",true,null],"b":{"c":false}})";
+	CHECK(Tokens(document) == "{ k:a [ n:1.000000 n:-2500.000000 s:x\xC3\xA9 true null ] k:b { k:c false } }");
+	for(size_t length = 0; length < document.size(); length++) {
+		CHECK_THROWS(Tokens(std::string_view(document.data(), length)));
+	}
+
+	CHECK_THROWS(Tokens(""));
+	CHECK_THROWS(Tokens("   "));
+	CHECK_THROWS(Tokens("tru"));
+	CHECK_THROWS(Tokens("nul"));
+	CHECK_THROWS(Tokens("True"));
+	CHECK_THROWS(Tokens("[1,]"));
+	CHECK_THROWS(Tokens("[,1]"));
+	CHECK_THROWS(Tokens("{\"a\"}"));
+	CHECK_THROWS(Tokens("{\"a\" 1}"));
+	CHECK_THROWS(Tokens("{\"a\":1,}"));
+	CHECK_THROWS(Tokens("{a:1}"));
+	CHECK_THROWS(Tokens("{1:1}"));
+	CHECK_THROWS(Tokens("[1}"));
+	CHECK_THROWS(Tokens("{\"a\":1]"));
+	CHECK_THROWS(Tokens("[1]]"));
+	CHECK_THROWS(Tokens("[1] x"));
+	CHECK_THROWS(Tokens("'a'"));
+	CHECK_THROWS(Tokens("\"unterminated"));
+	CHECK_THROWS(Tokens("\"ends in escape\\"));
+}
+
+int main() {
+	TestStrings();
+	TestNesting();
+	TestNumbers();
+	TestInvalid();
+
+	return Check::Failures();
+}
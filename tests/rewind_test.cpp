@@ -0,0 +1,129 @@
+// States pushed into the rewind buffer have to come back out byte for byte, newest first,
+// no matter where they ended up relative to the keyframes
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "rewind.h"
+#include "saver.h"
+
+#include "check.h"
+
+// a few bytes change every frame, the way a running game's state does
+static std::vector<uint8_t> State(int frame, size_t size) {
+	std::vector<uint8_t> state(size);
+	for(size_t i = 0; i < size; i++) {
+		state[i] = (uint8_t)(i * 7);
+	}
+	for(int i = 0; i < 5; i++) {
+		state[(frame * 131 + i * 977) % size] = (uint8_t)(frame + i);
+	}
+	// long literal runs and values that need more than one varint byte
+	if(frame % 3 == 0) {
+		for(size_t i = 200; i < 600 && i < size; i++) {
+			state[i] = (uint8_t)(frame * i);
+		}
+	}
+	return state;
+}
+
+static void Push(RewindBuffer& buffer, const std::vector<uint8_t>& state) {
+	saver s;
+	s.write(state.data(), state.size());
+	buffer.Push(s);
+}
+
+static bool PopEquals(RewindBuffer& buffer, const std::vector<uint8_t>& expected) {
+	saver s;
+	if(!buffer.Pop(s)) return false;
+	return s.size() == expected.size() && std::equal(expected.begin(), expected.end(), s.bytes());
+}
+
+int main() {
+	const size_t size = 4096;
+
+	// several groups, the last one incomplete
+	{
+		RewindBuffer buffer(64 * 1024 * 1024, 4);
+		for(int i = 0; i < 23; i++) {
+			Push(buffer, State(i, size));
+		}
+		CHECK(buffer.Frames() == 23);
+
+		for(int i = 22; i >= 0; i--) {
+			CHECK(PopEquals(buffer, State(i, size)));
+		}
+		saver s;
+		CHECK(!buffer.Pop(s));
+		CHECK(buffer.Frames() == 0);
+		CHECK(buffer.UsedBytes() == 0);
+	}
+
+	// pushing again after popping into an earlier group starts a new keyframe
+	{
+		RewindBuffer buffer(64 * 1024 * 1024, 4);
+		for(int i = 0; i < 10; i++) {
+			Push(buffer, State(i, size));
+		}
+		for(int i = 9; i >= 3; i--) {
+			CHECK(PopEquals(buffer, State(i, size)));
+		}
+		for(int i = 100; i < 110; i++) {
+			Push(buffer, State(i, size));
+		}
+		for(int i = 109; i >= 100; i--) {
+			CHECK(PopEquals(buffer, State(i, size)));
+		}
+		for(int i = 2; i >= 0; i--) {
+			CHECK(PopEquals(buffer, State(i, size)));
+		}
+		CHECK(buffer.Frames() == 0);
+	}
+
+	// a state of a different size can't be a delta against the keyframe
+	{
+		RewindBuffer buffer(64 * 1024 * 1024, 8);
+		Push(buffer, State(0, size));
+		Push(buffer, State(1, size));
+		Push(buffer, State(2, size + 100));
+		Push(buffer, State(3, size + 100));
+		Push(buffer, State(4, size));
+
+		CHECK(PopEquals(buffer, State(4, size)));
+		CHECK(PopEquals(buffer, State(3, size + 100)));
+		CHECK(PopEquals(buffer, State(2, size + 100)));
+		CHECK(PopEquals(buffer, State(1, size)));
+		CHECK(PopEquals(buffer, State(0, size)));
+	}
+
+	// more pushes than can wait for the worker, none of them get lost
+	{
+		RewindBuffer buffer(64 * 1024 * 1024, 16);
+		for(int i = 0; i < 500; i++) {
+			Push(buffer, State(i, size));
+		}
+		CHECK(buffer.Frames() == 500);
+		for(int i = 499; i >= 0; i--) {
+			CHECK(PopEquals(buffer, State(i, size)));
+		}
+	}
+
+	// over budget the oldest groups go, the newest states are still there
+	{
+		RewindBuffer buffer(16 * 1024, 4);
+		for(int i = 0; i < 40; i++) {
+			Push(buffer, State(i, size));
+		}
+		// at most maxPending states skipped the worker, the rest was encoded and trimmed
+		CHECK(PopEquals(buffer, State(39, size)));
+		CHECK(buffer.Frames() < 39);
+
+		int frame = 38;
+		while(buffer.Frames() > 0) {
+			CHECK(PopEquals(buffer, State(frame--, size)));
+		}
+		CHECK(frame >= 0);
+	}
+
+	return Check::Failures();
+}
@@ -0,0 +1,91 @@
+// Save states only load into the layout they were written with, anything else is rejected before it changes the system
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "systems.h"
+
+#include "check.h"
+
+static std::vector<uint8_t> Save(HeadlessSystem& system) {
+	saver state;
+	system.SaveState(state);
+	return { state.bytes(), state.bytes() + state.size() };
+}
+
+static saver FromBytes(const std::vector<uint8_t>& bytes) {
+	saver state;
+	state.write(bytes.data(), bytes.size());
+	return state;
+}
+
+static void Load(HeadlessSystem& system, saver& state) {
+	state.beginRead();
+	system.LoadState(state);
+	state.endRead();
+}
+
+static void TestSystem(const std::string& name) {
+	auto system = CreateSystem(name, "");
+	for(int i = 0; i < 30; i++) {
+		system->RunFrame();
+	}
+	const auto saved = Save(*system);
+
+	for(int i = 0; i < 30; i++) {
+		system->RunFrame();
+	}
+	const auto later = Save(*system);
+	CHECK(later != saved);
+
+	// the same version loads
+	{
+		auto state = FromBytes(saved);
+		Load(*system, state);
+		CHECK(Save(*system) == saved);
+	}
+
+	// another version, a state from before there were versions, an empty one and ones with the right version
+	// that are cut short are rejected and leave the system alone
+	auto otherVersion = saved;
+	otherVersion[0]++;
+	auto unversioned = saved;
+	unversioned.erase(unversioned.begin(), unversioned.begin() + sizeof(uint32_t));
+	const std::vector<uint8_t> half(saved.begin(), saved.begin() + saved.size() / 2);
+	const std::vector<uint8_t> lastByteMissing(saved.begin(), saved.end() - 1);
+
+	for(const auto& bytes : { otherVersion, unversioned, std::vector<uint8_t> {}, half, lastByteMissing }) {
+		auto state = FromBytes(bytes);
+		state.beginRead();
+		CHECK_THROWS(system->LoadState(state));
+		CHECK(Save(*system) == saved);
+
+		// the saver can be written to again after the failed read
+		state.clear();
+		system->SaveState(state);
+		CHECK(state.size() == saved.size());
+	}
+
+	// a system that hasn't saved anything yet still knows how long its states are
+	auto fresh = CreateSystem(name, "");
+	const auto freshState = Save(*CreateSystem(name, ""));
+	{
+		auto state = FromBytes(half);
+		state.beginRead();
+		CHECK_THROWS(fresh->LoadState(state));
+	}
+	CHECK(Save(*fresh) == freshState);
+	{
+		auto state = FromBytes(saved);
+		Load(*fresh, state);
+		CHECK(Save(*fresh) == saved);
+	}
+}
+
+int main() {
+	TestSystem("nes");
+	TestSystem("gb");
+
+	return Check::Failures();
+}